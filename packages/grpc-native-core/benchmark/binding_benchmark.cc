@@ -0,0 +1,368 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/* Micro-benchmarks for the conversions between JavaScript values and core
+   structs that happen on every call. This is built into its own module, with
+   every file in ext/ except node_grpc.cc, so that it can call those functions
+   directly. Each benchmark runs one conversion in a loop over synthetic
+   metadata or messages of a given size, and reports the time and the number
+   of allocations per iteration. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include <string>
+
+#include <nan.h>
+#include <node.h>
+#include <node_buffer.h>
+#include <uv.h>
+#include "grpc/grpc.h"
+#include "grpc/support/alloc.h"
+
+#include "../ext/byte_buffer.h"
+#include "../ext/call.h"
+
+namespace grpc {
+namespace node {
+namespace benchmark {
+
+using v8::Array;
+using v8::Function;
+using v8::FunctionTemplate;
+using v8::Local;
+using v8::Object;
+using v8::String;
+using v8::Value;
+
+// How many string entries the synthetic metadata is split across
+const size_t kMetadataEntries = 4;
+
+static std::atomic<uint64_t> gpr_allocations(0);
+static std::atomic<uint64_t> new_allocations(0);
+
+static void *CountingMalloc(size_t size) {
+  gpr_allocations.fetch_add(1, std::memory_order_relaxed);
+  return malloc(size);
+}
+
+static void *CountingZalloc(size_t size) {
+  gpr_allocations.fetch_add(1, std::memory_order_relaxed);
+  return calloc(size, 1);
+}
+
+static void *CountingRealloc(void *ptr, size_t size) {
+  gpr_allocations.fetch_add(1, std::memory_order_relaxed);
+  return realloc(ptr, size);
+}
+
+/* The state that one benchmark builds before it starts timing, and that each
+   iteration uses */
+struct Fixture {
+  Nan::Persistent<Value> message;
+  Nan::Persistent<Value> metadata;
+  Nan::Persistent<Value> send_batch;
+  grpc_byte_buffer *byte_buffer;
+  grpc_metadata_array metadata_array;
+  struct tag *tag;
+};
+
+typedef bool (*IterationFunc)(Fixture *fixture);
+
+static Local<Value> MakeMessage(size_t size) {
+  Nan::EscapableHandleScope scope;
+  Local<Object> buffer = Nan::NewBuffer(size).ToLocalChecked();
+  memset(::node::Buffer::Data(buffer), 'x', size);
+  return scope.Escape(buffer);
+}
+
+/* Metadata with kMetadataEntries keys, whose values add up to size bytes */
+static Local<Value> MakeMetadata(size_t size) {
+  Nan::EscapableHandleScope scope;
+  Local<Object> metadata = Nan::New<Object>();
+  for (size_t i = 0; i < kMetadataEntries; i++) {
+    size_t value_size = size / kMetadataEntries;
+    if (i == 0) {
+      value_size += size % kMetadataEntries;
+    }
+    std::string key = "benchmark-key-" + std::to_string(i);
+    std::string value(value_size, 'x');
+    Local<Array> values = Nan::New<Array>(1);
+    Nan::Set(values, 0, Nan::New(value).ToLocalChecked());
+    Nan::Set(metadata, Nan::New(key).ToLocalChecked(), values);
+  }
+  return scope.Escape(metadata);
+}
+
+static bool CreateMetadataArrayIteration(Fixture *fixture) {
+  grpc_metadata_array array;
+  grpc_metadata_array_init(&array);
+  bool ok = CreateMetadataArray(
+      Nan::To<Object>(Nan::New(fixture->metadata)).ToLocalChecked(), &array);
+  DestroyMetadataArray(&array);
+  return ok;
+}
+
+static bool ParseMetadataIteration(Fixture *fixture) {
+  return !ParseMetadata(&fixture->metadata_array).IsEmpty();
+}
+
+static bool BufferToByteBufferIteration(Fixture *fixture) {
+  grpc_byte_buffer *buffer = BufferToByteBuffer(Nan::New(fixture->message));
+  grpc_byte_buffer_destroy(buffer);
+  return true;
+}
+
+static bool ByteBufferToBufferIteration(Fixture *fixture) {
+  return !ByteBufferToBuffer(fixture->byte_buffer).IsEmpty();
+}
+
+/* Parses the ops that start a unary call, which is the common startBatch
+   argument with the most ops */
+static bool ParseOpsIteration(Fixture *fixture) {
+  Local<Object> batch =
+      Nan::To<Object>(Nan::New(fixture->send_batch)).ToLocalChecked();
+  static const grpc_op_type kTypes[] = {
+      GRPC_OP_SEND_INITIAL_METADATA, GRPC_OP_SEND_MESSAGE,
+      GRPC_OP_SEND_CLOSE_FROM_CLIENT};
+  grpc_op ops[OpVec::kMaxOps];
+  OpVec op_vector;
+  for (size_t i = 0; i < sizeof(kTypes) / sizeof(kTypes[0]); i++) {
+    ops[i].op = kTypes[i];
+    ops[i].flags = 0;
+    ops[i].reserved = NULL;
+    unique_ptr<Op> op(CreateOp(kTypes[i]));
+    if (!op->ParseOp(Nan::Get(batch, kTypes[i]).ToLocalChecked(), &ops[i])) {
+      return false;
+    }
+    op_vector.push_back(std::move(op));
+  }
+  return true;
+}
+
+static bool CompleteTagIteration(Fixture *fixture) {
+  Local<Array> completions = Nan::New<Array>();
+  AppendTagCompletion(fixture->tag, NULL, completions);
+  return completions->Length() == 3;
+}
+
+static NAN_METHOD(IgnoreCompletion) {}
+
+/* Fills in a received metadata array with the entries of source, without
+   taking refs on their slices. Ops only free the array's storage, because
+   core keeps the received slices, so source has to outlive dest. */
+static void ShareMetadata(const grpc_metadata_array *source,
+                          grpc_metadata_array *dest) {
+  dest->metadata = static_cast<grpc_metadata *>(
+      gpr_malloc(source->count * sizeof(grpc_metadata)));
+  memcpy(dest->metadata, source->metadata,
+         source->count * sizeof(grpc_metadata));
+  dest->count = source->count;
+  dest->capacity = source->count;
+}
+
+/* Sets up the fixture for a benchmark that converts values of the given
+   size, and returns the function for one iteration, or NULL if the name is not
+   a benchmark. The fixture's struct fields are only filled in for the
+   benchmarks that use them. */
+static IterationFunc SetUpFixture(const std::string &name, size_t size,
+                                  Fixture *fixture) {
+  fixture->byte_buffer = NULL;
+  fixture->tag = NULL;
+  grpc_metadata_array_init(&fixture->metadata_array);
+  fixture->message.Reset(MakeMessage(size));
+  fixture->metadata.Reset(MakeMetadata(size));
+  Local<Object> batch = Nan::New<Object>();
+  Nan::Set(batch, GRPC_OP_SEND_INITIAL_METADATA, Nan::New(fixture->metadata));
+  Nan::Set(batch, GRPC_OP_SEND_MESSAGE, Nan::New(fixture->message));
+  Nan::Set(batch, GRPC_OP_SEND_CLOSE_FROM_CLIENT, Nan::True());
+  fixture->send_batch.Reset(batch);
+  if (name == "createMetadataArray") {
+    return CreateMetadataArrayIteration;
+  } else if (name == "parseMetadata") {
+    CreateMetadataArray(
+        Nan::To<Object>(Nan::New(fixture->metadata)).ToLocalChecked(),
+        &fixture->metadata_array);
+    return ParseMetadataIteration;
+  } else if (name == "bufferToByteBuffer") {
+    return BufferToByteBufferIteration;
+  } else if (name == "byteBufferToBuffer") {
+    fixture->byte_buffer = BufferToByteBuffer(Nan::New(fixture->message));
+    return ByteBufferToBufferIteration;
+  } else if (name == "parseOps") {
+    return ParseOpsIteration;
+  } else if (name == "completeTag") {
+    /* The ops that receive a unary response, with received metadata, a
+     * message and trailing metadata of the given size filled in as core
+     * would fill them in */
+    CreateMetadataArray(
+        Nan::To<Object>(Nan::New(fixture->metadata)).ToLocalChecked(),
+        &fixture->metadata_array);
+    OpVec *ops = new OpVec();
+    grpc_op op;
+    unique_ptr<Op> parsed(CreateOp(GRPC_OP_RECV_INITIAL_METADATA));
+    parsed->ParseOp(Nan::True(), &op);
+    ShareMetadata(&fixture->metadata_array,
+                  op.data.recv_initial_metadata.recv_initial_metadata);
+    ops->push_back(std::move(parsed));
+    parsed.reset(CreateOp(GRPC_OP_RECV_MESSAGE));
+    parsed->ParseOp(Nan::True(), &op);
+    // The op owns the message, like one that core received
+    *op.data.recv_message.recv_message =
+        BufferToByteBuffer(Nan::New(fixture->message));
+    ops->push_back(std::move(parsed));
+    parsed.reset(CreateOp(GRPC_OP_RECV_STATUS_ON_CLIENT));
+    parsed->ParseOp(Nan::True(), &op);
+    *op.data.recv_status_on_client.status = GRPC_STATUS_OK;
+    *op.data.recv_status_on_client.status_details =
+        grpc_slice_from_static_string("OK");
+    ShareMetadata(&fixture->metadata_array,
+                  op.data.recv_status_on_client.trailing_metadata);
+    ops->push_back(std::move(parsed));
+    fixture->tag = new struct tag(
+        Nan::GetFunction(Nan::New<FunctionTemplate>(IgnoreCompletion))
+            .ToLocalChecked(),
+        ops, NULL, Nan::Null());
+    return CompleteTagIteration;
+  }
+  return NULL;
+}
+
+static void TearDownFixture(Fixture *fixture) {
+  if (fixture->byte_buffer != NULL) {
+    grpc_byte_buffer_destroy(fixture->byte_buffer);
+  }
+  if (fixture->tag != NULL) {
+    DestroyTag(fixture->tag);
+  }
+  DestroyMetadataArray(&fixture->metadata_array);
+  fixture->message.Reset();
+  fixture->metadata.Reset();
+  fixture->send_batch.Reset();
+}
+
+/* Arguments:
+ * 0: Benchmark name
+ * 1: Size in bytes of the metadata or message to convert
+ * 2: Number of iterations
+ * Returns an object with the time and allocation counts per iteration
+ */
+NAN_METHOD(Run) {
+  if (!info[0]->IsString()) {
+    return Nan::ThrowTypeError("run's first argument must be a string");
+  }
+  if (!info[1]->IsUint32()) {
+    return Nan::ThrowTypeError("run's second argument must be a size");
+  }
+  if (!info[2]->IsUint32() || Nan::To<uint32_t>(info[2]).FromJust() == 0) {
+    return Nan::ThrowTypeError(
+        "run's third argument must be a positive number of iterations");
+  }
+  std::string name(*Nan::Utf8String(info[0]));
+  size_t size = Nan::To<uint32_t>(info[1]).FromJust();
+  uint32_t iterations = Nan::To<uint32_t>(info[2]).FromJust();
+  Fixture fixture;
+  IterationFunc iteration = SetUpFixture(name, size, &fixture);
+  if (iteration == NULL) {
+    TearDownFixture(&fixture);
+    return Nan::ThrowError("Unknown benchmark");
+  }
+  uint64_t gpr_before = gpr_allocations.load();
+  uint64_t new_before = new_allocations.load();
+  uint64_t start = uv_hrtime();
+  bool ok = true;
+  for (uint32_t i = 0; i < iterations && ok; i++) {
+    Nan::HandleScope scope;
+    ok = iteration(&fixture);
+  }
+  uint64_t elapsed = uv_hrtime() - start;
+  uint64_t gpr_count = gpr_allocations.load() - gpr_before;
+  uint64_t new_count = new_allocations.load() - new_before;
+  TearDownFixture(&fixture);
+  if (!ok) {
+    return Nan::ThrowError("Benchmark iteration failed");
+  }
+  Local<Object> result = Nan::New<Object>();
+  Nan::Set(result, Nan::New("name").ToLocalChecked(), info[0]);
+  Nan::Set(result, Nan::New("size").ToLocalChecked(),
+           Nan::New(static_cast<double>(size)));
+  Nan::Set(result, Nan::New("iterations").ToLocalChecked(),
+           Nan::New(iterations));
+  Nan::Set(result, Nan::New("nsPerOp").ToLocalChecked(),
+           Nan::New(static_cast<double>(elapsed) / iterations));
+  Nan::Set(result, Nan::New("gprAllocsPerOp").ToLocalChecked(),
+           Nan::New(static_cast<double>(gpr_count) / iterations));
+  Nan::Set(result, Nan::New("newAllocsPerOp").ToLocalChecked(),
+           Nan::New(static_cast<double>(new_count) / iterations));
+  info.GetReturnValue().Set(result);
+}
+
+void init(Local<Object> exports) {
+  /* This has to happen before anything in core allocates, so that every
+   * allocation is matched with the right free */
+  gpr_allocation_functions functions = {CountingMalloc, CountingZalloc,
+                                        CountingRealloc, free};
+  gpr_set_allocation_functions(functions);
+  grpc_init();
+  /* The ops check for instances of these classes while they parse, so their
+   * templates are needed. The classes are not exported from this module. */
+  Local<Object> classes = Nan::New<Object>();
+  Call::Init(classes);
+  BatchTemplate::Init(classes);
+  PreparedMetadata::Init(classes);
+  MetadataView::Init(classes);
+  static const char *kBenchmarks[] = {
+      "createMetadataArray", "parseMetadata", "bufferToByteBuffer",
+      "byteBufferToBuffer",  "parseOps",      "completeTag"};
+  size_t count = sizeof(kBenchmarks) / sizeof(kBenchmarks[0]);
+  Local<Array> names = Nan::New<Array>(count);
+  for (size_t i = 0; i < count; i++) {
+    Nan::Set(names, i, Nan::New(kBenchmarks[i]).ToLocalChecked());
+  }
+  Nan::Set(exports, Nan::New("benchmarks").ToLocalChecked(), names);
+  Nan::Set(exports, Nan::New("run").ToLocalChecked(),
+           Nan::GetFunction(Nan::New<FunctionTemplate>(Run)).ToLocalChecked());
+}
+
+}  // namespace benchmark
+}  // namespace node
+}  // namespace grpc
+
+/* Counts the C++ allocations made by the code in this module. Core allocates
+ * through gpr_malloc, so these are mostly from the binding code that is being
+ * measured. The module is linked with -Bsymbolic so that its own calls to new
+ * use these definitions instead of the ones exported by the node binary. */
+void *operator new(size_t size) {
+  grpc::node::benchmark::new_allocations.fetch_add(
+      1, std::memory_order_relaxed);
+  void *ptr = malloc(size == 0 ? 1 : size);
+  if (ptr == NULL) {
+    // The module is built without exceptions, so bad_alloc cannot be thrown
+    abort();
+  }
+  return ptr;
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void operator delete[](void *ptr) noexcept { free(ptr); }
+
+NODE_MODULE(grpc_node_benchmark, grpc::node::benchmark::init)
@@ -33,7 +33,10 @@
     # Indicates that the library should be built with compatibility for musl
     # libc, so that it can run on Alpine Linux. This is only necessary if not
     # building on Alpine Linux
-    'grpc_alpine%': 'false'
+    'grpc_alpine%': 'false',
+    # Indicates that the grpc_node_benchmark module, with micro-benchmarks for
+    # the binding code, should be built as well
+    'grpc_node_benchmark%': 'false'
   },
   'target_defaults': {
     'configurations': {
@@ -998,5 +1001,54 @@
         }
       ]
     }
+  ],
+  'conditions': [
+    ['grpc_node_benchmark=="true"', {
+      'targets': [
+        {
+          'include_dirs': [
+            "<!(node -e \"require('nan')\")"
+          ],
+          'cflags': [
+            '-pthread',
+            '-Wno-error=deprecated-declarations'
+          ],
+          "conditions": [
+            ['OS=="win" or runtime=="electron"', {
+              'dependencies': [
+                "boringssl",
+              ]
+            }],
+            ['OS=="win"', {
+              'dependencies': [
+                "z",
+              ]
+            }],
+            ['OS=="linux"', {
+              'ldflags': [
+                '-Wl,-wrap,memcpy',
+                # Keeps the module's own calls to operator new in the module
+                '-Wl,-Bsymbolic'
+              ]
+            }],
+            ['OS == "mac"', {
+              'xcode_settings': {
+                'MACOSX_DEPLOYMENT_TARGET': '10.9'
+              }
+            }]
+          ],
+          "target_name": "grpc_node_benchmark",
+          # Everything in ext/ except the module definition in node_grpc.cc
+          "sources": [
+            "<!@(node -p \"require('fs').readdirSync('./ext').filter(f=>f!=='node_grpc.cc').map(f=>'ext/'+f).join(' ')\")",
+            "benchmark/binding_benchmark.cc"
+          ],
+          "dependencies": [
+            "grpc",
+            "gpr",
+          ]
+        }
+      ]
+    }]
   ]
 }
@@ -18,6 +18,8 @@
 
 #include <string.h>
 
+#include <vector>
+
 #include <nan.h>
 #include <node.h>
 #include "grpc/byte_buffer_reader.h"
@@ -33,6 +35,7 @@ namespace node {
 using Nan::Callback;
 using Nan::MaybeLocal;
 
+using v8::Array;
 using v8::Function;
 using v8::Local;
 using v8::Object;
@@ -47,6 +50,26 @@ grpc_byte_buffer *BufferToByteBuffer(Local<Value> buffer) {
   return byte_buffer;
 }
 
+grpc_byte_buffer *BufferArrayToByteBuffer(Local<Array> buffers) {
+  Nan::HandleScope scope;
+  uint32_t length = buffers->Length();
+  for (uint32_t i = 0; i < length; i++) {
+    if (!::node::Buffer::HasInstance(Nan::Get(buffers, i).ToLocalChecked())) {
+      return NULL;
+    }
+  }
+  std::vector<grpc_slice> slices(length);
+  for (uint32_t i = 0; i < length; i++) {
+    slices[i] = CreateSliceFromBuffer(Nan::Get(buffers, i).ToLocalChecked());
+  }
+  grpc_byte_buffer *byte_buffer(
+      grpc_raw_byte_buffer_create(slices.data(), slices.size()));
+  for (uint32_t i = 0; i < length; i++) {
+    grpc_slice_unref(slices[i]);
+  }
+  return byte_buffer;
+}
+
 namespace {
 void delete_buffer(char *data, void *hint) {
   grpc_slice *slice = static_cast<grpc_slice *>(hint);
@@ -66,7 +89,20 @@ Local<Value> ByteBufferToBuffer(grpc_byte_buffer *buffer) {
     return scope.Escape(Nan::Undefined());
   }
   grpc_slice *slice = new grpc_slice;
-  *slice = grpc_byte_buffer_reader_readall(&reader);
+  grpc_slice next_slice;
+  if (!grpc_byte_buffer_reader_next(&reader, slice)) {
+    *slice = grpc_empty_slice();
+  } else if (grpc_byte_buffer_reader_next(&reader, &next_slice)) {
+    /* The message is split across more than one slice, so it has to be
+     * flattened into a single new slice */
+    grpc_slice_unref(next_slice);
+    grpc_slice_unref(*slice);
+    grpc_byte_buffer_reader_destroy(&reader);
+    grpc_byte_buffer_reader_init(&reader, buffer);
+    *slice = grpc_byte_buffer_reader_readall(&reader);
+  }
+  /* Otherwise the message is a single slice, and the Buffer can reference it
+   * without copying */
   grpc_byte_buffer_reader_destroy(&reader);
   char *result = reinterpret_cast<char *>(GRPC_SLICE_START_PTR(*slice));
   size_t length = GRPC_SLICE_LENGTH(*slice);
@@ -75,5 +111,32 @@ Local<Value> ByteBufferToBuffer(grpc_byte_buffer *buffer) {
   return scope.Escape(buf);
 }
 
+Local<Value> ByteBufferToBufferArray(grpc_byte_buffer *buffer) {
+  Nan::EscapableHandleScope scope;
+  if (buffer == NULL) {
+    return scope.Escape(Nan::Null());
+  }
+  grpc_byte_buffer_reader reader;
+  if (!grpc_byte_buffer_reader_init(&reader, buffer)) {
+    Nan::ThrowError("Error initializing byte buffer reader.");
+    return scope.Escape(Nan::Undefined());
+  }
+  Local<Array> buffers = Nan::New<Array>();
+  grpc_slice next_slice;
+  uint32_t index = 0;
+  while (grpc_byte_buffer_reader_next(&reader, &next_slice)) {
+    // The returned reference to each slice is owned by its Buffer
+    grpc_slice *slice = new grpc_slice;
+    *slice = next_slice;
+    char *data = reinterpret_cast<char *>(GRPC_SLICE_START_PTR(*slice));
+    size_t length = GRPC_SLICE_LENGTH(*slice);
+    Nan::Set(buffers, index++,
+             Nan::NewBuffer(data, length, delete_buffer, slice)
+                 .ToLocalChecked());
+  }
+  grpc_byte_buffer_reader_destroy(&reader);
+  return scope.Escape(buffers);
+}
+
 }  // namespace node
 }  // namespace grpc
@@ -32,9 +32,19 @@ namespace node {
    ::node::Buffer::HasInstance(buffer) */
 grpc_byte_buffer *BufferToByteBuffer(v8::Local<v8::Value> buffer);
 
+/* Convert an array of Node.js Buffers to a grpc_byte_buffer with one slice per
+   Buffer, without concatenating them. Returns NULL if any element of the array
+   is not a Buffer */
+grpc_byte_buffer *BufferArrayToByteBuffer(v8::Local<v8::Array> buffers);
+
 /* Convert a grpc_byte_buffer to a Node.js Buffer */
 v8::Local<v8::Value> ByteBufferToBuffer(grpc_byte_buffer *buffer);
 
+/* Convert a grpc_byte_buffer to an array of Node.js Buffers, one for each
+   slice in the byte buffer. The Buffers reference the slices directly, so
+   nothing is copied */
+v8::Local<v8::Value> ByteBufferToBufferArray(grpc_byte_buffer *buffer);
+
 }  // namespace node
 }  // namespace grpc
 
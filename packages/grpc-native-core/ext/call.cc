@@ -16,23 +16,30 @@
  *
  */
 
+#include <string.h>
+#include <algorithm>
+#include <deque>
 #include <map>
 #include <memory>
 #include <vector>
 
 #include <node.h>
+#include <uv.h>
 
 #include "byte_buffer.h"
 #include "call.h"
 #include "call_credentials.h"
 #include "channel.h"
 #include "completion_queue.h"
+#include "grpc/compression.h"
 #include "grpc/grpc.h"
 #include "grpc/grpc_security.h"
 #include "grpc/support/alloc.h"
 #include "grpc/support/log.h"
+#include "grpc/slice.h"
 #include "grpc/support/time.h"
 #include "slice.h"
+#include "stats.h"
 #include "timeval.h"
 
 using std::unique_ptr;
@@ -66,8 +73,15 @@ using v8::Uint32;
 using v8::String;
 using v8::Value;
 
-Callback *Call::constructor;
 Persistent<FunctionTemplate> Call::fun_tpl;
+Persistent<FunctionTemplate> BatchTemplate::fun_tpl;
+Callback *PreparedMetadata::constructor;
+Persistent<FunctionTemplate> PreparedMetadata::fun_tpl;
+Callback *MetadataView::constructor;
+Persistent<FunctionTemplate> MetadataView::fun_tpl;
+
+// The number of finished tags each BatchTemplate keeps for reuse
+const size_t kMaxPooledTags = 64;
 
 /**
  * Helper function for throwing errors with a grpc_call_error value.
@@ -135,6 +149,76 @@ void DestroyMetadataArray(grpc_metadata_array *array) {
   grpc_metadata_array_destroy(array);
 }
 
+/* Adds an entry to a metadata array, growing it if it is full. The array
+ * takes over the reference to value. */
+static void AppendMetadata(grpc_metadata_array *array, grpc_slice key,
+                           grpc_slice value) {
+  if (array->count == array->capacity) {
+    array->capacity = array->capacity * 2 + 1;
+    array->metadata = reinterpret_cast<grpc_metadata *>(gpr_realloc(
+        array->metadata, array->capacity * sizeof(grpc_metadata)));
+  }
+  grpc_metadata *entry = &array->metadata[array->count++];
+  memset(entry, 0, sizeof(grpc_metadata));
+  entry->key = key;
+  entry->value = value;
+}
+
+/* Adds the entries of a prepared array to an op's own array. Core links the
+ * entries of a batch together through their internal data while it is in
+ * flight, so concurrent calls cannot send the same entries. The keys are
+ * interned, so only the values are reffed. */
+static void CopyMetadataEntries(const grpc_metadata_array *source,
+                                grpc_metadata_array *dest) {
+  for (size_t i = 0; i < source->count; i++) {
+    AppendMetadata(dest, source->metadata[i].key,
+                   grpc_slice_ref(source->metadata[i].value));
+  }
+}
+
+/* Converts a message for sending. The value can be a Buffer, an array of
+ * Buffers to send as one message without concatenating them, or an object
+ * with one of those as its message property and write flags as its flags
+ * property. Without a flags property, the flags come from the message's
+ * grpcWriteFlags property, if it has one. */
+static bool ParseSendMessage(Local<Value> value, grpc_byte_buffer **message,
+                             uint32_t *flags) {
+  Local<Value> message_value = value;
+  Local<Value> flags_value = Nan::Undefined();
+  if (!value->IsArray() && !::node::Buffer::HasInstance(value) &&
+      value->IsObject()) {
+    Local<Object> object_value = Nan::To<Object>(value).ToLocalChecked();
+    message_value =
+        Nan::Get(object_value, Nan::New("message").ToLocalChecked())
+            .ToLocalChecked();
+    flags_value = Nan::Get(object_value, Nan::New("flags").ToLocalChecked())
+                      .ToLocalChecked();
+    if (!flags_value->IsUndefined() && !flags_value->IsUint32()) {
+      return false;
+    }
+  }
+  if (message_value->IsArray()) {
+    *message = BufferArrayToByteBuffer(Local<Array>::Cast(message_value));
+    if (*message == NULL) {
+      return false;
+    }
+  } else if (::node::Buffer::HasInstance(message_value)) {
+    *message = BufferToByteBuffer(message_value);
+  } else {
+    return false;
+  }
+  if (flags_value->IsUndefined()) {
+    flags_value = Nan::Get(Nan::To<Object>(message_value).ToLocalChecked(),
+                           Nan::New("grpcWriteFlags").ToLocalChecked())
+                      .ToLocalChecked();
+  }
+  *flags = 0;
+  if (flags_value->IsUint32()) {
+    *flags = Nan::To<uint32_t>(flags_value).FromJust() & GRPC_WRITE_USED_MASK;
+  }
+  return true;
+}
+
 Local<Value> ParseMetadata(const grpc_metadata_array *metadata_array) {
   EscapableHandleScope scope;
   grpc_metadata *metadata_elements = metadata_array->metadata;
@@ -142,8 +226,7 @@ Local<Value> ParseMetadata(const grpc_metadata_array *metadata_array) {
   Local<Object> metadata_object = Nan::New<Object>();
   for (unsigned int i = 0; i < length; i++) {
     grpc_metadata *elem = &metadata_elements[i];
-    // TODO(murgatroid99): Use zero-copy string construction instead
-    Local<String> key_string = CopyStringFromSlice(elem->key);
+    Local<String> key_string = CachedStringFromSlice(elem->key);
     Local<Array> array;
     MaybeLocal<Value> maybe_array = Nan::Get(metadata_object, key_string);
     if (maybe_array.IsEmpty() || !maybe_array.ToLocalChecked()->IsArray()) {
@@ -162,6 +245,25 @@ Local<Value> ParseMetadata(const grpc_metadata_array *metadata_array) {
   return scope.Escape(metadata_object);
 }
 
+Local<Value> ReceivedMetadataValue(const grpc_metadata_array *metadata_array,
+                                   bool as_view) {
+  EscapableHandleScope scope;
+  if (as_view) {
+    return scope.Escape(MetadataView::Create(metadata_array));
+  }
+  return scope.Escape(ParseMetadata(metadata_array));
+}
+
+bool WantsMetadataView(Local<Value> value) {
+  if (!value->IsObject()) {
+    return false;
+  }
+  MaybeLocal<Value> maybe_view =
+      Nan::Get(Nan::To<Object>(value).ToLocalChecked(),
+               Nan::New("view").ToLocalChecked());
+  return !maybe_view.IsEmpty() && maybe_view.ToLocalChecked()->IsTrue();
+}
+
 Local<Value> Op::GetOpType() const {
   EscapableHandleScope scope;
   return scope.Escape(Nan::New(GetTypeString()).ToLocalChecked());
@@ -169,8 +271,9 @@ Local<Value> Op::GetOpType() const {
 
 Op::~Op() {}
 
-class SendMetadataOp : public Op {
+class SendMetadataOp : public Op, public Pooled<SendMetadataOp> {
  public:
+  static const char *PoolName() { return "sendMetadataOp"; }
   SendMetadataOp() { grpc_metadata_array_init(&send_metadata); }
   ~SendMetadataOp() { DestroyMetadataArray(&send_metadata); }
   Local<Value> GetNodeValue() const {
@@ -178,6 +281,16 @@ class SendMetadataOp : public Op {
     return scope.Escape(Nan::True());
   }
   bool ParseOp(Local<Value> value, grpc_op *out) {
+    if (PreparedMetadata::HasInstance(value)) {
+      shared_ptr<MetadataArray> prepared =
+          ObjectWrap::Unwrap<PreparedMetadata>(
+              Nan::To<Object>(value).ToLocalChecked())
+              ->GetMetadata();
+      CopyMetadataEntries(&prepared->array, &send_metadata);
+      out->data.send_initial_metadata.count = send_metadata.count;
+      out->data.send_initial_metadata.metadata = send_metadata.metadata;
+      return true;
+    }
     if (!value->IsObject()) {
       return false;
     }
@@ -195,6 +308,22 @@ class SendMetadataOp : public Op {
   bool IsFinalOp() { return false; }
   void OnComplete(bool success) {}
 
+  // Asks core to compress the call's messages with algorithm
+  void RequestCompressionAlgorithm(grpc_compression_algorithm algorithm,
+                                   grpc_op *out) {
+    const char *name;
+    if (!grpc_compression_algorithm_name(algorithm, &name)) {
+      return;
+    }
+    AppendMetadata(
+        &send_metadata,
+        grpc_slice_from_static_string(
+            GRPC_COMPRESSION_REQUEST_ALGORITHM_MD_KEY),
+        grpc_slice_from_static_string(name));
+    out->data.send_initial_metadata.count = send_metadata.count;
+    out->data.send_initial_metadata.metadata = send_metadata.metadata;
+  }
+
  protected:
   std::string GetTypeString() const { return "send_metadata"; }
 
@@ -202,8 +331,9 @@ class SendMetadataOp : public Op {
   grpc_metadata_array send_metadata;
 };
 
-class SendMessageOp : public Op {
+class SendMessageOp : public Op, public Pooled<SendMessageOp> {
  public:
+  static const char *PoolName() { return "sendMessageOp"; }
   SendMessageOp() { send_message = NULL; }
   ~SendMessageOp() {
     if (send_message != NULL) {
@@ -215,20 +345,11 @@ class SendMessageOp : public Op {
     return scope.Escape(Nan::True());
   }
   bool ParseOp(Local<Value> value, grpc_op *out) {
-    if (!::node::Buffer::HasInstance(value)) {
+    uint32_t flags;
+    if (!ParseSendMessage(value, &send_message, &flags)) {
       return false;
     }
-    Local<Object> object_value = Nan::To<Object>(value).ToLocalChecked();
-    MaybeLocal<Value> maybe_flag_value =
-        Nan::Get(object_value, Nan::New("grpcWriteFlags").ToLocalChecked());
-    if (!maybe_flag_value.IsEmpty()) {
-      Local<Value> flag_value = maybe_flag_value.ToLocalChecked();
-      if (flag_value->IsUint32()) {
-        Maybe<uint32_t> maybe_flag = Nan::To<uint32_t>(flag_value);
-        out->flags = maybe_flag.FromMaybe(0) & GRPC_WRITE_USED_MASK;
-      }
-    }
-    send_message = BufferToByteBuffer(value);
+    out->flags = flags;
     out->data.send_message.send_message = send_message;
     return true;
   }
@@ -243,8 +364,9 @@ class SendMessageOp : public Op {
   grpc_byte_buffer *send_message;
 };
 
-class SendClientCloseOp : public Op {
+class SendClientCloseOp : public Op, public Pooled<SendClientCloseOp> {
  public:
+  static const char *PoolName() { return "sendClientCloseOp"; }
   Local<Value> GetNodeValue() const {
     EscapableHandleScope scope;
     return scope.Escape(Nan::True());
@@ -258,8 +380,9 @@ class SendClientCloseOp : public Op {
   std::string GetTypeString() const { return "client_close"; }
 };
 
-class SendServerStatusOp : public Op {
+class SendServerStatusOp : public Op, public Pooled<SendServerStatusOp> {
  public:
+  static const char *PoolName() { return "sendServerStatusOp"; }
   SendServerStatusOp() {
     details = grpc_empty_slice();
     grpc_metadata_array_init(&status_metadata);
@@ -287,6 +410,7 @@ class SendServerStatusOp : public Op {
     }
     Local<Object> metadata =
         Nan::To<Object>(maybe_metadata.ToLocalChecked()).ToLocalChecked();
+    bool is_prepared = PreparedMetadata::HasInstance(metadata);
     MaybeLocal<Value> maybe_code =
         Nan::Get(server_status, Nan::New("code").ToLocalChecked());
     if (maybe_code.IsEmpty()) {
@@ -306,7 +430,11 @@ class SendServerStatusOp : public Op {
     }
     Local<String> details =
         Nan::To<String>(maybe_details.ToLocalChecked()).ToLocalChecked();
-    if (!CreateMetadataArray(metadata, &status_metadata)) {
+    if (is_prepared) {
+      CopyMetadataEntries(
+          &ObjectWrap::Unwrap<PreparedMetadata>(metadata)->GetMetadata()->array,
+          &status_metadata);
+    } else if (!CreateMetadataArray(metadata, &status_metadata)) {
       return false;
     }
     out->data.send_status_from_server.trailing_metadata_count =
@@ -330,18 +458,22 @@ class SendServerStatusOp : public Op {
   grpc_metadata_array status_metadata;
 };
 
-class GetMetadataOp : public Op {
+class GetMetadataOp : public Op, public Pooled<GetMetadataOp> {
  public:
-  GetMetadataOp() { grpc_metadata_array_init(&recv_metadata); }
+  static const char *PoolName() { return "getMetadataOp"; }
+  GetMetadataOp() : as_view(false) {
+    grpc_metadata_array_init(&recv_metadata);
+  }
 
   ~GetMetadataOp() { grpc_metadata_array_destroy(&recv_metadata); }
 
   Local<Value> GetNodeValue() const {
     EscapableHandleScope scope;
-    return scope.Escape(ParseMetadata(&recv_metadata));
+    return scope.Escape(ReceivedMetadataValue(&recv_metadata, as_view));
   }
 
   bool ParseOp(Local<Value> value, grpc_op *out) {
+    as_view = WantsMetadataView(value);
     out->data.recv_initial_metadata.recv_initial_metadata = &recv_metadata;
     return true;
   }
@@ -353,11 +485,13 @@ class GetMetadataOp : public Op {
 
  private:
   grpc_metadata_array recv_metadata;
+  bool as_view;
 };
 
-class ReadMessageOp : public Op {
+class ReadMessageOp : public Op, public Pooled<ReadMessageOp> {
  public:
-  ReadMessageOp() { recv_message = NULL; }
+  static const char *PoolName() { return "readMessageOp"; }
+  ReadMessageOp() : recv_message(NULL), as_slices(false) {}
   ~ReadMessageOp() {
     if (recv_message != NULL) {
       grpc_byte_buffer_destroy(recv_message);
@@ -365,10 +499,24 @@ class ReadMessageOp : public Op {
   }
   Local<Value> GetNodeValue() const {
     EscapableHandleScope scope;
+    if (as_slices) {
+      return scope.Escape(ByteBufferToBufferArray(recv_message));
+    }
     return scope.Escape(ByteBufferToBuffer(recv_message));
   }
 
   bool ParseOp(Local<Value> value, grpc_op *out) {
+    /* The value can be an object with a truthy "slices" property to get the
+     * message as an array of Buffers that reference the received slices,
+     * instead of as a single flattened Buffer */
+    if (value->IsObject()) {
+      MaybeLocal<Value> maybe_slices = Nan::Get(
+          Nan::To<Object>(value).ToLocalChecked(),
+          Nan::New("slices").ToLocalChecked());
+      if (!maybe_slices.IsEmpty()) {
+        as_slices = Nan::To<bool>(maybe_slices.ToLocalChecked()).FromJust();
+      }
+    }
     out->data.recv_message.recv_message = &recv_message;
     return true;
   }
@@ -380,11 +528,157 @@ class ReadMessageOp : public Op {
 
  private:
   grpc_byte_buffer *recv_message;
+  bool as_slices;
+};
+
+/* Messages read ahead of the JavaScript stream that is consuming them. The
+ * call keeps one read batch outstanding while the buffered bytes are below
+ * the high water mark, and wakes JavaScript once for each burst of messages
+ * instead of once for each message. */
+struct ReadAheadState {
+  ReadAheadState(Local<Function> callback, size_t high_water_mark)
+      : callback(callback),
+        async_resource("grpc:readAhead"),
+        high_water_mark(high_water_mark),
+        buffered_bytes(0),
+        reading(false),
+        ended(false),
+        failed(false),
+        notified(false) {}
+  ~ReadAheadState() {
+    for (std::deque<grpc_byte_buffer *>::iterator it = messages.begin();
+         it != messages.end(); ++it) {
+      if (*it != NULL) {
+        grpc_byte_buffer_destroy(*it);
+      }
+    }
+  }
+
+  /* Calls the callback with an error if a read failed, or with no arguments
+   * if there are messages that it has not yet been told about */
+  void Notify() {
+    HandleScope scope;
+    if (failed) {
+      failed = false;
+      Local<Value> argv[] = {Nan::Error("A read ahead batch failed")};
+      callback.Call(1, argv, &async_resource);
+    } else if (!notified && !messages.empty()) {
+      notified = true;
+      callback.Call(0, NULL, &async_resource);
+    }
+  }
+
+  Nan::Callback callback;
+  Nan::AsyncResource async_resource;
+  // NULL marks the end of the stream
+  std::deque<grpc_byte_buffer *> messages;
+  size_t high_water_mark;
+  size_t buffered_bytes;
+  // A read ahead batch is outstanding
+  bool reading;
+  // No more reads will be started
+  bool ended;
+  // A read failed, and the callback has not been told yet
+  bool failed;
+  // The callback has been told about the buffered messages
+  bool notified;
 };
 
-class ClientStatusOp : public Op {
+/* The op in the batches that a call starts itself to read ahead. The message
+ * goes to the call's buffer instead of to a JavaScript callback. */
+class ReadAheadOp : public Op, public Pooled<ReadAheadOp> {
  public:
-  ClientStatusOp() {
+  static const char *PoolName() { return "readAheadOp"; }
+  explicit ReadAheadOp(Call *call) : call(call), recv_message(NULL) {}
+  ~ReadAheadOp() {
+    if (recv_message != NULL) {
+      grpc_byte_buffer_destroy(recv_message);
+    }
+  }
+  Local<Value> GetNodeValue() const {
+    EscapableHandleScope scope;
+    return scope.Escape(Nan::Undefined());
+  }
+  bool ParseOp(Local<Value> value, grpc_op *out) {
+    out->data.recv_message.recv_message = &recv_message;
+    return true;
+  }
+  bool IsFinalOp() { return false; }
+  void OnComplete(bool success) {
+    grpc_byte_buffer *message = recv_message;
+    recv_message = NULL;
+    call->OnReadAheadComplete(message, success);
+  }
+
+ protected:
+  std::string GetTypeString() const { return "read"; }
+
+ private:
+  Call *call;
+  grpc_byte_buffer *recv_message;
+};
+
+/* Messages waiting to be sent by a call, in groups that each share one
+ * callback. Only one message can be sent at a time, so each one is started
+ * from the completion of the one before it. */
+struct SendQueueState {
+  struct Entry {
+    grpc_byte_buffer *message;
+    uint32_t flags;
+    // Only set on the last message of a group
+    Nan::Callback *callback;
+  };
+
+  SendQueueState() : async_resource("grpc:sendQueue"), sending(false) {
+    in_flight.message = NULL;
+    in_flight.callback = NULL;
+  }
+  ~SendQueueState() {
+    for (std::deque<Entry>::iterator it = queue.begin(); it != queue.end();
+         ++it) {
+      grpc_byte_buffer_destroy(it->message);
+      delete it->callback;
+    }
+    delete in_flight.callback;
+  }
+
+  Nan::AsyncResource async_resource;
+  std::deque<Entry> queue;
+  // The message being sent. Its op owns the byte buffer
+  Entry in_flight;
+  bool sending;
+};
+
+/* The op in the batches that a call starts itself to send queued messages */
+class QueuedSendOp : public Op, public Pooled<QueuedSendOp> {
+ public:
+  static const char *PoolName() { return "queuedSendOp"; }
+  QueuedSendOp(Call *call, grpc_byte_buffer *send_message)
+      : call(call), send_message(send_message) {}
+  ~QueuedSendOp() { grpc_byte_buffer_destroy(send_message); }
+  Local<Value> GetNodeValue() const {
+    EscapableHandleScope scope;
+    return scope.Escape(Nan::True());
+  }
+  bool ParseOp(Local<Value> value, grpc_op *out) {
+    out->data.send_message.send_message = send_message;
+    return true;
+  }
+  bool IsFinalOp() { return false; }
+  void OnComplete(bool success) { call->OnQueuedSendComplete(success); }
+
+ protected:
+  std::string GetTypeString() const { return "send_message"; }
+
+ private:
+  Call *call;
+  grpc_byte_buffer *send_message;
+};
+
+class ClientStatusOp : public Op, public Pooled<ClientStatusOp> {
+ public:
+  static const char *PoolName() { return "clientStatusOp"; }
+  ClientStatusOp() : as_view(false) {
     grpc_metadata_array_init(&metadata_array);
     status_details = grpc_empty_slice();
   }
@@ -395,6 +689,7 @@ class ClientStatusOp : public Op {
   }
 
   bool ParseOp(Local<Value> value, grpc_op *out) {
+    as_view = WantsMetadataView(value);
     out->data.recv_status_on_client.trailing_metadata = &metadata_array;
     out->data.recv_status_on_client.status = &status;
     out->data.recv_status_on_client.status_details = &status_details;
@@ -409,7 +704,7 @@ class ClientStatusOp : public Op {
     Nan::Set(status_obj, Nan::New("details").ToLocalChecked(),
              CopyStringFromSlice(status_details));
     Nan::Set(status_obj, Nan::New("metadata").ToLocalChecked(),
-             ParseMetadata(&metadata_array));
+             ReceivedMetadataValue(&metadata_array, as_view));
     return scope.Escape(status_obj);
   }
   bool IsFinalOp() { return true; }
@@ -422,10 +717,12 @@ class ClientStatusOp : public Op {
   grpc_metadata_array metadata_array;
   grpc_status_code status;
   grpc_slice status_details;
+  bool as_view;
 };
 
-class ServerCloseResponseOp : public Op {
+class ServerCloseResponseOp : public Op, public Pooled<ServerCloseResponseOp> {
  public:
+  static const char *PoolName() { return "serverCloseResponseOp"; }
   Local<Value> GetNodeValue() const {
     EscapableHandleScope scope;
     return scope.Escape(Nan::New<Boolean>(cancelled));
@@ -445,42 +742,112 @@ class ServerCloseResponseOp : public Op {
   int cancelled;
 };
 
-tag::tag(Callback *callback, OpVec *ops, Call *call, Local<Value> call_value)
+Op *CreateOp(uint32_t type) {
+  switch (type) {
+    case GRPC_OP_SEND_INITIAL_METADATA:
+      return new SendMetadataOp();
+    case GRPC_OP_SEND_MESSAGE:
+      return new SendMessageOp();
+    case GRPC_OP_SEND_CLOSE_FROM_CLIENT:
+      return new SendClientCloseOp();
+    case GRPC_OP_SEND_STATUS_FROM_SERVER:
+      return new SendServerStatusOp();
+    case GRPC_OP_RECV_INITIAL_METADATA:
+      return new GetMetadataOp();
+    case GRPC_OP_RECV_MESSAGE:
+      return new ReadMessageOp();
+    case GRPC_OP_RECV_STATUS_ON_CLIENT:
+      return new ClientStatusOp();
+    case GRPC_OP_RECV_CLOSE_ON_SERVER:
+      return new ServerCloseResponseOp();
+    default:
+      return NULL;
+  }
+}
+
+tag::tag(Local<Function> callback, OpVec *ops, Call *call,
+         Local<Value> call_value)
     : callback(callback),
       async_resource(NULL),
       ops(ops),
-      call(call) {
-  HandleScope scope;
-  async_resource = new Nan::AsyncResource("grpc:tag");  // Needs handle scope.
+      call(call),
+      start_time(0) {
+  if (!callback.IsEmpty()) {
+    InitAsyncResource();
+  }
   call_persist.Reset(call_value);
 }
 
 tag::~tag() {
-  delete callback;
-  delete async_resource;
+  DestroyAsyncResource();
   delete ops;
 }
 
-void CompleteTag(void *tag, const char *error_message) {
-  HandleScope scope;
-  struct tag *tag_struct = reinterpret_cast<struct tag *>(tag);
-  Callback *callback = tag_struct->callback;
-  if (error_message == NULL) {
-    Local<Object> tag_obj = Nan::New<Object>();
-    for (vector<unique_ptr<Op> >::iterator it = tag_struct->ops->begin();
-         it != tag_struct->ops->end(); ++it) {
-      Op *op_ptr = it->get();
-      Nan::Set(tag_obj, op_ptr->GetOpType(), op_ptr->GetNodeValue());
-    }
-    Local<Value> argv[] = {Nan::Null(), tag_obj};
-    callback->Call(2, argv, tag_struct->async_resource);
-  } else {
-    Local<Value> argv[] = {Nan::Error(error_message)};
-    callback->Call(1, argv, tag_struct->async_resource);
+void tag::InitAsyncResource() {
+  HandleScope scope;  // Needed to create the resource
+  async_resource =
+      new (&async_resource_storage) Nan::AsyncResource("grpc:tag");
+}
+
+void tag::DestroyAsyncResource() {
+  if (async_resource != NULL) {
+    async_resource->~AsyncResource();
+    async_resource = NULL;
+  }
+}
+
+/* Records the latency of a call's batch, when its completion has been read
+ * from the completion queue */
+static void RecordBatchCompletion(struct tag *tag_struct, bool success) {
+  if (tag_struct->start_time == 0) {
+    // This tag is not for a call's batch
+    return;
+  }
+  uint64_t latency = uv_hrtime() - tag_struct->start_time;
+  ProcessStats &stats = GetProcessStats();
+  stats.batches_completed.fetch_add(1, std::memory_order_relaxed);
+  if (!success) {
+    stats.batches_failed.fetch_add(1, std::memory_order_relaxed);
+  }
+  stats.batch_latency.Record(latency);
+  MethodStats *method_stats = tag_struct->call->GetMethodStats();
+  if (method_stats != NULL) {
+    if (!success) {
+      method_stats->batches_failed.fetch_add(1, std::memory_order_relaxed);
+    }
+    method_stats->batch_latency.Record(latency);
   }
-  bool success = (error_message == NULL);
+}
+
+/* Gets the arguments to pass to a tag's callback, which are an error, or null
+ * and an object with the results of each op. Returns the number of
+ * arguments. */
+static int GetTagCallbackArgs(struct tag *tag_struct, const char *error_message,
+                              Local<Value> argv[2]) {
+  RecordBatchCompletion(tag_struct, error_message == NULL);
+  if (error_message != NULL) {
+    argv[0] = Nan::Error(error_message);
+    return 1;
+  }
+  uint64_t start = uv_hrtime();
+  Local<Object> tag_obj = Nan::New<Object>();
+  for (OpVec::iterator it = tag_struct->ops->begin();
+       it != tag_struct->ops->end(); ++it) {
+    Op *op_ptr = it->get();
+    Nan::Set(tag_obj, op_ptr->GetOpType(), op_ptr->GetNodeValue());
+  }
+  argv[0] = Nan::Null();
+  argv[1] = tag_obj;
+  GetProcessStats().completion_time.Record(uv_hrtime() - start);
+  return 2;
+}
+
+/* Lets the ops and the call know that the batch has completed. This happens
+ * after the callback has been called, so that the callback can start another
+ * batch on the call before it is cleaned up */
+static void FinishTag(struct tag *tag_struct, bool success) {
   bool is_final_op = false;
-  for (vector<unique_ptr<Op> >::iterator it = tag_struct->ops->begin();
+  for (OpVec::iterator it = tag_struct->ops->begin();
        it != tag_struct->ops->end(); ++it) {
     Op *op_ptr = it->get();
     op_ptr->OnComplete(success);
@@ -494,9 +861,96 @@ void CompleteTag(void *tag, const char *error_message) {
   tag_struct->call->CompleteBatch(is_final_op);
 }
 
+void CompleteTag(void *tag, const char *error_message) {
+  HandleScope scope;
+  struct tag *tag_struct = reinterpret_cast<struct tag *>(tag);
+  if (tag_struct->callback.IsEmpty()) {
+    // The batch was started natively, so only its ops need the result
+    RecordBatchCompletion(tag_struct, error_message == NULL);
+    FinishTag(tag_struct, error_message == NULL);
+    return;
+  }
+  Local<Value> argv[2];
+  int argc = GetTagCallbackArgs(tag_struct, error_message, argv);
+  tag_struct->callback.Call(argc, argv, tag_struct->async_resource);
+  FinishTag(tag_struct, error_message == NULL);
+}
+
+void AppendTagCompletion(void *tag, const char *error_message,
+                         Local<Array> completions) {
+  HandleScope scope;
+  struct tag *tag_struct = reinterpret_cast<struct tag *>(tag);
+  if (tag_struct->callback.IsEmpty()) {
+    RecordBatchCompletion(tag_struct, error_message == NULL);
+    return;
+  }
+  Local<Value> argv[2] = {Nan::Undefined(), Nan::Undefined()};
+  GetTagCallbackArgs(tag_struct, error_message, argv);
+  uint32_t index = completions->Length();
+  Nan::Set(completions, index, tag_struct->callback.GetFunction());
+  Nan::Set(completions, index + 1, argv[0]);
+  Nan::Set(completions, index + 2, argv[1]);
+}
+
+void FinishDeferredTag(void *tag, const char *error_message) {
+  HandleScope scope;
+  FinishTag(reinterpret_cast<struct tag *>(tag), error_message == NULL);
+}
+
 void DestroyTag(void *tag) {
   struct tag *tag_struct = reinterpret_cast<struct tag *>(tag);
-  delete tag_struct;
+  if (tag_struct->pool) {
+    // Keep the pool alive while the tag drops its own reference to it
+    shared_ptr<TagPool> pool = tag_struct->pool;
+    pool->Release(tag_struct);
+  } else {
+    delete tag_struct;
+  }
+}
+
+TagPool::TagPool(size_t max_size) : max_size(max_size) {}
+
+TagPool::~TagPool() {
+  for (vector<struct tag *>::iterator it = free_tags.begin();
+       it != free_tags.end(); ++it) {
+    delete *it;
+  }
+}
+
+struct tag *TagPool::Get(Local<Function> callback, Call *call,
+                         Local<Value> call_value) {
+  struct tag *tag_struct;
+  if (free_tags.empty()) {
+    tag_struct = new struct tag(callback, new OpVec(), call, call_value);
+  } else {
+    tag_struct = free_tags.back();
+    free_tags.pop_back();
+    tag_struct->callback.Reset(callback);
+    // Native batches never call into javascript, so they need no resource
+    if (!callback.IsEmpty()) {
+      tag_struct->InitAsyncResource();
+    }
+    tag_struct->call = call;
+    tag_struct->call_persist.Reset(call_value);
+    tag_struct->start_time = 0;
+  }
+  tag_struct->pool = shared_from_this();
+  return tag_struct;
+}
+
+void TagPool::Release(struct tag *tag_struct) {
+  tag_struct->pool.reset();
+  if (free_tags.size() >= max_size) {
+    delete tag_struct;
+    return;
+  }
+  // Drop everything that belongs to the finished batch, but keep the storage
+  tag_struct->ops->clear();
+  tag_struct->callback.Reset();
+  tag_struct->DestroyAsyncResource();
+  tag_struct->call = NULL;
+  tag_struct->call_persist.Reset();
+  free_tags.push_back(tag_struct);
 }
 
 void Call::DestroyCall() {
@@ -504,13 +958,36 @@ void Call::DestroyCall() {
     grpc_call_unref(this->wrapped_call);
     this->wrapped_call = NULL;
   }
+  if (this->outstanding_calls) {
+    (*this->outstanding_calls)--;
+    this->outstanding_calls.reset();
+  }
 }
 
-Call::Call(grpc_call *call)
-    : wrapped_call(call), pending_batches(0), has_final_op_completed(false) {
-  peer = grpc_call_get_peer(call);
+void Call::SetMethodStats(MethodStats *stats) {
+  stats->calls.fetch_add(1, std::memory_order_relaxed);
+  this->method_stats = stats;
+}
+
+MethodStats *Call::GetMethodStats() { return this->method_stats; }
+
+void Call::TrackOutstanding(shared_ptr<size_t> outstanding_calls) {
+  GPR_ASSERT(!this->outstanding_calls);
+  (*outstanding_calls)++;
+  this->outstanding_calls = outstanding_calls;
 }
 
+Call::Call(grpc_call *call)
+    : wrapped_call(call),
+      pending_batches(0),
+      has_final_op_completed(false),
+      peer(NULL),
+      method_stats(NULL),
+      compression_level_set(false),
+      compression_level(GRPC_COMPRESS_LEVEL_NONE),
+      compression_algorithm_set(false),
+      compression_algorithm(GRPC_COMPRESS_NONE) {}
+
 Call::~Call() {
   DestroyCall();
   gpr_free(peer);
@@ -522,14 +999,19 @@ void Call::Init(Local<Object> exports) {
   tpl->SetClassName(Nan::New("Call").ToLocalChecked());
   tpl->InstanceTemplate()->SetInternalFieldCount(1);
   Nan::SetPrototypeMethod(tpl, "startBatch", StartBatch);
+  Nan::SetPrototypeMethod(tpl, "startBatchFromTemplate",
+                          StartBatchFromTemplate);
   Nan::SetPrototypeMethod(tpl, "cancel", Cancel);
   Nan::SetPrototypeMethod(tpl, "cancelWithStatus", CancelWithStatus);
   Nan::SetPrototypeMethod(tpl, "getPeer", GetPeer);
   Nan::SetPrototypeMethod(tpl, "setCredentials", SetCredentials);
+  Nan::SetPrototypeMethod(tpl, "startReadAhead", StartReadAhead);
+  Nan::SetPrototypeMethod(tpl, "takeMessages", TakeMessages);
+  Nan::SetPrototypeMethod(tpl, "queueMessages", QueueMessages);
+  Nan::SetPrototypeMethod(tpl, "setCompression", SetCompression);
   fun_tpl.Reset(tpl);
   Local<Function> ctr = Nan::GetFunction(tpl).ToLocalChecked();
   Nan::Set(exports, Nan::New("Call").ToLocalChecked(), ctr);
-  constructor = new Callback(ctr);
 }
 
 bool Call::HasInstance(Local<Value> val) {
@@ -544,15 +1026,23 @@ Local<Value> Call::WrapStruct(grpc_call *call) {
   if (call == NULL) {
     return scope.Escape(Nan::Null());
   }
-  const int argc = 1;
-  Local<Value> argv[argc] = {
-      Nan::New<External>(reinterpret_cast<void *>(call))};
+  /* Instantiating the template directly does not go through the JavaScript
+   * constructor, so the call does not have to be boxed in an External and
+   * unboxed again */
   MaybeLocal<Object> maybe_instance =
-      Nan::NewInstance(constructor->GetFunction(), argc, argv);
+      Nan::NewInstance(Nan::New(fun_tpl)->InstanceTemplate());
   if (maybe_instance.IsEmpty()) {
     return scope.Escape(Nan::Null());
-  } else {
-    return scope.Escape(maybe_instance.ToLocalChecked());
+  }
+  Local<Object> instance = maybe_instance.ToLocalChecked();
+  Call *wrapper = new Call(call);
+  wrapper->Wrap(instance);
+  return scope.Escape(instance);
+}
+
+void Call::LoadPeer() {
+  if (peer == NULL && wrapped_call != NULL) {
+    peer = grpc_call_get_peer(wrapped_call);
   }
 }
 
@@ -562,36 +1052,18 @@ void Call::CompleteBatch(bool is_final_op) {
   }
   this->pending_batches--;
   if (this->has_final_op_completed && this->pending_batches == 0) {
+    /* getPeer still works after this, so the peer has to be kept. Holding
+       the core call instead would keep its arena and its channel alive
+       until the wrapper is collected. */
+    this->LoadPeer();
     this->DestroyCall();
   }
 }
 
 NAN_METHOD(Call::New) {
-  /* Arguments:
-   * 0: Channel to make the call on
-   * 1: Method
-   * 2: Deadline
-   * 3: host
-   * 4: parent Call
-   * 5: propagation flags
-   */
-  if (info.IsConstructCall()) {
-    Call *call;
-    if (!info[0]->IsExternal()) {
-      return Nan::ThrowTypeError(
-        "Call can only be created with Channel.createCall");
-    }
-    Local<External> ext = info[0].As<External>();
-    // This option is used for wrapping an existing call
-    grpc_call *call_value = reinterpret_cast<grpc_call *>(ext->Value());
-    call = new Call(call_value);
-    call->Wrap(info.This());
-    info.GetReturnValue().Set(info.This());
-    return;
-  } else {
-    return Nan::ThrowTypeError(
+  // Calls are only created natively, by WrapStruct
+  return Nan::ThrowTypeError(
       "Call can only be created with Channel.createCall");
-  }
 }
 
 NAN_METHOD(Call::StartBatch) {
@@ -619,7 +1091,11 @@ NAN_METHOD(Call::StartBatch) {
   Local<Object> obj = Nan::To<Object>(info[0]).ToLocalChecked();
   Local<Array> keys = Nan::GetOwnPropertyNames(obj).ToLocalChecked();
   size_t nops = keys->Length();
-  vector<grpc_op> ops(nops);
+  // Each op type can only appear once, so more keys than that are an error
+  if (nops > OpVec::kMaxOps) {
+    return Nan::ThrowError("Argument object had an unrecognized key");
+  }
+  grpc_op ops[OpVec::kMaxOps];
   unique_ptr<OpVec> op_vector(new OpVec());
   for (unsigned int i = 0; i < nops; i++) {
     unique_ptr<Op> op;
@@ -632,50 +1108,154 @@ NAN_METHOD(Call::StartBatch) {
     ops[i].op = static_cast<grpc_op_type>(type);
     ops[i].flags = 0;
     ops[i].reserved = NULL;
-    switch (type) {
-      case GRPC_OP_SEND_INITIAL_METADATA:
-        op.reset(new SendMetadataOp());
-        break;
-      case GRPC_OP_SEND_MESSAGE:
-        op.reset(new SendMessageOp());
-        break;
-      case GRPC_OP_SEND_CLOSE_FROM_CLIENT:
-        op.reset(new SendClientCloseOp());
-        break;
-      case GRPC_OP_SEND_STATUS_FROM_SERVER:
-        op.reset(new SendServerStatusOp());
-        break;
-      case GRPC_OP_RECV_INITIAL_METADATA:
-        op.reset(new GetMetadataOp());
-        break;
-      case GRPC_OP_RECV_MESSAGE:
-        op.reset(new ReadMessageOp());
-        break;
-      case GRPC_OP_RECV_STATUS_ON_CLIENT:
-        op.reset(new ClientStatusOp());
-        break;
-      case GRPC_OP_RECV_CLOSE_ON_SERVER:
-        op.reset(new ServerCloseResponseOp());
-        break;
-      default:
-        return Nan::ThrowError("Argument object had an unrecognized key");
+    op.reset(CreateOp(type));
+    if (!op) {
+      return Nan::ThrowError("Argument object had an unrecognized key");
     }
     if (!op->ParseOp(obj->Get(type), &ops[i])) {
       return Nan::ThrowTypeError("Incorrectly typed arguments to startBatch");
     }
+    if (type == GRPC_OP_SEND_INITIAL_METADATA) {
+      call->ApplyCompression(op.get(), &ops[i]);
+    }
     op_vector->push_back(std::move(op));
   }
-  Callback *callback = new Callback(callback_func);
-  grpc_call_error error = grpc_call_start_batch(
-      call->wrapped_call, &ops[0], nops,
-      new struct tag(callback, op_vector.release(), call, info.This()), NULL);
+  struct tag *tag_struct =
+      new struct tag(callback_func, op_vector.release(), call, info.This());
+  tag_struct->start_time = uv_hrtime();
+  grpc_call_error error =
+      grpc_call_start_batch(call->wrapped_call, ops, nops, tag_struct, NULL);
   if (error != GRPC_CALL_OK) {
     return Nan::ThrowError(nanErrorWithCode("startBatch failed", error));
   }
+  GetProcessStats().batches_started.fetch_add(1, std::memory_order_relaxed);
+  call->pending_batches++;
+  CompletionQueueNext();
+}
+
+NAN_METHOD(Call::StartBatchFromTemplate) {
+  /* Arguments:
+   * 0: BatchTemplate describing the ops in the batch
+   * 1: Array of op values, in the same order as the template's op types
+   * 2: Callback
+   */
+  if (!Call::HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "startBatchFromTemplate can only be called on Call objects");
+  }
+  if (!BatchTemplate::HasInstance(info[0])) {
+    return Nan::ThrowTypeError(
+        "startBatchFromTemplate's first argument must be a BatchTemplate");
+  }
+  if (!info[1]->IsArray()) {
+    return Nan::ThrowTypeError(
+        "startBatchFromTemplate's second argument must be an array");
+  }
+  if (!info[2]->IsFunction()) {
+    return Nan::ThrowError(
+        "startBatchFromTemplate's third argument must be a callback");
+  }
+  Local<Function> callback_func = info[2].As<Function>();
+  Call *call = ObjectWrap::Unwrap<Call>(info.This());
+  if (call->wrapped_call == NULL) {
+    // Same behavior as startBatch on a call that has already completed
+    Local<Value> argv[] = {
+        Nan::Error("The async function failed because the call has completed")};
+    Nan::Call(callback_func, Nan::New<Object>(), 1, argv);
+    return;
+  }
+  BatchTemplate *batch_template = ObjectWrap::Unwrap<BatchTemplate>(
+      Nan::To<Object>(info[0]).ToLocalChecked());
+  Local<Array> values = Local<Array>::Cast(info[1]);
+  const vector<grpc_op_type> &op_types = batch_template->GetOpTypes();
+  shared_ptr<TagPool> pool = batch_template->GetTagPool();
+  size_t nops = op_types.size();
+  // Templates never repeat an op type, so the ops always fit
+  grpc_op ops[OpVec::kMaxOps];
+  struct tag *tag_struct = pool->Get(callback_func, call, info.This());
+  for (size_t i = 0; i < nops; i++) {
+    ops[i].op = op_types[i];
+    ops[i].flags = 0;
+    ops[i].reserved = NULL;
+    unique_ptr<Op> op(CreateOp(op_types[i]));
+    if (!op->ParseOp(Nan::Get(values, i).ToLocalChecked(), &ops[i])) {
+      pool->Release(tag_struct);
+      return Nan::ThrowTypeError(
+          "Incorrectly typed arguments to startBatchFromTemplate");
+    }
+    if (op_types[i] == GRPC_OP_SEND_INITIAL_METADATA) {
+      call->ApplyCompression(op.get(), &ops[i]);
+    }
+    tag_struct->ops->push_back(std::move(op));
+  }
+  tag_struct->start_time = uv_hrtime();
+  grpc_call_error error =
+      grpc_call_start_batch(call->wrapped_call, ops, nops, tag_struct, NULL);
+  if (error != GRPC_CALL_OK) {
+    pool->Release(tag_struct);
+    return Nan::ThrowError(
+        nanErrorWithCode("startBatchFromTemplate failed", error));
+  }
+  GetProcessStats().batches_started.fetch_add(1, std::memory_order_relaxed);
   call->pending_batches++;
   CompletionQueueNext();
 }
 
+void Call::ApplyCompression(Op *op, grpc_op *out) {
+  if (compression_level_set) {
+    out->data.send_initial_metadata.maybe_compression_level.is_set = 1;
+    out->data.send_initial_metadata.maybe_compression_level.level =
+        compression_level;
+  }
+  if (compression_algorithm_set) {
+    static_cast<SendMetadataOp *>(op)->RequestCompressionAlgorithm(
+        compression_algorithm, out);
+  }
+}
+
+NAN_METHOD(Call::SetCompression) {
+  /* Arguments:
+   * 0: A compression level from grpc.compressionLevel, which core turns into
+   *    an algorithm the peer supports, or the name of an algorithm such as
+   *    "gzip", or null to go back to the channel's default
+   * Takes effect for the initial metadata sent after this is called. Core
+   * only accepts levels on server calls, so on a client call a level makes
+   * the batch that sends the initial metadata fail.
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "setCompression can only be called on Call objects");
+  }
+  Call *call = ObjectWrap::Unwrap<Call>(info.This());
+  if (info[0]->IsNull()) {
+    call->compression_level_set = false;
+    call->compression_algorithm_set = false;
+  } else if (info[0]->IsUint32()) {
+    uint32_t level = Nan::To<uint32_t>(info[0]).FromJust();
+    if (level >= GRPC_COMPRESS_LEVEL_COUNT) {
+      return Nan::ThrowRangeError("setCompression got an unknown level");
+    }
+    call->compression_level_set = true;
+    call->compression_level = static_cast<grpc_compression_level>(level);
+    call->compression_algorithm_set = false;
+  } else if (info[0]->IsString()) {
+    Nan::Utf8String name(info[0]);
+    grpc_slice name_slice = grpc_slice_from_copied_string(*name);
+    grpc_compression_algorithm algorithm;
+    int found = grpc_compression_algorithm_parse(name_slice, &algorithm);
+    grpc_slice_unref(name_slice);
+    if (!found) {
+      return Nan::ThrowRangeError("setCompression got an unknown algorithm");
+    }
+    call->compression_algorithm_set = true;
+    call->compression_algorithm = algorithm;
+    call->compression_level_set = false;
+  } else {
+    return Nan::ThrowTypeError(
+        "setCompression's argument must be a number, a string, or null");
+  }
+}
+
 NAN_METHOD(Call::Cancel) {
   if (!Call::HasInstance(info.This())) {
     return Nan::ThrowTypeError("cancel can only be called on Call objects");
@@ -727,6 +1307,7 @@ NAN_METHOD(Call::GetPeer) {
     return Nan::ThrowTypeError("getPeer can only be called on Call objects");
   }
   Call *call = ObjectWrap::Unwrap<Call>(info.This());
+  call->LoadPeer();
   Local<Value> peer_value = Nan::New(call->peer).ToLocalChecked();
   info.GetReturnValue().Set(peer_value);
 }
@@ -756,5 +1337,600 @@ NAN_METHOD(Call::SetCredentials) {
   info.GetReturnValue().Set(Nan::New<Uint32>(error));
 }
 
+grpc_call_error Call::ContinueReadAhead() {
+  ReadAheadState *state = read_ahead.get();
+  if (state->reading || state->ended ||
+      state->buffered_bytes >= state->high_water_mark) {
+    return GRPC_CALL_OK;
+  }
+  if (wrapped_call == NULL) {
+    return GRPC_CALL_ERROR;
+  }
+  HandleScope scope;
+  grpc_op op;
+  op.op = GRPC_OP_RECV_MESSAGE;
+  op.flags = 0;
+  op.reserved = NULL;
+  unique_ptr<Op> read_op(new ReadAheadOp(this));
+  read_op->ParseOp(Nan::Undefined(), &op);
+  unique_ptr<OpVec> op_vector(new OpVec());
+  op_vector->push_back(std::move(read_op));
+  // An empty callback means that nothing is called in JavaScript
+  struct tag *tag_struct = new struct tag(
+      Local<Function>(), op_vector.release(), this, handle());
+  tag_struct->start_time = uv_hrtime();
+  grpc_call_error error =
+      grpc_call_start_batch(wrapped_call, &op, 1, tag_struct, NULL);
+  if (error != GRPC_CALL_OK) {
+    DestroyTag(tag_struct);
+    return error;
+  }
+  GetProcessStats().batches_started.fetch_add(1, std::memory_order_relaxed);
+  pending_batches++;
+  state->reading = true;
+  CompletionQueueNext();
+  return GRPC_CALL_OK;
+}
+
+void Call::EndReadAhead(bool failed) {
+  ReadAheadState *state = read_ahead.get();
+  state->ended = true;
+  if (failed) {
+    state->failed = true;
+  } else {
+    state->messages.push_back(NULL);
+  }
+}
+
+void Call::OnReadAheadComplete(grpc_byte_buffer *message, bool success) {
+  ReadAheadState *state = read_ahead.get();
+  state->reading = false;
+  if (!success) {
+    EndReadAhead(true);
+  } else if (message == NULL) {
+    EndReadAhead(false);
+  } else {
+    state->buffered_bytes += grpc_byte_buffer_length(message);
+    state->messages.push_back(message);
+    if (ContinueReadAhead() != GRPC_CALL_OK) {
+      EndReadAhead(true);
+    }
+  }
+  state->Notify();
+}
+
+NAN_METHOD(Call::StartReadAhead) {
+  /* Arguments:
+   * 0: High water mark, in bytes. Reads stop while this many bytes of
+   *    messages are buffered, until they are taken with takeMessages
+   * 1: Callback, which is called when messages are available, or with an
+   *    error if a read fails
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "startReadAhead can only be called on Call objects");
+  }
+  if (!info[0]->IsUint32()) {
+    return Nan::ThrowTypeError(
+        "startReadAhead's first argument must be a non-negative integer");
+  }
+  if (!info[1]->IsFunction()) {
+    return Nan::ThrowTypeError(
+        "startReadAhead's second argument must be a function");
+  }
+  Call *call = ObjectWrap::Unwrap<Call>(info.This());
+  if (call->read_ahead) {
+    return Nan::ThrowError("startReadAhead has already been called");
+  }
+  Local<Function> callback = info[1].As<Function>();
+  if (call->wrapped_call == NULL) {
+    // Fail the same way that startBatch does on a completed call
+    Local<Value> argv[] = {
+        Nan::Error("The async function failed because the call has completed")};
+    Nan::Call(callback, Nan::New<Object>(), 1, argv);
+    return;
+  }
+  // Always read at least one message, even with a high water mark of 0
+  size_t high_water_mark =
+      std::max<uint32_t>(Nan::To<uint32_t>(info[0]).FromJust(), 1);
+  call->read_ahead.reset(new ReadAheadState(callback, high_water_mark));
+  grpc_call_error error = call->ContinueReadAhead();
+  if (error != GRPC_CALL_OK) {
+    call->read_ahead.reset();
+    return Nan::ThrowError(nanErrorWithCode("startReadAhead failed", error));
+  }
+}
+
+NAN_METHOD(Call::TakeMessages) {
+  /* Returns an array of the buffered messages, in order. A null element
+   * marks the end of the stream. Taking the messages makes room for more
+   * reads. */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "takeMessages can only be called on Call objects");
+  }
+  Call *call = ObjectWrap::Unwrap<Call>(info.This());
+  ReadAheadState *state = call->read_ahead.get();
+  if (state == NULL) {
+    return Nan::ThrowError(
+        "takeMessages can only be called after startReadAhead");
+  }
+  state->buffered_bytes = 0;
+  state->notified = false;
+  if (call->ContinueReadAhead() != GRPC_CALL_OK) {
+    // The call has finished, so there will be no more messages
+    call->EndReadAhead(false);
+  }
+  std::deque<grpc_byte_buffer *> messages;
+  messages.swap(state->messages);
+  Local<Array> result = Nan::New<Array>(static_cast<int>(messages.size()));
+  for (size_t i = 0; i < messages.size(); i++) {
+    if (messages[i] == NULL) {
+      Nan::Set(result, static_cast<uint32_t>(i), Nan::Null());
+    } else {
+      Nan::Set(result, static_cast<uint32_t>(i),
+               ByteBufferToBuffer(messages[i]));
+      grpc_byte_buffer_destroy(messages[i]);
+    }
+  }
+  info.GetReturnValue().Set(result);
+}
+
+grpc_call_error Call::ContinueSending() {
+  SendQueueState *state = send_queue.get();
+  if (state->sending || state->queue.empty()) {
+    return GRPC_CALL_OK;
+  }
+  if (wrapped_call == NULL) {
+    return GRPC_CALL_ERROR;
+  }
+  HandleScope scope;
+  SendQueueState::Entry entry = state->queue.front();
+  state->queue.pop_front();
+  grpc_op op;
+  op.op = GRPC_OP_SEND_MESSAGE;
+  /* Core holds a hinted write, and its completion, until a later write
+     flushes it, but the next message is only sent once this one completes */
+  op.flags = entry.flags & ~GRPC_WRITE_BUFFER_HINT;
+  op.reserved = NULL;
+  unique_ptr<Op> send_op(new QueuedSendOp(this, entry.message));
+  send_op->ParseOp(Nan::Undefined(), &op);
+  unique_ptr<OpVec> op_vector(new OpVec());
+  op_vector->push_back(std::move(send_op));
+  state->in_flight.message = NULL;
+  state->in_flight.callback = entry.callback;
+  state->sending = true;
+  struct tag *tag_struct = new struct tag(
+      Local<Function>(), op_vector.release(), this, handle());
+  tag_struct->start_time = uv_hrtime();
+  grpc_call_error error =
+      grpc_call_start_batch(wrapped_call, &op, 1, tag_struct, NULL);
+  if (error != GRPC_CALL_OK) {
+    // The in flight entry's callback is failed along with the queue
+    state->sending = false;
+    DestroyTag(tag_struct);
+    return error;
+  }
+  GetProcessStats().batches_started.fetch_add(1, std::memory_order_relaxed);
+  pending_batches++;
+  CompletionQueueNext();
+  return GRPC_CALL_OK;
+}
+
+void Call::FailQueuedSends() {
+  SendQueueState *state = send_queue.get();
+  vector<Nan::Callback *> callbacks;
+  if (state->in_flight.callback != NULL) {
+    callbacks.push_back(state->in_flight.callback);
+    state->in_flight.callback = NULL;
+  }
+  for (std::deque<SendQueueState::Entry>::iterator it = state->queue.begin();
+       it != state->queue.end(); ++it) {
+    grpc_byte_buffer_destroy(it->message);
+    if (it->callback != NULL) {
+      callbacks.push_back(it->callback);
+    }
+  }
+  state->queue.clear();
+  HandleScope scope;
+  for (size_t i = 0; i < callbacks.size(); i++) {
+    Local<Value> argv[] = {Nan::Error("A queued write failed")};
+    callbacks[i]->Call(1, argv, &state->async_resource);
+    delete callbacks[i];
+  }
+}
+
+void Call::OnQueuedSendComplete(bool success) {
+  SendQueueState *state = send_queue.get();
+  state->sending = false;
+  if (!success) {
+    FailQueuedSends();
+    return;
+  }
+  Nan::Callback *callback = state->in_flight.callback;
+  state->in_flight.callback = NULL;
+  // Start the next send before running JavaScript, so the network is not idle
+  if (ContinueSending() != GRPC_CALL_OK) {
+    FailQueuedSends();
+  }
+  if (callback != NULL) {
+    HandleScope scope;
+    callback->Call(0, NULL, &state->async_resource);
+    delete callback;
+  }
+}
+
+NAN_METHOD(Call::QueueMessages) {
+  /* Arguments:
+   * 0: Array of messages, in any of the forms that startBatch accepts for
+   *    SEND_MESSAGE
+   * 1: Callback, which is called once all of the messages have been sent, or
+   *    with an error if any of them or any earlier queued message fails
+   * Messages can be queued while earlier ones are still being sent. They are
+   * sent in order, and must not be mixed with messages sent with startBatch.
+   * Their BUFFER_HINT write flags are ignored.
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "queueMessages can only be called on Call objects");
+  }
+  if (!info[0]->IsArray()) {
+    return Nan::ThrowTypeError(
+        "queueMessages's first argument must be an array of Buffers");
+  }
+  if (!info[1]->IsFunction()) {
+    return Nan::ThrowTypeError(
+        "queueMessages's second argument must be a function");
+  }
+  Local<Array> messages = Local<Array>::Cast(info[0]);
+  uint32_t count = messages->Length();
+  if (count == 0) {
+    return Nan::ThrowError("queueMessages requires at least one message");
+  }
+  Call *call = ObjectWrap::Unwrap<Call>(info.This());
+  Local<Function> callback = info[1].As<Function>();
+  if (call->wrapped_call == NULL) {
+    // Fail the same way that startBatch does on a completed call
+    Local<Value> argv[] = {
+        Nan::Error("The async function failed because the call has completed")};
+    Nan::Call(callback, Nan::New<Object>(), 1, argv);
+    return;
+  }
+  // Convert every message before queueing any, so that a bad one queues none
+  vector<SendQueueState::Entry> entries(count);
+  for (uint32_t i = 0; i < count; i++) {
+    if (!ParseSendMessage(Nan::Get(messages, i).ToLocalChecked(),
+                          &entries[i].message, &entries[i].flags)) {
+      for (uint32_t j = 0; j < i; j++) {
+        grpc_byte_buffer_destroy(entries[j].message);
+      }
+      return Nan::ThrowTypeError(
+          "queueMessages's first argument must be an array of messages");
+    }
+    entries[i].callback = NULL;
+  }
+  entries[count - 1].callback = new Nan::Callback(callback);
+  if (!call->send_queue) {
+    call->send_queue.reset(new SendQueueState());
+  }
+  call->send_queue->queue.insert(call->send_queue->queue.end(),
+                                 entries.begin(), entries.end());
+  grpc_call_error error = call->ContinueSending();
+  if (error != GRPC_CALL_OK) {
+    call->FailQueuedSends();
+  }
+}
+
+BatchTemplate::BatchTemplate(const vector<grpc_op_type> &op_types)
+    : op_types(op_types), tag_pool(new TagPool(kMaxPooledTags)) {}
+
+BatchTemplate::~BatchTemplate() {}
+
+void BatchTemplate::Init(Local<Object> exports) {
+  HandleScope scope;
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("BatchTemplate").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  fun_tpl.Reset(tpl);
+  Local<Function> ctr = Nan::GetFunction(tpl).ToLocalChecked();
+  Nan::Set(exports, Nan::New("BatchTemplate").ToLocalChecked(), ctr);
+}
+
+bool BatchTemplate::HasInstance(Local<Value> val) {
+  HandleScope scope;
+  return Nan::New(fun_tpl)->HasInstance(val);
+}
+
+const vector<grpc_op_type> &BatchTemplate::GetOpTypes() const {
+  return op_types;
+}
+
+shared_ptr<TagPool> BatchTemplate::GetTagPool() const { return tag_pool; }
+
+NAN_METHOD(BatchTemplate::New) {
+  /* Arguments:
+   * 0: Array of op types
+   */
+  if (!info.IsConstructCall()) {
+    return Nan::ThrowTypeError(
+        "BatchTemplate can only be created with the new operator");
+  }
+  if (!info[0]->IsArray()) {
+    return Nan::ThrowTypeError(
+        "BatchTemplate's argument must be an array of op types");
+  }
+  Local<Array> types = Local<Array>::Cast(info[0]);
+  vector<grpc_op_type> op_types;
+  uint32_t seen_types = 0;
+  for (uint32_t i = 0; i < types->Length(); i++) {
+    Local<Value> type_value = Nan::Get(types, i).ToLocalChecked();
+    if (!type_value->IsUint32()) {
+      return Nan::ThrowTypeError("BatchTemplate's op types must be integers");
+    }
+    uint32_t type = Nan::To<uint32_t>(type_value).FromJust();
+    if (type > GRPC_OP_RECV_CLOSE_ON_SERVER) {
+      return Nan::ThrowError("BatchTemplate got an unrecognized op type");
+    }
+    if (seen_types & (1u << type)) {
+      return Nan::ThrowError("BatchTemplate got a repeated op type");
+    }
+    seen_types |= (1u << type);
+    op_types.push_back(static_cast<grpc_op_type>(type));
+  }
+  BatchTemplate *batch_template = new BatchTemplate(op_types);
+  batch_template->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+PreparedMetadata::PreparedMetadata(shared_ptr<MetadataArray> metadata)
+    : metadata(metadata) {}
+
+PreparedMetadata::~PreparedMetadata() {}
+
+void PreparedMetadata::Init(Local<Object> exports) {
+  HandleScope scope;
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("PreparedMetadata").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Nan::SetPrototypeMethod(tpl, "append", Append);
+  fun_tpl.Reset(tpl);
+  Local<Function> ctr = Nan::GetFunction(tpl).ToLocalChecked();
+  Nan::Set(exports, Nan::New("PreparedMetadata").ToLocalChecked(), ctr);
+  constructor = new Callback(ctr);
+}
+
+bool PreparedMetadata::HasInstance(Local<Value> val) {
+  HandleScope scope;
+  return Nan::New(fun_tpl)->HasInstance(val);
+}
+
+shared_ptr<MetadataArray> PreparedMetadata::GetMetadata() const {
+  return metadata;
+}
+
+NAN_METHOD(PreparedMetadata::New) {
+  /* Arguments:
+   * 0: Metadata object, in the same format that startBatch accepts. If this
+   *    is not provided, the metadata is empty
+   */
+  if (!info.IsConstructCall()) {
+    return Nan::ThrowTypeError(
+        "PreparedMetadata can only be created with the new operator");
+  }
+  shared_ptr<MetadataArray> metadata(new MetadataArray());
+  if (info[0]->IsObject()) {
+    if (!CreateMetadataArray(Nan::To<Object>(info[0]).ToLocalChecked(),
+                             &metadata->array)) {
+      return Nan::ThrowTypeError(
+          "PreparedMetadata's argument must be a valid metadata object");
+    }
+  } else if (!info[0]->IsUndefined()) {
+    return Nan::ThrowTypeError(
+        "PreparedMetadata's argument must be an object, if provided");
+  }
+  PreparedMetadata *prepared = new PreparedMetadata(metadata);
+  prepared->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+/* Returns a new PreparedMetadata with this object's entries, followed by the
+ * entries in the argument. Only the new entries are converted, and the
+ * existing values are shared with this object. */
+NAN_METHOD(PreparedMetadata::Append) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "append can only be called on PreparedMetadata objects");
+  }
+  if (!info[0]->IsObject()) {
+    return Nan::ThrowTypeError("append's argument must be an object");
+  }
+  PreparedMetadata *prepared =
+      ObjectWrap::Unwrap<PreparedMetadata>(info.This());
+  grpc_metadata_array extra;
+  grpc_metadata_array_init(&extra);
+  if (!CreateMetadataArray(Nan::To<Object>(info[0]).ToLocalChecked(),
+                           &extra)) {
+    DestroyMetadataArray(&extra);
+    return Nan::ThrowTypeError(
+        "append's argument must be a valid metadata object");
+  }
+  MaybeLocal<Object> maybe_instance =
+      Nan::NewInstance(constructor->GetFunction(), 0, NULL);
+  if (maybe_instance.IsEmpty()) {
+    // There's probably a pending exception
+    DestroyMetadataArray(&extra);
+    return;
+  }
+  Local<Object> instance = maybe_instance.ToLocalChecked();
+  shared_ptr<MetadataArray> combined(new MetadataArray());
+  const grpc_metadata_array *base = &prepared->metadata->array;
+  combined->array.capacity = base->count + extra.count;
+  combined->array.metadata = reinterpret_cast<grpc_metadata *>(
+      gpr_zalloc(combined->array.capacity * sizeof(grpc_metadata)));
+  for (size_t i = 0; i < base->count; i++) {
+    // Keys are interned, so only the values need another reference
+    combined->array.metadata[i] = base->metadata[i];
+    grpc_slice_ref(combined->array.metadata[i].value);
+  }
+  // The new entries' slices move to the combined array
+  memcpy(combined->array.metadata + base->count, extra.metadata,
+         extra.count * sizeof(grpc_metadata));
+  combined->array.count = combined->array.capacity;
+  grpc_metadata_array_destroy(&extra);
+  ObjectWrap::Unwrap<PreparedMetadata>(instance)->metadata = combined;
+  info.GetReturnValue().Set(instance);
+}
+
+MetadataView::MetadataView() { grpc_metadata_array_init(&array); }
+
+MetadataView::~MetadataView() {
+  for (size_t i = 0; i < array.count; i++) {
+    grpc_slice_unref(array.metadata[i].key);
+    grpc_slice_unref(array.metadata[i].value);
+  }
+  grpc_metadata_array_destroy(&array);
+}
+
+void MetadataView::Init(Local<Object> exports) {
+  HandleScope scope;
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("MetadataView").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Nan::SetPrototypeMethod(tpl, "get", Get);
+  Nan::SetPrototypeMethod(tpl, "getAll", GetAll);
+  Nan::SetPrototypeMethod(tpl, "keys", Keys);
+  Nan::SetPrototypeMethod(tpl, "toObject", ToObject);
+  fun_tpl.Reset(tpl);
+  Local<Function> ctr = Nan::GetFunction(tpl).ToLocalChecked();
+  Nan::Set(exports, Nan::New("MetadataView").ToLocalChecked(), ctr);
+  constructor = new Callback(ctr);
+}
+
+bool MetadataView::HasInstance(Local<Value> val) {
+  HandleScope scope;
+  return Nan::New(fun_tpl)->HasInstance(val);
+}
+
+Local<Value> MetadataView::Create(const grpc_metadata_array *metadata_array) {
+  EscapableHandleScope scope;
+  MaybeLocal<Object> maybe_instance =
+      Nan::NewInstance(constructor->GetFunction(), 0, NULL);
+  if (maybe_instance.IsEmpty()) {
+    return scope.Escape(Nan::Null());
+  }
+  Local<Object> instance = maybe_instance.ToLocalChecked();
+  MetadataView *view = ObjectWrap::Unwrap<MetadataView>(instance);
+  size_t count = metadata_array->count;
+  if (count > 0) {
+    view->array.metadata = reinterpret_cast<grpc_metadata *>(
+        gpr_malloc(count * sizeof(grpc_metadata)));
+    view->array.capacity = count;
+    view->array.count = count;
+    /* Received slices belong to the call, so both halves of each entry need
+     * their own references */
+    for (size_t i = 0; i < count; i++) {
+      view->array.metadata[i] = metadata_array->metadata[i];
+      grpc_slice_ref(view->array.metadata[i].key);
+      grpc_slice_ref(view->array.metadata[i].value);
+    }
+  }
+  return scope.Escape(instance);
+}
+
+static Local<Value> MetadataValueFromEntry(const grpc_metadata *entry) {
+  EscapableHandleScope scope;
+  if (grpc_is_binary_header(entry->key)) {
+    return scope.Escape(CreateBufferFromSlice(entry->value));
+  }
+  return scope.Escape(CopyStringFromSlice(entry->value));
+}
+
+NAN_METHOD(MetadataView::New) {
+  // Views are normally created natively, for received metadata
+  if (!info.IsConstructCall()) {
+    return Nan::ThrowTypeError(
+        "MetadataView can only be created with the new operator");
+  }
+  MetadataView *view = new MetadataView();
+  view->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+/* Returns the first value for the key, or undefined if there is none. The
+ * key must already be normalized to lowercase. */
+NAN_METHOD(MetadataView::Get) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "get can only be called on MetadataView objects");
+  }
+  if (!info[0]->IsString()) {
+    return Nan::ThrowTypeError("get's argument must be a string");
+  }
+  MetadataView *view = ObjectWrap::Unwrap<MetadataView>(info.This());
+  Utf8String key(info[0]);
+  for (size_t i = 0; i < view->array.count; i++) {
+    if (grpc_slice_str_cmp(view->array.metadata[i].key, *key) == 0) {
+      info.GetReturnValue().Set(
+          MetadataValueFromEntry(&view->array.metadata[i]));
+      return;
+    }
+  }
+}
+
+// Returns a new array of every value for the key, in the order received
+NAN_METHOD(MetadataView::GetAll) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "getAll can only be called on MetadataView objects");
+  }
+  if (!info[0]->IsString()) {
+    return Nan::ThrowTypeError("getAll's argument must be a string");
+  }
+  MetadataView *view = ObjectWrap::Unwrap<MetadataView>(info.This());
+  Utf8String key(info[0]);
+  Local<Array> values = Nan::New<Array>();
+  uint32_t length = 0;
+  for (size_t i = 0; i < view->array.count; i++) {
+    if (grpc_slice_str_cmp(view->array.metadata[i].key, *key) == 0) {
+      Nan::Set(values, length++,
+               MetadataValueFromEntry(&view->array.metadata[i]));
+    }
+  }
+  info.GetReturnValue().Set(values);
+}
+
+// Returns each distinct key once, in the order they were first received
+NAN_METHOD(MetadataView::Keys) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "keys can only be called on MetadataView objects");
+  }
+  MetadataView *view = ObjectWrap::Unwrap<MetadataView>(info.This());
+  const grpc_metadata *entries = view->array.metadata;
+  Local<Array> keys = Nan::New<Array>();
+  uint32_t length = 0;
+  for (size_t i = 0; i < view->array.count; i++) {
+    bool seen = false;
+    for (size_t j = 0; j < i && !seen; j++) {
+      seen = grpc_slice_eq(entries[j].key, entries[i].key);
+    }
+    if (!seen) {
+      Nan::Set(keys, length++, CachedStringFromSlice(entries[i].key));
+    }
+  }
+  info.GetReturnValue().Set(keys);
+}
+
+/* Returns a full copy of the metadata, in the same format as batch results
+ * that are not views */
+NAN_METHOD(MetadataView::ToObject) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "toObject can only be called on MetadataView objects");
+  }
+  MetadataView *view = ObjectWrap::Unwrap<MetadataView>(info.This());
+  info.GetReturnValue().Set(ParseMetadata(&view->array));
+}
+
 }  // namespace node
 }  // namespace grpc
@@ -20,6 +20,7 @@
 #define NET_GRPC_NODE_CALL_H_
 
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 #include <nan.h>
@@ -28,6 +29,8 @@
 #include "grpc/support/log.h"
 
 #include "channel.h"
+#include "pool_allocator.h"
+#include "stats.h"
 
 namespace grpc {
 namespace node {
@@ -44,9 +47,31 @@ bool CreateMetadataArray(v8::Local<v8::Object> metadata,
 
 void DestroyMetadataArray(grpc_metadata_array *array);
 
-/* Wrapper class for grpc_call structs. */
-class Call : public Nan::ObjectWrap {
+/* A converted metadata array that owns its value slices, so that it can be
+   shared by PreparedMetadata objects. The ops that send it copy its entries,
+   because core writes to the entries of a batch while it is in flight. */
+class MetadataArray {
  public:
+  MetadataArray() { grpc_metadata_array_init(&array); }
+  ~MetadataArray() { DestroyMetadataArray(&array); }
+
+  grpc_metadata_array array;
+
+ private:
+  // Prevent copying
+  MetadataArray(const MetadataArray &);
+  MetadataArray &operator=(const MetadataArray &);
+};
+
+class Op;
+struct ReadAheadState;
+struct SendQueueState;
+
+/* Wrapper class for grpc_call structs. The wrappers are allocated from a
+   free list, so the memory of released calls is reused for new ones. */
+class Call : public Nan::ObjectWrap, public Pooled<Call> {
+ public:
+  static const char *PoolName() { return "call"; }
   static void Init(v8::Local<v8::Object> exports);
   static bool HasInstance(v8::Local<v8::Value> val);
   /* Wrap a grpc_call struct in a javascript object */
@@ -56,6 +81,24 @@ class Call : public Nan::ObjectWrap {
 
   void CompleteBatch(bool is_final_op);
 
+  /* Counts this call in outstanding_calls until the call is destroyed, or
+     until its final op and all of its other batches have completed */
+  void TrackOutstanding(shared_ptr<size_t> outstanding_calls);
+
+  /* Counts this call towards stats, and records the latency of its batches
+     there as well as in the process stats */
+  void SetMethodStats(MethodStats *stats);
+  // Returns NULL if this call is not counted towards any method's stats
+  MethodStats *GetMethodStats();
+
+  /* Buffers a message received by a read ahead batch, or the end of the
+     stream if message is NULL, and starts the next read if there is room */
+  void OnReadAheadComplete(grpc_byte_buffer *message, bool success);
+
+  /* Calls the callback for the queued message that was just sent, if it was
+     the last of its group, and sends the next one */
+  void OnQueuedSendComplete(bool success);
+
  private:
   explicit Call(grpc_call *call);
   ~Call();
@@ -65,14 +108,38 @@ class Call : public Nan::ObjectWrap {
   Call &operator=(const Call &);
 
   void DestroyCall();
+  /* Gets the peer from core the first time it is needed. This must happen
+     before the call is destroyed, so completed calls always load it, and only
+     calls that are collected before they complete skip the lookup */
+  void LoadPeer();
+
+  /* Starts a read ahead batch, unless one is already outstanding, the stream
+     has ended, or the buffered messages are at the high water mark */
+  grpc_call_error ContinueReadAhead();
+  void EndReadAhead(bool failed);
+
+  /* Sends the next queued message, unless one is already being sent. The
+     messages are never sent with GRPC_WRITE_BUFFER_HINT, because each one is
+     only sent once the one before it has completed. */
+  grpc_call_error ContinueSending();
+  // Drops every queued message, and fails the callbacks of their groups
+  void FailQueuedSends();
+
+  /* Adds the compression settings from setCompression to an op that sends
+     initial metadata */
+  void ApplyCompression(Op *op, grpc_op *out);
 
   static NAN_METHOD(New);
   static NAN_METHOD(StartBatch);
+  static NAN_METHOD(StartBatchFromTemplate);
   static NAN_METHOD(Cancel);
   static NAN_METHOD(CancelWithStatus);
   static NAN_METHOD(GetPeer);
   static NAN_METHOD(SetCredentials);
-  static Nan::Callback *constructor;
+  static NAN_METHOD(StartReadAhead);
+  static NAN_METHOD(TakeMessages);
+  static NAN_METHOD(QueueMessages);
+  static NAN_METHOD(SetCompression);
   // Used for typechecking instances of this javascript class
   static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
 
@@ -84,6 +151,18 @@ class Call : public Nan::ObjectWrap {
      is GRPC_OP_SEND_STATUS_FROM_SERVER */
   bool has_final_op_completed;
   char *peer;
+  // The counter this call is included in, if any
+  shared_ptr<size_t> outstanding_calls;
+  MethodStats *method_stats;
+  // Only set after startReadAhead has been called
+  unique_ptr<ReadAheadState> read_ahead;
+  // Only set after queueMessages has been called
+  unique_ptr<SendQueueState> send_queue;
+  // Set by setCompression, and sent with the call's initial metadata
+  bool compression_level_set;
+  grpc_compression_level compression_level;
+  bool compression_algorithm_set;
+  grpc_compression_algorithm compression_algorithm;
 };
 
 class Op {
@@ -99,23 +178,201 @@ class Op {
   virtual std::string GetTypeString() const = 0;
 };
 
-typedef std::vector<unique_ptr<Op>> OpVec;
-struct tag {
-  tag(Nan::Callback *callback, OpVec *ops, Call *call,
+/* The ops in a single batch. A batch has at most one op of each type, so the
+   storage is inline and sized to hold every op type. */
+class OpVec : public Pooled<OpVec> {
+ public:
+  typedef unique_ptr<Op> *iterator;
+  static const size_t kMaxOps = GRPC_OP_RECV_CLOSE_ON_SERVER + 1;
+
+  OpVec() : count(0) {}
+
+  void push_back(unique_ptr<Op> op) {
+    GPR_ASSERT(count < kMaxOps);
+    ops[count++] = std::move(op);
+  }
+  iterator begin() { return ops; }
+  iterator end() { return ops + count; }
+  size_t size() const { return count; }
+  void clear() {
+    for (size_t i = 0; i < count; i++) {
+      ops[i].reset();
+    }
+    count = 0;
+  }
+
+  static const char *PoolName() { return "opVec"; }
+
+ private:
+  // Prevent copying
+  OpVec(const OpVec &);
+  OpVec &operator=(const OpVec &);
+
+  unique_ptr<Op> ops[kMaxOps];
+  size_t count;
+};
+
+class TagPool;
+
+struct tag : public Pooled<tag> {
+  tag(v8::Local<v8::Function> callback, OpVec *ops, Call *call,
       v8::Local<v8::Value> call_value);
   ~tag();
-  Nan::Callback *callback;
+  /* Creates and destroys the async resource in place, so that a tag can be
+     reused for another batch */
+  void InitAsyncResource();
+  void DestroyAsyncResource();
+  static const char *PoolName() { return "tag"; }
+  Nan::Callback callback;
+  // Points into async_resource_storage, to avoid a separate allocation
   Nan::AsyncResource *async_resource;
   OpVec *ops;
   Call *call;
   Nan::Persistent<v8::Value, Nan::CopyablePersistentTraits<v8::Value>>
       call_persist;
+  // The pool this tag is returned to when it is destroyed, if any
+  shared_ptr<TagPool> pool;
+  /* When the batch was started, from uv_hrtime, or 0 if this tag is not for
+     a call's batch */
+  uint64_t start_time;
+
+ private:
+  std::aligned_storage<sizeof(Nan::AsyncResource),
+                                alignof(Nan::AsyncResource)>::type
+      async_resource_storage;
+};
+
+/* Holds finished tags, with their callbacks and op vectors, so that they can
+   be reused by later batches instead of being reallocated */
+class TagPool : public std::enable_shared_from_this<TagPool> {
+ public:
+  explicit TagPool(size_t max_size);
+  ~TagPool();
+  tag *Get(v8::Local<v8::Function> callback, Call *call,
+           v8::Local<v8::Value> call_value);
+  void Release(tag *tag_struct);
+
+ private:
+  // Prevent copying
+  TagPool(const TagPool &);
+  TagPool &operator=(const TagPool &);
+
+  size_t max_size;
+  std::vector<tag *> free_tags;
 };
 
+/* A fixed list of op types that is checked once, so that batches with the
+   same shape can be started by passing only the op values, in order */
+class BatchTemplate : public Nan::ObjectWrap {
+ public:
+  static void Init(v8::Local<v8::Object> exports);
+  static bool HasInstance(v8::Local<v8::Value> val);
+
+  const std::vector<grpc_op_type> &GetOpTypes() const;
+  shared_ptr<TagPool> GetTagPool() const;
+
+ private:
+  explicit BatchTemplate(const std::vector<grpc_op_type> &op_types);
+  ~BatchTemplate();
+
+  // Prevent copying
+  BatchTemplate(const BatchTemplate &);
+  BatchTemplate &operator=(const BatchTemplate &);
+
+  static NAN_METHOD(New);
+  // Used for typechecking instances of this javascript class
+  static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
+
+  std::vector<grpc_op_type> op_types;
+  shared_ptr<TagPool> tag_pool;
+};
+
+/* Returns a new Op for the given op type, or NULL if the type is not one that
+   can be used in a batch */
+Op *CreateOp(uint32_t type);
+
+/* Metadata that is converted to core's representation once, when it is
+   created, so that it can be sent on any number of calls without being
+   converted again. It can be used wherever startBatch accepts a metadata
+   object. */
+class PreparedMetadata : public Nan::ObjectWrap {
+ public:
+  static void Init(v8::Local<v8::Object> exports);
+  static bool HasInstance(v8::Local<v8::Value> val);
+
+  shared_ptr<MetadataArray> GetMetadata() const;
+
+ private:
+  explicit PreparedMetadata(shared_ptr<MetadataArray> metadata);
+  ~PreparedMetadata();
+
+  // Prevent copying
+  PreparedMetadata(const PreparedMetadata &);
+  PreparedMetadata &operator=(const PreparedMetadata &);
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(Append);
+  static Nan::Callback *constructor;
+  // Used for typechecking instances of this javascript class
+  static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
+
+  shared_ptr<MetadataArray> metadata;
+};
+
+/* A read-only view of received metadata. The entries are only converted to
+   JavaScript values when they are read, so handlers that read few or none of
+   them do not pay to convert all of them. The view holds its own references
+   to the slices, so it stays valid after the call is destroyed. */
+class MetadataView : public Nan::ObjectWrap {
+ public:
+  static void Init(v8::Local<v8::Object> exports);
+  static bool HasInstance(v8::Local<v8::Value> val);
+  // Returns a new view of the entries of array
+  static v8::Local<v8::Value> Create(const grpc_metadata_array *array);
+
+ private:
+  MetadataView();
+  ~MetadataView();
+
+  // Prevent copying
+  MetadataView(const MetadataView &);
+  MetadataView &operator=(const MetadataView &);
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(Get);
+  static NAN_METHOD(GetAll);
+  static NAN_METHOD(Keys);
+  static NAN_METHOD(ToObject);
+  static Nan::Callback *constructor;
+  // Used for typechecking instances of this javascript class
+  static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
+
+  grpc_metadata_array array;
+};
+
+/* Converts received metadata for a batch result: to a MetadataView if as_view
+   is true, and otherwise to an object in the format that ParseMetadata
+   returns */
+v8::Local<v8::Value> ReceivedMetadataValue(
+    const grpc_metadata_array *metadata_array, bool as_view);
+
+/* Whether the value passed to startBatch for an op that receives metadata
+   asks for a MetadataView, which it does with {view: true} */
+bool WantsMetadataView(v8::Local<v8::Value> value);
+
 void DestroyTag(void *tag);
 
 void CompleteTag(void *tag, const char *error_message);
 
+/* The two halves of CompleteTag, for delivering many completions to JS at
+   once. AppendTagCompletion appends the tag's callback and the two arguments
+   it would have been called with to completions, and FinishDeferredTag must
+   be called for the tag after those have been passed to JS. */
+void AppendTagCompletion(void *tag, const char *error_message,
+                         v8::Local<v8::Array> completions);
+
+void FinishDeferredTag(void *tag, const char *error_message);
+
 }  // namespace node
 }  // namespace grpc
 
@@ -20,6 +20,7 @@
 #include <node.h>
 #include <uv.h>
 
+#include <cmath>
 #include <queue>
 
 #include "call.h"
@@ -50,6 +51,8 @@ using v8::Object;
 using v8::ObjectTemplate;
 using v8::Value;
 
+using std::shared_ptr;
+
 Nan::Callback *CallCredentials::constructor;
 Persistent<FunctionTemplate> CallCredentials::fun_tpl;
 
@@ -146,14 +149,38 @@ NAN_METHOD(CallCredentials::Compose) {
 }
 
 NAN_METHOD(CallCredentials::CreateFromPlugin) {
+  /* Arguments:
+   * 0: Function that generates metadata
+   * 1: Number of milliseconds that successful results are cached for, for
+   *    each service URL (optional, defaults to 0, which disables caching)
+   */
   if (!info[0]->IsFunction()) {
     return Nan::ThrowTypeError(
-        "createFromPlugin's argument must be a function");
+        "createFromPlugin's first argument must be a function");
+  }
+  double cache_ttl = 0;
+  if (!info[1]->IsUndefined()) {
+    if (!info[1]->IsNumber()) {
+      return Nan::ThrowTypeError(
+          "createFromPlugin's second argument must be a number");
+    }
+    cache_ttl = Nan::To<double>(info[1]).FromJust();
+    if (!(cache_ttl >= 0)) {
+      return Nan::ThrowRangeError(
+          "createFromPlugin's second argument must not be negative");
+    }
   }
   grpc_metadata_credentials_plugin plugin;
   plugin_state *state = new plugin_state;
   state->callback = new Nan::Callback(info[0].As<Function>());
   state->pending_callbacks = new std::queue<plugin_callback_data *>();
+  state->metadata_cache = new std::map<std::string, plugin_cache_entry>();
+  if (std::isinf(cache_ttl)) {
+    state->cache_ttl = gpr_inf_future(GPR_TIMESPAN);
+  } else {
+    state->cache_ttl = gpr_time_from_micros(
+        static_cast<int64_t>(cache_ttl * 1000), GPR_TIMESPAN);
+  }
   uv_mutex_init(&state->plugin_mutex);
   uv_async_init(uv_default_loop(), &state->plugin_async, SendPluginCallback);
   uv_unref((uv_handle_t *)&state->plugin_async);
@@ -191,8 +218,9 @@ NAN_METHOD(PluginCallback) {
       static_cast<grpc_status_code>(Nan::To<uint32_t>(info[0]).FromJust());
   Utf8String details_utf8_str(info[1]);
   char *details = *details_utf8_str;
-  grpc_metadata_array array;
-  grpc_metadata_array_init(&array);
+  // The converted metadata is kept if it is cached
+  shared_ptr<MetadataArray> metadata(new MetadataArray());
+  grpc_metadata_array &array = metadata->array;
   Local<Object> callback_data = Nan::To<Object>(info[3]).ToLocalChecked();
   if (!CreateMetadataArray(Nan::To<Object>(info[2]).ToLocalChecked(), &array)) {
     return Nan::ThrowError("Failed to parse metadata");
@@ -209,7 +237,28 @@ NAN_METHOD(PluginCallback) {
           .As<External>()
           ->Value();
   cb(user_data, array.metadata, array.count, code, details);
-  DestroyMetadataArray(&array);
+  if (code != GRPC_STATUS_OK) {
+    return;
+  }
+  plugin_state *state = reinterpret_cast<plugin_state *>(
+      Nan::Get(callback_data, Nan::New("state").ToLocalChecked())
+          .ToLocalChecked()
+          .As<External>()
+          ->Value());
+  if (gpr_time_cmp(state->cache_ttl, gpr_time_0(GPR_TIMESPAN)) == 0) {
+    return;
+  }
+  Utf8String service_url(
+      Nan::Get(callback_data, Nan::New("service_url").ToLocalChecked())
+          .ToLocalChecked());
+  plugin_cache_entry entry;
+  entry.metadata = metadata;
+  entry.expiration =
+      gpr_time_add(gpr_now(GPR_CLOCK_MONOTONIC), state->cache_ttl);
+  uv_mutex_lock(&state->plugin_mutex);
+  (*state->metadata_cache)[std::string(*service_url, service_url.length())] =
+      entry;
+  uv_mutex_unlock(&state->plugin_mutex);
 }
 
 NAUV_WORK_CB(SendPluginCallback) {
@@ -227,6 +276,10 @@ NAUV_WORK_CB(SendPluginCallback) {
              Nan::New<v8::External>(reinterpret_cast<void *>(data->cb)));
     Nan::Set(callback_data, Nan::New("user_data").ToLocalChecked(),
              Nan::New<v8::External>(data->user_data));
+    Nan::Set(callback_data, Nan::New("state").ToLocalChecked(),
+             Nan::New<v8::External>(reinterpret_cast<void *>(state)));
+    Nan::Set(callback_data, Nan::New("service_url").ToLocalChecked(),
+             Nan::New(data->service_url).ToLocalChecked());
     const int argc = 3;
     v8::Local<v8::Value> argv[argc] = {
         Nan::New(data->service_url).ToLocalChecked(), callback_data,
@@ -238,6 +291,38 @@ NAUV_WORK_CB(SendPluginCallback) {
   }
 }
 
+/* Copies the cached metadata for service_url into creds_md, with new
+ * references that core takes over. Returns false if nothing unexpired is
+ * cached, or if there are too many entries to return synchronously. */
+static bool GetCachedMetadata(
+    plugin_state *state, const char *service_url,
+    grpc_metadata creds_md[GRPC_METADATA_CREDENTIALS_PLUGIN_SYNC_MAX],
+    size_t *num_creds_md) {
+  if (gpr_time_cmp(state->cache_ttl, gpr_time_0(GPR_TIMESPAN)) == 0) {
+    return false;
+  }
+  bool found = false;
+  gpr_timespec now = gpr_now(GPR_CLOCK_MONOTONIC);
+  uv_mutex_lock(&state->plugin_mutex);
+  std::map<std::string, plugin_cache_entry>::iterator it =
+      state->metadata_cache->find(service_url);
+  if (it != state->metadata_cache->end() &&
+      gpr_time_cmp(now, it->second.expiration) < 0) {
+    const grpc_metadata_array &array = it->second.metadata->array;
+    if (array.count <= GRPC_METADATA_CREDENTIALS_PLUGIN_SYNC_MAX) {
+      for (size_t i = 0; i < array.count; i++) {
+        creds_md[i] = array.metadata[i];
+        grpc_slice_ref(creds_md[i].key);
+        grpc_slice_ref(creds_md[i].value);
+      }
+      *num_creds_md = array.count;
+      found = true;
+    }
+  }
+  uv_mutex_unlock(&state->plugin_mutex);
+  return found;
+}
+
 int plugin_get_metadata(
     void *state, grpc_auth_metadata_context context,
     grpc_credentials_plugin_metadata_cb cb,
@@ -245,8 +330,14 @@ int plugin_get_metadata(
     grpc_metadata creds_md[GRPC_METADATA_CREDENTIALS_PLUGIN_SYNC_MAX],
     size_t *num_creds_md, grpc_status_code *status,
     const char **error_details) {
-  HandleScope scope;
   plugin_state *p_state = reinterpret_cast<plugin_state *>(state);
+  if (GetCachedMetadata(p_state, context.service_url, creds_md,
+                        num_creds_md)) {
+    *status = GRPC_STATUS_OK;
+    *error_details = NULL;
+    return 1;  // Synchronous processing.
+  }
+  HandleScope scope;
   plugin_callback_data *data =
       new plugin_callback_data(context.service_url, cb, user_data);
 
@@ -263,6 +354,7 @@ void plugin_uv_close_cb(uv_handle_t *handle) {
   plugin_state *state = reinterpret_cast<plugin_state *>(async->data);
   uv_mutex_destroy(&state->plugin_mutex);
   delete state->pending_callbacks;
+  delete state->metadata_cache;
   delete state->callback;
   delete state;
 }
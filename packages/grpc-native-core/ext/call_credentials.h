@@ -19,16 +19,22 @@
 #ifndef GRPC_NODE_CALL_CREDENTIALS_H_
 #define GRPC_NODE_CALL_CREDENTIALS_H_
 
+#include <map>
+#include <memory>
 #include <queue>
+#include <string>
 
 #include <nan.h>
 #include <node.h>
 #include <uv.h>
 #include "grpc/grpc_security.h"
+#include "grpc/support/time.h"
 
 namespace grpc {
 namespace node {
 
+class MetadataArray;
+
 class CallCredentials : public Nan::ObjectWrap {
  public:
   static void Init(v8::Local<v8::Object> exports);
@@ -82,9 +88,19 @@ typedef struct plugin_callback_data {
   Nan::AsyncResource *async_resource;
 } plugin_callback_data;
 
+typedef struct plugin_cache_entry {
+  std::shared_ptr<MetadataArray> metadata;
+  gpr_timespec expiration;
+} plugin_cache_entry;
+
 typedef struct plugin_state {
   Nan::Callback *callback;
   std::queue<plugin_callback_data *> *pending_callbacks;
+  /* Successful results, keyed by service URL, that can be returned
+   * synchronously until they expire. Guarded by plugin_mutex. */
+  std::map<std::string, plugin_cache_entry> *metadata_cache;
+  // How long results are cached for. Caching is disabled if this is zero
+  gpr_timespec cache_ttl;
   uv_mutex_t plugin_mutex;
   // async.data == this
   uv_async_t plugin_async;
@@ -25,10 +25,13 @@
 #include "call.h"
 #include "channel.h"
 #include "channel_credentials.h"
+#include "channelz.h"
 #include "completion_queue.h"
 #include "grpc/grpc.h"
 #include "grpc/grpc_security.h"
+#include "resource_quota.h"
 #include "slice.h"
+#include "stats.h"
 #include "timeval.h"
 
 namespace grpc {
@@ -54,6 +57,9 @@ using v8::Object;
 using v8::String;
 using v8::Value;
 
+// The most methods any one channel will keep registered call handles for
+const size_t kMaxRegisteredCalls = 1024;
+
 Callback *Channel::constructor;
 Persistent<FunctionTemplate> Channel::fun_tpl;
 
@@ -135,8 +141,17 @@ bool ParseChannelArgs(Local<Value> args_val,
         memcpy(channel_args->args[i].value.string, *val_str,
               val_str.length() + 1);
       }
+    } else if (strcmp(*key_str, GRPC_ARG_RESOURCE_QUOTA) == 0 &&
+               ResourceQuota::HasInstance(value)) {
+      /* Core copies the args with the quota's vtable, which takes its own
+       * ref, so the arg does not need one */
+      channel_args->args[i].type = GRPC_ARG_POINTER;
+      channel_args->args[i].value.pointer.p =
+          ResourceQuota::GetWrappedQuota(value);
+      channel_args->args[i].value.pointer.vtable =
+          grpc_resource_quota_arg_vtable();
     } else {
-      // The value does not match either of the accepted types
+      // The value does not match any of the accepted types
       return false;
     }
     channel_args->args[i].key =
@@ -172,6 +187,27 @@ void DeallocateChannelArgs(grpc_channel_args *channel_args) {
 
 Channel::Channel(grpc_channel *channel) : wrapped_channel(channel) {}
 
+void *Channel::GetRegisteredCall(const char *method, const char *host) {
+  std::string key(method);
+  if (host != NULL) {
+    // Method paths cannot contain NUL, so this keeps the keys distinct
+    key.push_back('\0');
+    key.append(host);
+  }
+  std::unordered_map<std::string, void *>::iterator it =
+      registered_calls.find(key);
+  if (it != registered_calls.end()) {
+    return it->second;
+  }
+  if (registered_calls.size() >= kMaxRegisteredCalls) {
+    return NULL;
+  }
+  void *handle =
+      grpc_channel_register_call(wrapped_channel, method, host, NULL);
+  registered_calls[key] = handle;
+  return handle;
+}
+
 Channel::~Channel() {
   gpr_log(GPR_DEBUG, "Destroying channel");
   if (wrapped_channel != NULL) {
@@ -187,6 +223,7 @@ void Channel::Init(Local<Object> exports) {
   Nan::SetPrototypeMethod(tpl, "close", Close);
   Nan::SetPrototypeMethod(tpl, "getTarget", GetTarget);
   Nan::SetPrototypeMethod(tpl, "getConnectivityState", GetConnectivityState);
+  Nan::SetPrototypeMethod(tpl, "getChannelz", GetChannelz);
   Nan::SetPrototypeMethod(tpl, "watchConnectivityState",
                           WatchConnectivityState);
   Nan::SetPrototypeMethod(tpl, "createCall", CreateCall);
@@ -225,7 +262,8 @@ NAN_METHOD(Channel::New) {
       DeallocateChannelArgs(channel_args_ptr);
       return Nan::ThrowTypeError(
           "Channel options must be an object with "
-          "string keys and integer or string values");
+          "string keys and integer or string values, or a ResourceQuota "
+          "for grpc.resource_quota");
     }
     if (creds == NULL) {
       wrapped_channel =
@@ -261,6 +299,7 @@ NAN_METHOD(Channel::Close) {
   if (channel->wrapped_channel != NULL) {
     grpc_channel_destroy(channel->wrapped_channel);
     channel->wrapped_channel = NULL;
+    channel->registered_calls.clear();
   }
 }
 
@@ -294,6 +333,20 @@ NAN_METHOD(Channel::GetConnectivityState) {
       channel->wrapped_channel, try_to_connect));
 }
 
+NAN_METHOD(Channel::GetChannelz) {
+  /* Returns the channel's channelz data, with its call counts, last call time
+   * and the ids of its subchannels, or null if channelz is disabled */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "getChannelz can only be called on Channel objects");
+  }
+  Channel *channel = ObjectWrap::Unwrap<Channel>(info.This());
+  if (channel->wrapped_channel == NULL) {
+    return Nan::ThrowError("Cannot call getChannelz on a closed Channel");
+  }
+  info.GetReturnValue().Set(GetChannelChannelz(channel->wrapped_channel));
+}
+
 NAN_METHOD(Channel::WatchConnectivityState) {
   if (!HasInstance(info.This())) {
     return Nan::ThrowTypeError(
@@ -320,16 +373,28 @@ NAN_METHOD(Channel::WatchConnectivityState) {
       Nan::To<uint32_t>(info[0]).FromJust());
   double deadline = Nan::To<double>(info[1]).FromJust();
   Local<Function> callback_func = info[2].As<Function>();
-  Nan::Callback *callback = new Callback(callback_func);
   unique_ptr<OpVec> ops(new OpVec());
   grpc_channel_watch_connectivity_state(
       channel->wrapped_channel, last_state, MillisecondsToTimespec(deadline),
       GetCompletionQueue(),
-      new struct tag(callback, ops.release(), NULL, Nan::Null()));
+      new struct tag(callback_func, ops.release(), NULL, Nan::Null()));
   CompletionQueueNext();
 }
 
 NAN_METHOD(Channel::CreateCall) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "createCall can only be called on Channel objects");
+  }
+  Channel *channel = ObjectWrap::Unwrap<Channel>(info.This());
+  Local<Value> call = CreateCallFromArgs(channel, info);
+  if (!call.IsEmpty()) {
+    info.GetReturnValue().Set(call);
+  }
+}
+
+Local<Value> Channel::CreateCallFromArgs(
+    Channel *channel, const Nan::FunctionCallbackInfo<Value> &info) {
   /* Arguments:
    * 0: Method
    * 1: Deadline
@@ -337,16 +402,15 @@ NAN_METHOD(Channel::CreateCall) {
    * 3: parent Call
    * 4: propagation flags
    */
-  if (!HasInstance(info.This())) {
-    return Nan::ThrowTypeError(
-        "createCall can only be called on Channel objects");
-  }
+  EscapableHandleScope scope;
   if (!info[0]->IsString()){
-    return Nan::ThrowTypeError("createCall's first argument must be a string");
+    Nan::ThrowTypeError("createCall's first argument must be a string");
+    return Local<Value>();
   }
   if (!(info[1]->IsNumber() || info[1]->IsDate())) {
-    return Nan::ThrowTypeError(
+    Nan::ThrowTypeError(
       "createcall's second argument must be a date or a number");
+    return Local<Value>();
   }
   // These arguments are at the end because they are optional
   grpc_call *parent_call = NULL;
@@ -355,42 +419,64 @@ NAN_METHOD(Channel::CreateCall) {
         ObjectWrap::Unwrap<Call>(Nan::To<Object>(info[3]).ToLocalChecked());
     parent_call = parent_obj->GetWrappedCall();
   } else if (!(info[3]->IsUndefined() || info[3]->IsNull())) {
-    return Nan::ThrowTypeError(
+    Nan::ThrowTypeError(
         "createCall's fourth argument must be another call, if provided");
+    return Local<Value>();
   }
   uint32_t propagate_flags = GRPC_PROPAGATE_DEFAULTS;
   if (info[4]->IsUint32()) {
     propagate_flags = Nan::To<uint32_t>(info[4]).FromJust();
   } else if (!(info[4]->IsUndefined() || info[4]->IsNull())) {
-    return Nan::ThrowTypeError(
+    Nan::ThrowTypeError(
         "createCall's fifth argument must be propagate flags, if provided");
+    return Local<Value>();
   }
-  Channel *channel = ObjectWrap::Unwrap<Channel>(info.This());
   grpc_channel *wrapped_channel = channel->GetWrappedChannel();
   if (wrapped_channel == NULL) {
-    return Nan::ThrowError("Cannot createCall with a closed Channel");
+    Nan::ThrowError("Cannot createCall with a closed Channel");
+    return Local<Value>();
+  }
+  if (!(info[2]->IsString() || info[2]->IsUndefined() || info[2]->IsNull())) {
+    Nan::ThrowTypeError("createCall's third argument must be a string");
+    return Local<Value>();
   }
-  grpc_slice method =
-      CreateSliceFromString(Nan::To<String>(info[0]).ToLocalChecked());
   double deadline = Nan::To<double>(info[1]).FromJust();
+  Utf8String method(info[0]);
   grpc_call *wrapped_call = NULL;
+  void *registered_call;
   if (info[2]->IsString()) {
-    grpc_slice *host = new grpc_slice;
-    *host =
-        CreateSliceFromString(Nan::To<String>(info[3]).ToLocalChecked());
-    wrapped_call = grpc_channel_create_call(
-        wrapped_channel, parent_call, propagate_flags, GetCompletionQueue(),
-        method, host, MillisecondsToTimespec(deadline), NULL);
-    delete host;
-  } else if (info[2]->IsUndefined() || info[2]->IsNull()) {
-    wrapped_call = grpc_channel_create_call(
+    registered_call = channel->GetRegisteredCall(*method, *Utf8String(info[2]));
+  } else {
+    registered_call = channel->GetRegisteredCall(*method, NULL);
+  }
+  if (registered_call != NULL) {
+    wrapped_call = grpc_channel_create_registered_call(
         wrapped_channel, parent_call, propagate_flags, GetCompletionQueue(),
-        method, NULL, MillisecondsToTimespec(deadline), NULL);
+        registered_call, MillisecondsToTimespec(deadline), NULL);
   } else {
-    return Nan::ThrowTypeError("createCall's third argument must be a string");
+    grpc_slice method_slice =
+        CreateSliceFromString(Nan::To<String>(info[0]).ToLocalChecked());
+    if (info[2]->IsString()) {
+      grpc_slice host =
+          CreateSliceFromString(Nan::To<String>(info[2]).ToLocalChecked());
+      wrapped_call = grpc_channel_create_call(
+          wrapped_channel, parent_call, propagate_flags, GetCompletionQueue(),
+          method_slice, &host, MillisecondsToTimespec(deadline), NULL);
+      grpc_slice_unref(host);
+    } else {
+      wrapped_call = grpc_channel_create_call(
+          wrapped_channel, parent_call, propagate_flags, GetCompletionQueue(),
+          method_slice, NULL, MillisecondsToTimespec(deadline), NULL);
+    }
+    grpc_slice_unref(method_slice);
+  }
+  Local<Value> call = Call::WrapStruct(wrapped_call);
+  MethodStats *method_stats = GetMethodStats(*method, method.length());
+  if (method_stats != NULL && Call::HasInstance(call)) {
+    ObjectWrap::Unwrap<Call>(Nan::To<Object>(call).ToLocalChecked())
+        ->SetMethodStats(method_stats);
   }
-  grpc_slice_unref(method);
-  info.GetReturnValue().Set(Call::WrapStruct(wrapped_call));
+  return scope.Escape(call);
 }
 
 }  // namespace node
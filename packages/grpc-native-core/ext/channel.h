@@ -19,6 +19,9 @@
 #ifndef NET_GRPC_NODE_CHANNEL_H_
 #define NET_GRPC_NODE_CHANNEL_H_
 
+#include <string>
+#include <unordered_map>
+
 #include <nan.h>
 #include <node.h>
 #include "grpc/grpc.h"
@@ -26,6 +29,8 @@
 namespace grpc {
 namespace node {
 
+/* Converts a javascript object to channel args. Values must be integers or
+   strings, except for grpc.resource_quota, which must be a ResourceQuota */
 bool ParseChannelArgs(v8::Local<v8::Value> args_val,
                       grpc_channel_args **channel_args_ptr);
 
@@ -44,6 +49,9 @@ class Channel : public Nan::ObjectWrap {
   grpc_channel *GetWrappedChannel();
 
  private:
+  // Channel pools own their channels directly, without javascript wrappers
+  friend class ChannelPool;
+
   explicit Channel(grpc_channel *channel);
   ~Channel();
 
@@ -55,12 +63,25 @@ class Channel : public Nan::ObjectWrap {
   static NAN_METHOD(Close);
   static NAN_METHOD(GetTarget);
   static NAN_METHOD(GetConnectivityState);
+  static NAN_METHOD(GetChannelz);
   static NAN_METHOD(WatchConnectivityState);
   static NAN_METHOD(CreateCall);
+  /* Creates a call on channel from createCall's arguments. Returns an empty
+     handle after throwing if the arguments are invalid. */
+  static v8::Local<v8::Value> CreateCallFromArgs(
+      Channel *channel, const Nan::FunctionCallbackInfo<v8::Value> &info);
   static Nan::Callback *constructor;
   static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
 
+  /* Returns the handle from grpc_channel_register_call for the given method
+     and host, registering them the first time they are used. Returns NULL
+     once too many distinct methods have been registered. */
+  void *GetRegisteredCall(const char *method, const char *host);
+
   grpc_channel *wrapped_channel;
+  /* Registered call handles, keyed by method and host. The handles belong to
+     the channel, so they are only valid until it is closed. */
+  std::unordered_map<std::string, void *> registered_calls;
 };
 
 }  // namespace node
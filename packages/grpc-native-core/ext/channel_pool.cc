@@ -0,0 +1,389 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <string.h>
+#include <memory>
+#include <vector>
+
+#include <nan.h>
+#include <node.h>
+#include "call.h"
+#include "channel.h"
+#include "channel_credentials.h"
+#include "channel_pool.h"
+#include "completion_queue.h"
+#include "grpc/grpc.h"
+#include "grpc/grpc_security.h"
+#include "grpc/support/log.h"
+#include "grpc/support/time.h"
+
+namespace grpc {
+namespace node {
+
+using Nan::Callback;
+using Nan::HandleScope;
+using Nan::MaybeLocal;
+using Nan::ObjectWrap;
+using Nan::Persistent;
+using Nan::Utf8String;
+
+using std::shared_ptr;
+using std::vector;
+
+using v8::Array;
+using v8::Function;
+using v8::FunctionTemplate;
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+/* Each channel in a pool gets its index as the value of this argument, which
+   makes the channels' subchannel keys differ, so that each channel has its
+   own connections */
+static const char kChannelPoolIndexArg[] = "grpc-node.channel_pool_index";
+
+// How long each connectivity watch on a pooled channel lasts
+const int64_t kConnectivityWatchMs = 1000;
+
+Callback *ChannelPool::constructor;
+Persistent<FunctionTemplate> ChannelPool::fun_tpl;
+Callback *ChannelPool::watch_callback;
+
+class ConnectivityWatchOp : public Op {
+ public:
+  ConnectivityWatchOp(shared_ptr<ChannelPool::PooledChannel> pooled,
+                      shared_ptr<ChannelPool::ChannelList> unwatched)
+      : pooled(pooled), unwatched(unwatched) {}
+
+  ~ConnectivityWatchOp() {}
+
+  Local<Value> GetNodeValue() const { return Nan::Null(); }
+
+  bool ParseOp(Local<Value> value, grpc_op *out) { return true; }
+  bool IsFinalOp() { return false; }
+  void OnComplete(bool success) {
+    pooled->watching = false;
+    if (pooled->channel == NULL) {
+      // The pool was closed while the watch was pending
+      return;
+    }
+    /* This does not start another watch, because a channel that cannot
+       connect changes state indefinitely, and a pending watch keeps the
+       process alive. The next call on the pool starts a new watch. */
+    pooled->state = grpc_channel_check_connectivity_state(
+        pooled->channel->GetWrappedChannel(), 0);
+    unwatched->push_back(pooled);
+  }
+
+ protected:
+  std::string GetTypeString() const { return "connectivity"; }
+
+ private:
+  shared_ptr<ChannelPool::PooledChannel> pooled;
+  shared_ptr<ChannelPool::ChannelList> unwatched;
+};
+
+static NAN_METHOD(IgnoreConnectivityChange) {}
+
+ChannelPool::ChannelPool(const vector<grpc_channel *> &wrapped_channels,
+                         bool least_outstanding)
+    : unwatched(new ChannelList()),
+      next_index(0),
+      least_outstanding(least_outstanding) {
+  for (size_t i = 0; i < wrapped_channels.size(); i++) {
+    shared_ptr<PooledChannel> pooled(new PooledChannel());
+    pooled->channel = new Channel(wrapped_channels[i]);
+    pooled->outstanding_calls.reset(new size_t(0));
+    pooled->state = GRPC_CHANNEL_IDLE;
+    pooled->watching = false;
+    channels.push_back(pooled);
+    unwatched->push_back(pooled);
+  }
+}
+
+ChannelPool::~ChannelPool() { DestroyChannels(); }
+
+void ChannelPool::DestroyChannels() {
+  /* Pending connectivity watches keep their PooledChannel alive, so the
+     channels are destroyed directly, which also ends those watches */
+  for (size_t i = 0; i < channels.size(); i++) {
+    delete channels[i]->channel;
+    channels[i]->channel = NULL;
+  }
+  channels.clear();
+  unwatched->clear();
+}
+
+void ChannelPool::Init(Local<Object> exports) {
+  HandleScope scope;
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("ChannelPool").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Nan::SetPrototypeMethod(tpl, "close", Close);
+  Nan::SetPrototypeMethod(tpl, "getTarget", GetTarget);
+  Nan::SetPrototypeMethod(tpl, "getConnectivityState", GetConnectivityState);
+  Nan::SetPrototypeMethod(tpl, "createCall", CreateCall);
+  Nan::SetPrototypeMethod(tpl, "getOutstandingCalls", GetOutstandingCalls);
+  fun_tpl.Reset(tpl);
+  Local<Function> ctr = Nan::GetFunction(tpl).ToLocalChecked();
+  Nan::Set(exports, Nan::New("ChannelPool").ToLocalChecked(), ctr);
+  constructor = new Callback(ctr);
+  watch_callback = new Callback(
+      Nan::GetFunction(Nan::New<FunctionTemplate>(IgnoreConnectivityChange))
+          .ToLocalChecked());
+}
+
+bool ChannelPool::HasInstance(Local<Value> val) {
+  HandleScope scope;
+  return Nan::New(fun_tpl)->HasInstance(val);
+}
+
+ChannelPool::PooledChannel *ChannelPool::PickChannel() {
+  size_t count = channels.size();
+  PooledChannel *picked = NULL;
+  for (size_t i = 0; i < count; i++) {
+    PooledChannel *candidate = channels[(next_index + i) % count].get();
+    if (candidate->state == GRPC_CHANNEL_TRANSIENT_FAILURE ||
+        candidate->state == GRPC_CHANNEL_SHUTDOWN) {
+      continue;
+    }
+    if (!least_outstanding) {
+      picked = candidate;
+      break;
+    }
+    // Starting from next_index spreads ties across the channels
+    if (picked == NULL ||
+        *candidate->outstanding_calls < *picked->outstanding_calls) {
+      picked = candidate;
+    }
+  }
+  if (picked == NULL) {
+    // Every channel is failing, so a call may as well try any of them
+    picked = channels[next_index].get();
+  }
+  next_index = (next_index + 1) % count;
+  return picked;
+}
+
+void ChannelPool::WatchChannel(shared_ptr<PooledChannel> pooled,
+                               shared_ptr<ChannelList> unwatched) {
+  if (pooled->watching || pooled->channel == NULL ||
+      pooled->state == GRPC_CHANNEL_SHUTDOWN) {
+    return;
+  }
+  pooled->watching = true;
+  unique_ptr<OpVec> ops(new OpVec());
+  ops->push_back(unique_ptr<Op>(new ConnectivityWatchOp(pooled, unwatched)));
+  gpr_timespec deadline =
+      gpr_time_add(gpr_now(GPR_CLOCK_MONOTONIC),
+                   gpr_time_from_millis(kConnectivityWatchMs, GPR_TIMESPAN));
+  grpc_channel_watch_connectivity_state(
+      pooled->channel->GetWrappedChannel(), pooled->state, deadline,
+      GetCompletionQueue(),
+      new struct tag(watch_callback->GetFunction(), ops.release(), NULL,
+                     Nan::Null()));
+  CompletionQueueNext();
+}
+
+NAN_METHOD(ChannelPool::New) {
+  /* Arguments:
+   * 0: Target
+   * 1: ChannelCredentials
+   * 2: Channel options
+   * 3: Number of channels
+   * 4: Pick policy, "round_robin" (the default) or "least_outstanding"
+   */
+  if (info.IsConstructCall()) {
+    if (!info[0]->IsString()) {
+      return Nan::ThrowTypeError(
+          "ChannelPool expects a string, a credential, an object and a size");
+    }
+    if (!ChannelCredentials::HasInstance(info[1])) {
+      return Nan::ThrowTypeError(
+          "ChannelPool's second argument must be a ChannelCredentials");
+    }
+    if (!info[3]->IsUint32() || Nan::To<uint32_t>(info[3]).FromJust() == 0) {
+      return Nan::ThrowTypeError(
+          "ChannelPool's fourth argument must be a positive integer");
+    }
+    bool least_outstanding = false;
+    if (info[4]->IsString()) {
+      Utf8String policy(info[4]);
+      if (strcmp(*policy, "least_outstanding") == 0) {
+        least_outstanding = true;
+      } else if (strcmp(*policy, "round_robin") != 0) {
+        return Nan::ThrowTypeError(
+            "ChannelPool's pick policy must be \"round_robin\" or "
+            "\"least_outstanding\"");
+      }
+    } else if (!(info[4]->IsUndefined() || info[4]->IsNull())) {
+      return Nan::ThrowTypeError(
+          "ChannelPool's fifth argument must be a string, if provided");
+    }
+    Utf8String host(info[0]);
+    ChannelCredentials *creds_object = ObjectWrap::Unwrap<ChannelCredentials>(
+        Nan::To<Object>(info[1]).ToLocalChecked());
+    grpc_channel_credentials *creds = creds_object->GetWrappedCredentials();
+    grpc_channel_args *channel_args_ptr = NULL;
+    if (!ParseChannelArgs(info[2], &channel_args_ptr)) {
+      DeallocateChannelArgs(channel_args_ptr);
+      return Nan::ThrowTypeError(
+          "Channel options must be an object with "
+          "string keys and integer or string values, or a ResourceQuota "
+          "for grpc.resource_quota");
+    }
+    uint32_t size = Nan::To<uint32_t>(info[3]).FromJust();
+    // The parsed options, followed by the pool index
+    vector<grpc_arg> args(channel_args_ptr->args,
+                          channel_args_ptr->args + channel_args_ptr->num_args);
+    grpc_arg index_arg;
+    index_arg.type = GRPC_ARG_INTEGER;
+    index_arg.key = const_cast<char *>(kChannelPoolIndexArg);
+    args.push_back(index_arg);
+    grpc_channel_args pool_args = {args.size(), args.data()};
+    vector<grpc_channel *> wrapped_channels;
+    for (uint32_t i = 0; i < size; i++) {
+      args.back().value.integer = static_cast<int>(i);
+      if (creds == NULL) {
+        wrapped_channels.push_back(
+            grpc_insecure_channel_create(*host, &pool_args, NULL));
+      } else {
+        wrapped_channels.push_back(
+            grpc_secure_channel_create(creds, *host, &pool_args, NULL));
+      }
+    }
+    DeallocateChannelArgs(channel_args_ptr);
+    ChannelPool *pool = new ChannelPool(wrapped_channels, least_outstanding);
+    pool->Wrap(info.This());
+    info.GetReturnValue().Set(info.This());
+    return;
+  } else {
+    const int argc = 5;
+    Local<Value> argv[argc] = {info[0], info[1], info[2], info[3], info[4]};
+    MaybeLocal<Object> maybe_instance =
+        Nan::NewInstance(constructor->GetFunction(), argc, argv);
+    if (maybe_instance.IsEmpty()) {
+      // There's probably a pending exception
+      return;
+    } else {
+      info.GetReturnValue().Set(maybe_instance.ToLocalChecked());
+    }
+  }
+}
+
+NAN_METHOD(ChannelPool::Close) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "close can only be called on ChannelPool objects");
+  }
+  ChannelPool *pool = ObjectWrap::Unwrap<ChannelPool>(info.This());
+  pool->DestroyChannels();
+}
+
+NAN_METHOD(ChannelPool::GetTarget) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "getTarget can only be called on ChannelPool objects");
+  }
+  ChannelPool *pool = ObjectWrap::Unwrap<ChannelPool>(info.This());
+  if (pool->channels.empty()) {
+    return Nan::ThrowError("Cannot call getTarget on a closed ChannelPool");
+  }
+  info.GetReturnValue().Set(
+      Nan::New(grpc_channel_get_target(
+                   pool->channels[0]->channel->GetWrappedChannel()))
+          .ToLocalChecked());
+}
+
+/* Returns the best state of any channel in the pool, where READY is better
+   than CONNECTING, which is better than IDLE, then TRANSIENT_FAILURE */
+NAN_METHOD(ChannelPool::GetConnectivityState) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "getConnectivityState can only be called on ChannelPool objects");
+  }
+  ChannelPool *pool = ObjectWrap::Unwrap<ChannelPool>(info.This());
+  if (pool->channels.empty()) {
+    return Nan::ThrowError(
+        "Cannot call getConnectivityState on a closed ChannelPool");
+  }
+  static const int kStateRank[] = {
+      2,  // GRPC_CHANNEL_IDLE
+      3,  // GRPC_CHANNEL_CONNECTING
+      4,  // GRPC_CHANNEL_READY
+      1,  // GRPC_CHANNEL_TRANSIENT_FAILURE
+      0   // GRPC_CHANNEL_SHUTDOWN
+  };
+  int try_to_connect = (int)info[0]->Equals(Nan::True());
+  grpc_connectivity_state best = GRPC_CHANNEL_SHUTDOWN;
+  for (size_t i = 0; i < pool->channels.size(); i++) {
+    PooledChannel *pooled = pool->channels[i].get();
+    pooled->state = grpc_channel_check_connectivity_state(
+        pooled->channel->GetWrappedChannel(), try_to_connect);
+    if (kStateRank[pooled->state] > kStateRank[best]) {
+      best = pooled->state;
+    }
+  }
+  info.GetReturnValue().Set(best);
+}
+
+NAN_METHOD(ChannelPool::CreateCall) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "createCall can only be called on ChannelPool objects");
+  }
+  ChannelPool *pool = ObjectWrap::Unwrap<ChannelPool>(info.This());
+  if (pool->channels.empty()) {
+    return Nan::ThrowError("Cannot createCall with a closed ChannelPool");
+  }
+  /* Watches only complete on the loop thread, so none of them can add a
+     channel to the list while it is being walked */
+  ChannelList *unwatched = pool->unwatched.get();
+  for (size_t i = 0; i < unwatched->size(); i++) {
+    WatchChannel((*unwatched)[i], pool->unwatched);
+  }
+  unwatched->clear();
+  PooledChannel *pooled = pool->PickChannel();
+  Local<Value> call = Channel::CreateCallFromArgs(pooled->channel, info);
+  if (call.IsEmpty()) {
+    return;
+  }
+  if (Call::HasInstance(call)) {
+    ObjectWrap::Unwrap<Call>(Nan::To<Object>(call).ToLocalChecked())
+        ->TrackOutstanding(pooled->outstanding_calls);
+  }
+  info.GetReturnValue().Set(call);
+}
+
+NAN_METHOD(ChannelPool::GetOutstandingCalls) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "getOutstandingCalls can only be called on ChannelPool objects");
+  }
+  ChannelPool *pool = ObjectWrap::Unwrap<ChannelPool>(info.This());
+  Local<Array> counts = Nan::New<Array>(pool->channels.size());
+  for (size_t i = 0; i < pool->channels.size(); i++) {
+    Nan::Set(counts, i,
+             Nan::New(static_cast<double>(
+                 *pool->channels[i]->outstanding_calls)));
+  }
+  info.GetReturnValue().Set(counts);
+}
+
+}  // namespace node
+}  // namespace grpc
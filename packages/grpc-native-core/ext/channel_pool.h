@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef NET_GRPC_NODE_CHANNEL_POOL_H_
+#define NET_GRPC_NODE_CHANNEL_POOL_H_
+
+#include <memory>
+#include <vector>
+
+#include <nan.h>
+#include <node.h>
+#include "grpc/grpc.h"
+
+#include "channel.h"
+
+namespace grpc {
+namespace node {
+
+/* A fixed set of channels to the same target, with the same credentials and
+   options, that calls are spread across. Each channel gets a distinct value
+   for an extra channel argument, so that they do not share subchannels. */
+class ChannelPool : public Nan::ObjectWrap {
+ public:
+  static void Init(v8::Local<v8::Object> exports);
+  static bool HasInstance(v8::Local<v8::Value> val);
+
+ private:
+  friend class ConnectivityWatchOp;
+
+  struct PooledChannel {
+    // NULL after the pool is closed
+    Channel *channel;
+    // The number of calls created on this channel that have not finished
+    std::shared_ptr<size_t> outstanding_calls;
+    // The state seen by the last connectivity check on this channel
+    grpc_connectivity_state state;
+    // Whether there is a connectivity watch pending on this channel
+    bool watching;
+  };
+  typedef std::vector<std::shared_ptr<PooledChannel>> ChannelList;
+
+  ChannelPool(const std::vector<grpc_channel *> &channels,
+              bool least_outstanding);
+  ~ChannelPool();
+
+  // Prevent copying
+  ChannelPool(const ChannelPool &);
+  ChannelPool &operator=(const ChannelPool &);
+
+  /* Returns the channel to start the next call on. Channels that are in
+     TRANSIENT_FAILURE or SHUTDOWN are skipped, unless every channel is. */
+  PooledChannel *PickChannel();
+  void DestroyChannels();
+
+  /* Starts watching for a connectivity state change on pooled, if there is
+     no watch pending, to keep its state current while the pool is in use.
+     When the watch completes, pooled is added to unwatched. */
+  static void WatchChannel(std::shared_ptr<PooledChannel> pooled,
+                           std::shared_ptr<ChannelList> unwatched);
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(Close);
+  static NAN_METHOD(GetTarget);
+  static NAN_METHOD(GetConnectivityState);
+  static NAN_METHOD(CreateCall);
+  static NAN_METHOD(GetOutstandingCalls);
+  static Nan::Callback *constructor;
+  static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
+  // The callback for connectivity watches, which do not report to javascript
+  static Nan::Callback *watch_callback;
+
+  ChannelList channels;
+  /* The channels with no connectivity watch pending, so that createCall only
+     has to start watches on them instead of checking every channel. It is
+     shared with the pending watches, which can outlive the pool. */
+  std::shared_ptr<ChannelList> unwatched;
+  // Where the next search for a channel starts
+  size_t next_index;
+  // Pick the channel with the fewest outstanding calls instead of rotating
+  bool least_outstanding;
+};
+
+}  // namespace node
+}  // namespace grpc
+
+#endif  // NET_GRPC_NODE_CHANNEL_POOL_H_
@@ -0,0 +1,146 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <nan.h>
+#include <node.h>
+#include "grpc/grpc.h"
+#include "grpc/support/alloc.h"
+#include "src/core/lib/channel/channelz.h"
+#include "src/core/lib/surface/channel.h"
+#include "src/core/lib/surface/server.h"
+
+#include "channelz.h"
+
+namespace grpc {
+namespace node {
+
+using Nan::EscapableHandleScope;
+using Nan::MaybeLocal;
+
+using v8::FunctionTemplate;
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+Local<Value> ChannelzJsonToValue(char *json) {
+  EscapableHandleScope scope;
+  if (json == NULL) {
+    return scope.Escape(Nan::Null());
+  }
+  MaybeLocal<v8::String> json_string = Nan::New(json);
+  gpr_free(json);
+  if (json_string.IsEmpty()) {
+    return scope.Escape(Nan::Null());
+  }
+  Nan::JSON parser;
+  MaybeLocal<Value> value = parser.Parse(json_string.ToLocalChecked());
+  if (value.IsEmpty()) {
+    return scope.Escape(Nan::Null());
+  }
+  return scope.Escape(value.ToLocalChecked());
+}
+
+Local<Value> GetChannelChannelz(grpc_channel *channel) {
+  EscapableHandleScope scope;
+  grpc_core::channelz::ChannelNode *node =
+      grpc_channel_get_channelz_node(channel);
+  if (node == NULL) {
+    return scope.Escape(Nan::Null());
+  }
+  return scope.Escape(
+      ChannelzJsonToValue(grpc_channelz_get_channel(node->uuid())));
+}
+
+Local<Value> GetServerChannelz(grpc_server *server) {
+  EscapableHandleScope scope;
+  grpc_core::channelz::ServerNode *node = grpc_server_get_channelz_node(server);
+  if (node == NULL) {
+    return scope.Escape(Nan::Null());
+  }
+  return scope.Escape(
+      ChannelzJsonToValue(grpc_channelz_get_server(node->uuid())));
+}
+
+/* Reads a channelz id. The JSON data has ids as strings, because they are
+   64-bit integers, so either form is accepted. Returns false if val is
+   neither */
+static bool ParseChannelzId(Local<Value> val, intptr_t *id) {
+  double value;
+  if (val->IsNumber()) {
+    value = Nan::To<double>(val).FromJust();
+  } else if (val->IsString()) {
+    Nan::Utf8String id_str(val);
+    char *end;
+    value = strtod(*id_str, &end);
+    if (id_str.length() == 0 || *end != '\0') {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  // Ids start at 1, and larger ids than this cannot be numbers in javascript
+  if (value < 1 || value > 9007199254740991.0 || value != floor(value)) {
+    return false;
+  }
+  *id = static_cast<intptr_t>(value);
+  return true;
+}
+
+NAN_METHOD(GetChannelzSubchannel) {
+  /* Arguments:
+   * 0: Subchannel id, from a channel's subchannelRef list
+   * Returns the subchannel's call counts, connectivity state and the ids of
+   * its sockets, or null if there is no subchannel with that id */
+  intptr_t id;
+  if (!ParseChannelzId(info[0], &id)) {
+    return Nan::ThrowTypeError(
+        "getChannelzSubchannel's argument must be a channelz id");
+  }
+  info.GetReturnValue().Set(
+      ChannelzJsonToValue(grpc_channelz_get_subchannel(id)));
+}
+
+NAN_METHOD(GetChannelzSocket) {
+  /* Arguments:
+   * 0: Socket id, from a subchannel's socketRef list or a server's
+   *    listenSocket list
+   * Returns the socket's stream and message counts, keepalives and flow
+   * control windows, or null if there is no socket with that id */
+  intptr_t id;
+  if (!ParseChannelzId(info[0], &id)) {
+    return Nan::ThrowTypeError(
+        "getChannelzSocket's argument must be a channelz id");
+  }
+  info.GetReturnValue().Set(ChannelzJsonToValue(grpc_channelz_get_socket(id)));
+}
+
+void ChannelzInit(Local<Object> exports) {
+  Nan::Set(exports, Nan::New("getChannelzSubchannel").ToLocalChecked(),
+           Nan::GetFunction(Nan::New<FunctionTemplate>(GetChannelzSubchannel))
+               .ToLocalChecked());
+  Nan::Set(exports, Nan::New("getChannelzSocket").ToLocalChecked(),
+           Nan::GetFunction(Nan::New<FunctionTemplate>(GetChannelzSocket))
+               .ToLocalChecked());
+}
+
+}  // namespace node
+}  // namespace grpc
@@ -0,0 +1,50 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef NET_GRPC_NODE_CHANNELZ_H_
+#define NET_GRPC_NODE_CHANNELZ_H_
+
+#include <nan.h>
+#include <node.h>
+#include "grpc/grpc.h"
+
+namespace grpc {
+namespace node {
+
+/* Converts a channelz JSON string returned by core to a javascript object,
+   and frees the string. Returns null if json is NULL, which is what core
+   returns for unknown ids and entities with channelz disabled */
+v8::Local<v8::Value> ChannelzJsonToValue(char *json);
+
+/* Returns the channelz data for the channel, with its call counts, last call
+   time and the ids of its subchannels, or null if channelz is disabled */
+v8::Local<v8::Value> GetChannelChannelz(grpc_channel *channel);
+
+/* Returns the channelz data for the server, with its call counts, last call
+   time and the ids of its listen sockets, or null if channelz is disabled */
+v8::Local<v8::Value> GetServerChannelz(grpc_server *server);
+
+/* Exposes getChannelzSubchannel and getChannelzSocket, which look up
+   subchannels and sockets by the ids that the other channelz data refers to
+   them by */
+void ChannelzInit(v8::Local<v8::Object> exports);
+
+}  // namespace node
+}  // namespace grpc
+
+#endif  // NET_GRPC_NODE_CHANNELZ_H_
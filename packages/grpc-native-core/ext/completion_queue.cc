@@ -16,72 +16,291 @@
  *
  */
 
+#include <atomic>
+#include <vector>
+
 #include <grpc/grpc.h>
+#include <grpc/support/log.h>
+#include <nan.h>
 #include <node.h>
 #include <uv.h>
 #include <v8.h>
 
 #include "call.h"
 #include "completion_queue.h"
+#include "mpscq.h"
+#include "stats.h"
 
 namespace grpc {
 namespace node {
 
+using v8::Array;
+using v8::Function;
 using v8::Local;
 using v8::Object;
 using v8::Value;
 
-grpc_completion_queue *queue;
-uv_prepare_t prepare;
-int pending_batches;
+struct completed_event : public MpscqNode {
+  void *tag;
+  bool success;
+  // When the polling thread read the event, from uv_hrtime
+  uint64_t read_time;
+};
+
+struct deferred_tag {
+  void *tag;
+  bool success;
+};
+
+/* All of the completion queue state, bound to the default event loop. Node
+   only loads the module on the main thread, because it is not context-aware.
+   The state is created in CompletionQueueInit, and it is only ever used from
+   the main thread, except for the fields noted below. */
+struct CompletionQueueState {
+  grpc_completion_queue *queue;
+  uv_loop_t *loop;
+  uv_prepare_t prepare;
+  int pending_batches;
+
+  /* State for the optional dedicated polling thread. When it is enabled, the
+     thread blocks in grpc_completion_queue_next, pushes each completed event
+     onto completed_events, and wakes the event loop with completion_async.
+     The loop thread then runs CompleteTag exactly as drain_completion_queue
+     does. completed_events and wakeup_pending are shared with the thread. */
+  bool use_poll_thread;
+  uv_thread_t poll_thread;
+  uv_async_t completion_async;
+  Mpscq completed_events;
+  // Set when a wakeup has been sent that the loop thread has not yet handled
+  std::atomic<bool> wakeup_pending;
+
+  /* State for the optional batch dispatcher. When it is set, the tags that
+     complete during one drain are collected in deferred_tags, and then passed
+     to the dispatcher in a single call, instead of each one calling its own
+     callback. */
+  Nan::Callback dispatcher;
+  Nan::AsyncResource *dispatch_resource;
+  std::vector<deferred_tag> deferred_tags;
+};
+
+static CompletionQueueState *cq_state = NULL;
+
+static CompletionQueueState *GetState() { return cq_state; }
+
+static const char *get_error_message(bool success) {
+  if (success) {
+    return NULL;
+  } else {
+    return "The async function encountered an error";
+  }
+}
+
+static void complete_event(CompletionQueueState *state, void *tag,
+                           bool success) {
+  if (state->dispatcher.IsEmpty()) {
+    CompleteTag(tag, get_error_message(success));
+    grpc::node::DestroyTag(tag);
+  } else {
+    deferred_tag deferred = {tag, success};
+    state->deferred_tags.push_back(deferred);
+  }
+  state->pending_batches--;
+}
+
+/* Passes every tag collected by complete_event to the dispatcher as one array
+ * of [callback, error, result] triples, and then finishes them */
+static void dispatch_deferred_tags(CompletionQueueState *state) {
+  if (state->deferred_tags.empty()) {
+    return;
+  }
+  std::vector<deferred_tag> tags;
+  tags.swap(state->deferred_tags);
+  if (state->dispatcher.IsEmpty()) {
+    // The dispatcher was removed while these tags were being collected
+    for (size_t i = 0; i < tags.size(); i++) {
+      CompleteTag(tags[i].tag, get_error_message(tags[i].success));
+      grpc::node::DestroyTag(tags[i].tag);
+    }
+    return;
+  }
+  Local<Array> completions = Nan::New<Array>();
+  for (size_t i = 0; i < tags.size(); i++) {
+    AppendTagCompletion(tags[i].tag, get_error_message(tags[i].success),
+                        completions);
+  }
+  Local<Value> argv[] = {completions};
+  state->dispatcher.Call(1, argv, state->dispatch_resource);
+  for (size_t i = 0; i < tags.size(); i++) {
+    FinishDeferredTag(tags[i].tag, get_error_message(tags[i].success));
+    grpc::node::DestroyTag(tags[i].tag);
+  }
+}
+
+static void record_drain(uint64_t events) {
+  ProcessStats &stats = GetProcessStats();
+  stats.drains.fetch_add(1, std::memory_order_relaxed);
+  stats.events_per_drain.Record(events);
+}
 
 static void drain_completion_queue(uv_prepare_t *handle) {
   Nan::HandleScope scope;
+  CompletionQueueState *state =
+      static_cast<CompletionQueueState *>(handle->data);
   grpc_event event;
-  (void)handle;
+  uint64_t events = 0;
   do {
-    event = grpc_completion_queue_next(queue, gpr_inf_past(GPR_CLOCK_MONOTONIC),
-                                       NULL);
+    event = grpc_completion_queue_next(
+        state->queue, gpr_inf_past(GPR_CLOCK_MONOTONIC), NULL);
 
     if (event.type == GRPC_OP_COMPLETE) {
-      const char *error_message;
-      if (event.success) {
-        error_message = NULL;
-      } else {
-        error_message = "The async function encountered an error";
-      }
-      CompleteTag(event.tag, error_message);
-      grpc::node::DestroyTag(event.tag);
-      pending_batches--;
+      complete_event(state, event.tag, event.success);
+      events++;
     }
-    if (pending_batches == 0) {
-      uv_prepare_stop(&prepare);
+    if (state->pending_batches == 0) {
+      uv_prepare_stop(&state->prepare);
     }
   } while (event.type != GRPC_QUEUE_TIMEOUT);
+  dispatch_deferred_tags(state);
+  record_drain(events);
 }
 
-grpc_completion_queue *GetCompletionQueue() { return queue; }
+static void drain_completed_events(uv_async_t *handle) {
+  Nan::HandleScope scope;
+  CompletionQueueState *state =
+      static_cast<CompletionQueueState *>(handle->data);
+  /* This has to be a read-modify-write so that it synchronizes with the
+   * exchange in poll_completion_queue, which makes every event pushed before
+   * that exchange visible to the pops below */
+  state->wakeup_pending.exchange(false);
+  MpscqNode *node;
+  uint64_t events = 0;
+  Histogram &queue_delay = GetProcessStats().queue_delay;
+  while ((node = state->completed_events.Pop()) != NULL) {
+    completed_event *event = static_cast<completed_event *>(node);
+    queue_delay.Record(uv_hrtime() - event->read_time);
+    complete_event(state, event->tag, event->success);
+    delete event;
+    events++;
+  }
+  dispatch_deferred_tags(state);
+  record_drain(events);
+  if (state->pending_batches == 0) {
+    uv_unref(reinterpret_cast<uv_handle_t *>(&state->completion_async));
+  }
+}
+
+static void poll_completion_queue(void *arg) {
+  CompletionQueueState *state = static_cast<CompletionQueueState *>(arg);
+  for (;;) {
+    grpc_event event = grpc_completion_queue_next(
+        state->queue, gpr_inf_future(GPR_CLOCK_MONOTONIC), NULL);
+    if (event.type == GRPC_QUEUE_SHUTDOWN) {
+      break;
+    }
+    if (event.type != GRPC_OP_COMPLETE) {
+      continue;
+    }
+    completed_event *completed = new completed_event;
+    completed->tag = event.tag;
+    completed->success = event.success;
+    completed->read_time = uv_hrtime();
+    state->completed_events.Push(completed);
+    /* Only wake the loop once per burst of events. The loop thread clears
+     * the flag before it starts popping, so anything pushed after that will
+     * trigger another wakeup */
+    if (!state->wakeup_pending.exchange(true)) {
+      uv_async_send(&state->completion_async);
+    }
+  }
+}
+
+grpc_completion_queue *GetCompletionQueue() {
+  CompletionQueueState *state = GetState();
+  if (state->queue == NULL) {
+    if (state->use_poll_thread) {
+      /* The polling thread only waits for events, and never polls for I/O:
+       * with the libuv iomgr all of core's I/O is driven by the event loop
+       * itself, and it must stay on that thread. A non-polling queue lets
+       * grpc_completion_queue_next block on a condition variable instead of
+       * calling into the iomgr from the wrong thread. */
+      grpc_completion_queue_attributes attrs = {
+          GRPC_CQ_CURRENT_VERSION, GRPC_CQ_NEXT, GRPC_CQ_NON_POLLING};
+      state->queue = grpc_completion_queue_create(
+          grpc_completion_queue_factory_lookup(&attrs), &attrs, NULL);
+      uv_async_init(state->loop, &state->completion_async,
+                    drain_completed_events);
+      state->completion_async.data = state;
+      uv_unref(reinterpret_cast<uv_handle_t *>(&state->completion_async));
+      GPR_ASSERT(uv_thread_create(&state->poll_thread, poll_completion_queue,
+                                  state) == 0);
+    } else {
+      state->queue = grpc_completion_queue_create_for_next(NULL);
+    }
+  }
+  return state->queue;
+}
 
 void CompletionQueueNext() {
-  if (pending_batches == 0) {
-    uv_prepare_start(&prepare, drain_completion_queue);
+  CompletionQueueState *state = GetState();
+  if (state->use_poll_thread) {
+    if (state->pending_batches == 0) {
+      uv_ref(reinterpret_cast<uv_handle_t *>(&state->completion_async));
+    }
+  } else if (state->pending_batches == 0) {
+    uv_prepare_start(&state->prepare, drain_completion_queue);
   }
-  pending_batches++;
+  state->pending_batches++;
 }
 
 void CompletionQueueInit(Local<Object> exports) {
-  queue = grpc_completion_queue_create_for_next(NULL);
-  uv_prepare_init(uv_default_loop(), &prepare);
-  pending_batches = 0;
+  CompletionQueueState *state = new CompletionQueueState;
+  /* The queue itself is created on first use, so that the polling mode can
+   * still be chosen after the module has been loaded */
+  state->queue = NULL;
+  state->loop = uv_default_loop();
+  uv_prepare_init(state->loop, &state->prepare);
+  state->prepare.data = state;
+  state->pending_batches = 0;
+  state->use_poll_thread = false;
+  state->wakeup_pending.store(false);
+  state->dispatch_resource = NULL;
+  cq_state = state;
+}
+
+bool CompletionQueueEnablePollThread() {
+  CompletionQueueState *state = GetState();
+  if (state->queue != NULL) {
+    return state->use_poll_thread;
+  }
+  state->use_poll_thread = true;
+  return true;
+}
+
+void CompletionQueueSetDispatcher(Local<Value> dispatcher) {
+  CompletionQueueState *state = GetState();
+  if (dispatcher->IsFunction()) {
+    state->dispatcher.Reset(dispatcher.As<Function>());
+    if (state->dispatch_resource == NULL) {
+      state->dispatch_resource = new Nan::AsyncResource("grpc:dispatch");
+    }
+  } else {
+    state->dispatcher.Reset();
+  }
 }
 
 void CompletionQueueForcePoll() {
+  CompletionQueueState *state = GetState();
+  if (state->use_poll_thread) {
+    /* The polling thread is always waiting on the queue, so there is nothing
+     * to force */
+    return;
+  }
   /* This sets the prepare object to poll on the completion queue the next time
    * Node polls for IO. But it doesn't increment the number of pending batches,
    * so it will immediately stop polling after that unless there is an
    * intervening CompletionQueueNext call */
-  if (pending_batches == 0) {
-    uv_prepare_start(&prepare, drain_completion_queue);
+  if (state->pending_batches == 0) {
+    uv_prepare_start(&state->prepare, drain_completion_queue);
   }
 }
 
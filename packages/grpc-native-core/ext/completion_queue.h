@@ -30,5 +30,16 @@ void CompletionQueueInit(v8::Local<v8::Object> exports);
 
 void CompletionQueueForcePoll();
 
+/* Switches to polling the completion queue from a dedicated thread instead of
+   a uv_prepare_t callback. This only succeeds before the queue is first used.
+   Returns true if the polling thread is in use after the call. */
+bool CompletionQueueEnablePollThread();
+
+/* Sets the function that receives every batch completed in one pass over the
+   completion queue, as a flat array of callback, error, and result triples.
+   Passing anything other than a function goes back to calling each batch's
+   callback separately. */
+void CompletionQueueSetDispatcher(v8::Local<v8::Value> dispatcher);
+
 }  // namespace node
 }  // namespace grpc
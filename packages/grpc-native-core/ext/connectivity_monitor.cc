@@ -0,0 +1,300 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nan.h>
+#include <node.h>
+#include <uv.h>
+#include "call.h"
+#include "channel.h"
+#include "completion_queue.h"
+#include "connectivity_monitor.h"
+#include "grpc/grpc.h"
+#include "grpc/support/time.h"
+
+namespace grpc {
+namespace node {
+
+using Nan::Callback;
+using Nan::HandleScope;
+using Nan::ObjectWrap;
+using Nan::Persistent;
+
+using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
+
+using v8::Array;
+using v8::Function;
+using v8::FunctionTemplate;
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+/* How long each watch lasts by default. A pending watch keeps the process
+   alive, so after the monitor is closed, channels that are still open stop
+   being watched within this long */
+const int64_t kDefaultMonitorWatchMs = 10000;
+
+// The most watches whose tags are kept for reuse
+const size_t kMaxMonitorTags = 1024;
+
+Callback *ConnectivityMonitor::constructor;
+Persistent<FunctionTemplate> ConnectivityMonitor::fun_tpl;
+
+class MonitorWatchOp : public Op, public Pooled<MonitorWatchOp> {
+ public:
+  static const char *PoolName() { return "monitorWatchOp"; }
+  MonitorWatchOp(ConnectivityMonitor *monitor, uint32_t index)
+      : monitor(monitor), index(index) {}
+
+  Local<Value> GetNodeValue() const { return Nan::Null(); }
+
+  bool ParseOp(Local<Value> value, grpc_op *out) { return true; }
+  bool IsFinalOp() { return false; }
+  // A failed watch reached its deadline, which is handled the same way
+  void OnComplete(bool success) { monitor->OnWatchComplete(index); }
+
+ protected:
+  std::string GetTypeString() const { return "connectivity"; }
+
+ private:
+  ConnectivityMonitor *monitor;
+  uint32_t index;
+};
+
+static void DeleteDeliveryHandle(uv_handle_t *handle) {
+  delete reinterpret_cast<uv_check_t *>(handle);
+}
+
+ConnectivityMonitor::ConnectivityMonitor(Local<Function> callback,
+                                         int64_t watch_period_ms)
+    : callback(callback),
+      async_resource("grpc:connectivityMonitor"),
+      delivery(new uv_check_t),
+      tag_pool(new TagPool(kMaxMonitorTags)),
+      watch_period_ms(watch_period_ms),
+      pending_watches(0),
+      closed(false) {
+  uv_check_init(uv_default_loop(), delivery);
+  delivery->data = this;
+}
+
+ConnectivityMonitor::~ConnectivityMonitor() {
+  uv_close(reinterpret_cast<uv_handle_t *>(delivery), DeleteDeliveryHandle);
+}
+
+void ConnectivityMonitor::Init(Local<Object> exports) {
+  HandleScope scope;
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("ConnectivityMonitor").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Nan::SetPrototypeMethod(tpl, "add", Add);
+  Nan::SetPrototypeMethod(tpl, "remove", Remove);
+  Nan::SetPrototypeMethod(tpl, "close", Close);
+  fun_tpl.Reset(tpl);
+  Local<Function> ctr = Nan::GetFunction(tpl).ToLocalChecked();
+  Nan::Set(exports, Nan::New("ConnectivityMonitor").ToLocalChecked(), ctr);
+  constructor = new Callback(ctr);
+}
+
+bool ConnectivityMonitor::HasInstance(Local<Value> val) {
+  HandleScope scope;
+  return Nan::New(fun_tpl)->HasInstance(val);
+}
+
+void ConnectivityMonitor::Watch(uint32_t index) {
+  WatchedChannel *watched = channels[index].get();
+  grpc_channel *wrapped_channel = watched->channel->GetWrappedChannel();
+  if (closed || watched->removed || wrapped_channel == NULL ||
+      watched->state == GRPC_CHANNEL_SHUTDOWN) {
+    watched->handle.Reset();
+    return;
+  }
+  // The monitor has to outlive every watch that points to it
+  if (pending_watches++ == 0) {
+    Ref();
+  }
+  watched->watching = true;
+  struct tag *tag_struct = tag_pool->Get(Local<Function>(), NULL, Nan::Null());
+  tag_struct->ops->push_back(unique_ptr<Op>(new MonitorWatchOp(this, index)));
+  gpr_timespec deadline =
+      gpr_time_add(gpr_now(GPR_CLOCK_MONOTONIC),
+                   gpr_time_from_millis(watch_period_ms, GPR_TIMESPAN));
+  grpc_channel_watch_connectivity_state(wrapped_channel, watched->state,
+                                        deadline, GetCompletionQueue(),
+                                        tag_struct);
+  CompletionQueueNext();
+}
+
+void ConnectivityMonitor::OnWatchComplete(uint32_t index) {
+  WatchedChannel *watched = channels[index].get();
+  watched->watching = false;
+  grpc_channel *wrapped_channel = watched->channel->GetWrappedChannel();
+  if (!closed && !watched->removed && wrapped_channel != NULL) {
+    grpc_connectivity_state state =
+        grpc_channel_check_connectivity_state(wrapped_channel, 0);
+    if (state != watched->state) {
+      watched->state = state;
+      if (changes.empty()) {
+        // Kept alive until the changes have been delivered
+        Ref();
+        uv_check_start(delivery, DeliverChanges);
+      }
+      changes.push_back(std::make_pair(index, state));
+    }
+  }
+  Watch(index);
+  if (--pending_watches == 0) {
+    Unref();
+  }
+}
+
+void ConnectivityMonitor::DeliverChanges(uv_check_t *handle) {
+  HandleScope scope;
+  ConnectivityMonitor *monitor =
+      static_cast<ConnectivityMonitor *>(handle->data);
+  uv_check_stop(handle);
+  vector<std::pair<uint32_t, grpc_connectivity_state>> changes;
+  changes.swap(monitor->changes);
+  if (!monitor->closed && !changes.empty()) {
+    Local<Array> pairs = Nan::New<Array>(static_cast<int>(changes.size()));
+    for (size_t i = 0; i < changes.size(); i++) {
+      Local<Array> pair = Nan::New<Array>(2);
+      Nan::Set(pair, 0, Nan::New(changes[i].first));
+      Nan::Set(pair, 1, Nan::New(static_cast<uint32_t>(changes[i].second)));
+      Nan::Set(pairs, static_cast<uint32_t>(i), pair);
+    }
+    Local<Value> argv[] = {pairs};
+    monitor->callback.Call(1, argv, &monitor->async_resource);
+  }
+  monitor->Unref();
+}
+
+NAN_METHOD(ConnectivityMonitor::New) {
+  /* Arguments:
+   * 0: Callback for each loop turn's changes, as an array of [index, state]
+   *    pairs, where index is the value that add returned for the channel
+   * 1: Optional number of milliseconds that each watch in core lasts before
+   *    it is started again
+   */
+  if (!info.IsConstructCall()) {
+    return Nan::ThrowTypeError(
+        "ConnectivityMonitor can only be created with the new operator");
+  }
+  if (!info[0]->IsFunction()) {
+    return Nan::ThrowTypeError(
+        "ConnectivityMonitor's first argument must be a callback");
+  }
+  int64_t watch_period_ms = kDefaultMonitorWatchMs;
+  if (!info[1]->IsUndefined()) {
+    if (!info[1]->IsUint32() || Nan::To<uint32_t>(info[1]).FromJust() == 0) {
+      return Nan::ThrowTypeError(
+          "ConnectivityMonitor's second argument must be a positive integer");
+    }
+    watch_period_ms = Nan::To<uint32_t>(info[1]).FromJust();
+  }
+  ConnectivityMonitor *monitor =
+      new ConnectivityMonitor(info[0].As<Function>(), watch_period_ms);
+  monitor->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(ConnectivityMonitor::Add) {
+  /* Arguments:
+   * 0: Channel to watch
+   * Returns the channel's index, which identifies it in the callback and in
+   * remove
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "add can only be called on ConnectivityMonitor objects");
+  }
+  if (!Channel::HasInstance(info[0])) {
+    return Nan::ThrowTypeError("add's argument must be a Channel");
+  }
+  ConnectivityMonitor *monitor =
+      ObjectWrap::Unwrap<ConnectivityMonitor>(info.This());
+  if (monitor->closed) {
+    return Nan::ThrowError("Cannot add a channel to a closed monitor");
+  }
+  Local<Object> channel_object = Nan::To<Object>(info[0]).ToLocalChecked();
+  Channel *channel = ObjectWrap::Unwrap<Channel>(channel_object);
+  if (channel->GetWrappedChannel() == NULL) {
+    return Nan::ThrowError("Cannot add a closed Channel to a monitor");
+  }
+  unique_ptr<WatchedChannel> watched(new WatchedChannel());
+  watched->handle.Reset(channel_object);
+  watched->channel = channel;
+  watched->state =
+      grpc_channel_check_connectivity_state(channel->GetWrappedChannel(), 0);
+  watched->watching = false;
+  watched->removed = false;
+  uint32_t index = static_cast<uint32_t>(monitor->channels.size());
+  monitor->channels.push_back(std::move(watched));
+  monitor->Watch(index);
+  info.GetReturnValue().Set(Nan::New(index));
+}
+
+NAN_METHOD(ConnectivityMonitor::Remove) {
+  /* Arguments:
+   * 0: Index returned by add
+   * The channel's pending watch still runs until it completes, but no more
+   * changes are reported for it
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "remove can only be called on ConnectivityMonitor objects");
+  }
+  ConnectivityMonitor *monitor =
+      ObjectWrap::Unwrap<ConnectivityMonitor>(info.This());
+  if (!info[0]->IsUint32() ||
+      Nan::To<uint32_t>(info[0]).FromJust() >= monitor->channels.size()) {
+    return Nan::ThrowTypeError(
+        "remove's argument must be an index returned by add");
+  }
+  WatchedChannel *watched =
+      monitor->channels[Nan::To<uint32_t>(info[0]).FromJust()].get();
+  watched->removed = true;
+  if (!watched->watching) {
+    watched->handle.Reset();
+  }
+}
+
+NAN_METHOD(ConnectivityMonitor::Close) {
+  /* Stops reporting changes. Channels that are still open stop being watched
+   * when their pending watches complete. */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "close can only be called on ConnectivityMonitor objects");
+  }
+  ConnectivityMonitor *monitor =
+      ObjectWrap::Unwrap<ConnectivityMonitor>(info.This());
+  monitor->closed = true;
+  for (size_t i = 0; i < monitor->channels.size(); i++) {
+    if (!monitor->channels[i]->watching) {
+      monitor->channels[i]->handle.Reset();
+    }
+  }
+}
+
+}  // namespace node
+}  // namespace grpc
@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef NET_GRPC_NODE_CONNECTIVITY_MONITOR_H_
+#define NET_GRPC_NODE_CONNECTIVITY_MONITOR_H_
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <nan.h>
+#include <node.h>
+#include <uv.h>
+#include "grpc/grpc.h"
+
+#include "call.h"
+#include "channel.h"
+
+namespace grpc {
+namespace node {
+
+/* Watches the connectivity state of a set of channels. Each channel always
+   has one watch pending in core, which the monitor starts again natively
+   when it completes, and only changes of state are reported to javascript.
+   The changes seen in one turn of the event loop are passed to the callback
+   together, as [index, state] pairs. */
+class ConnectivityMonitor : public Nan::ObjectWrap {
+ public:
+  static void Init(v8::Local<v8::Object> exports);
+  static bool HasInstance(v8::Local<v8::Value> val);
+
+  // Records any state change on the channel at index, and watches it again
+  void OnWatchComplete(uint32_t index);
+
+ private:
+  struct WatchedChannel {
+    // Keeps the Channel object alive while it is being watched
+    Nan::Persistent<v8::Object> handle;
+    Channel *channel;
+    // The state that the pending watch is waiting for a change from
+    grpc_connectivity_state state;
+    bool watching;
+    bool removed;
+  };
+
+  ConnectivityMonitor(v8::Local<v8::Function> callback,
+                      int64_t watch_period_ms);
+  ~ConnectivityMonitor();
+
+  // Prevent copying
+  ConnectivityMonitor(const ConnectivityMonitor &);
+  ConnectivityMonitor &operator=(const ConnectivityMonitor &);
+
+  /* Starts a watch on the channel at index, unless it has been removed,
+     closed or shut down, or the monitor has been closed */
+  void Watch(uint32_t index);
+  static void DeliverChanges(uv_check_t *handle);
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(Add);
+  static NAN_METHOD(Remove);
+  static NAN_METHOD(Close);
+  static Nan::Callback *constructor;
+  static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
+
+  Nan::Callback callback;
+  Nan::AsyncResource async_resource;
+  // Indexed by the ids returned by add
+  std::vector<std::unique_ptr<WatchedChannel>> channels;
+  // Changes that have not been passed to the callback yet
+  std::vector<std::pair<uint32_t, grpc_connectivity_state>> changes;
+  /* Runs after the completion queue has been drained in each loop turn that
+     saw a change. Allocated separately, because it has to outlive the
+     monitor until it is closed */
+  uv_check_t *delivery;
+  // The watches share tags, which do not call into javascript
+  std::shared_ptr<TagPool> tag_pool;
+  int64_t watch_period_ms;
+  size_t pending_watches;
+  bool closed;
+};
+
+}  // namespace node
+}  // namespace grpc
+
+#endif  // NET_GRPC_NODE_CONNECTIVITY_MONITOR_H_
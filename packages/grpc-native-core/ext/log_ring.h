@@ -0,0 +1,156 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef NET_GRPC_NODE_LOG_RING_H_
+#define NET_GRPC_NODE_LOG_RING_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <cstddef>
+
+#include "grpc/support/log.h"
+#include "grpc/support/time.h"
+
+namespace grpc {
+namespace node {
+
+/* Longer messages are truncated to this many bytes, and their records are
+   marked as truncated */
+const size_t kMaxLogMessageLength = 512;
+
+struct LogRecord {
+  // Core always passes __FILE__, so this is never freed
+  const char *file;
+  int line;
+  gpr_log_severity severity;
+  gpr_timespec timestamp;
+  // Whether message is only the start of the logged message
+  bool truncated;
+  char message[kMaxLogMessageLength + 1];
+};
+
+/* Bounded lock-free multiple-producer multiple-consumer ring of log records,
+   based on Dmitry Vyukov's design. The records are stored in place, so
+   pushing does not allocate, and when the ring is full the record is dropped
+   and counted instead of blocking the logging thread. */
+class LogRing {
+ public:
+  // capacity must be a power of two
+  explicit LogRing(size_t capacity)
+      : cells_(new Cell[capacity]), mask_(capacity - 1) {
+    for (size_t i = 0; i < capacity; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+    dropped_.store(0, std::memory_order_relaxed);
+  }
+
+  ~LogRing() { delete[] cells_; }
+
+  size_t Capacity() const { return mask_ + 1; }
+
+  // Returns false if the ring was full and the record was dropped
+  bool Push(const gpr_log_func_args *args, gpr_timespec timestamp) {
+    Cell *cell;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    LogRecord *record = &cell->record;
+    record->file = args->file;
+    record->line = args->line;
+    record->severity = args->severity;
+    record->timestamp = timestamp;
+    size_t length = strlen(args->message);
+    record->truncated = length > kMaxLogMessageLength;
+    if (record->truncated) {
+      length = kMaxLogMessageLength;
+    }
+    memcpy(record->message, args->message, length);
+    record->message[length] = '\0';
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Copies the oldest record into out. Returns false if the ring is empty
+  bool Pop(LogRecord *out) {
+    Cell *cell;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    *out = cell->record;
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns the number of records dropped since the last call
+  uint64_t TakeDropped() {
+    return dropped_.exchange(0, std::memory_order_relaxed);
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    LogRecord record;
+  };
+
+  // Prevent copying
+  LogRing(const LogRing &);
+  LogRing &operator=(const LogRing &);
+
+  Cell *cells_;
+  size_t mask_;
+  std::atomic<size_t> enqueue_pos_;
+  std::atomic<size_t> dequeue_pos_;
+  std::atomic<uint64_t> dropped_;
+};
+
+}  // namespace node
+}  // namespace grpc
+
+#endif  // NET_GRPC_NODE_LOG_RING_H_
@@ -0,0 +1,90 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef NET_GRPC_NODE_MPSCQ_H_
+#define NET_GRPC_NODE_MPSCQ_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace grpc {
+namespace node {
+
+struct MpscqNode {
+  std::atomic<MpscqNode *> next;
+};
+
+/* Intrusive lock-free multiple-producer single-consumer queue, based on
+   Dmitry Vyukov's design. Push can be called from any thread. Pop must only
+   be called from a single consumer thread, and can return NULL while a push
+   is still in progress on another thread, so the consumer should only rely on
+   seeing an item after the producer has signaled it in some other way. */
+class Mpscq {
+ public:
+  Mpscq() : head_(&stub_), tail_(&stub_) {
+    stub_.next.store(NULL, std::memory_order_relaxed);
+  }
+
+  void Push(MpscqNode *node) {
+    node->next.store(NULL, std::memory_order_relaxed);
+    MpscqNode *prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  MpscqNode *Pop() {
+    MpscqNode *tail = tail_;
+    MpscqNode *next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (next == NULL) {
+        return NULL;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != NULL) {
+      tail_ = next;
+      return tail;
+    }
+    if (tail != head_.load(std::memory_order_acquire)) {
+      // A producer is between the exchange and the store in Push
+      return NULL;
+    }
+    Push(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next != NULL) {
+      tail_ = next;
+      return tail;
+    }
+    return NULL;
+  }
+
+ private:
+  // Prevent copying
+  Mpscq(const Mpscq &);
+  Mpscq &operator=(const Mpscq &);
+
+  std::atomic<MpscqNode *> head_;
+  MpscqNode *tail_;
+  MpscqNode stub_;
+};
+
+}  // namespace node
+}  // namespace grpc
+
+#endif  // NET_GRPC_NODE_MPSCQ_H_
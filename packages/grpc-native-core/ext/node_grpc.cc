@@ -16,7 +16,7 @@
  *
  */
 
-#include <queue>
+#include <atomic>
 
 #include <nan.h>
 #include <node.h>
@@ -33,11 +33,18 @@
 #include "call.h"
 #include "call_credentials.h"
 #include "channel.h"
+#include "channel_pool.h"
 #include "channel_credentials.h"
+#include "channelz.h"
+#include "connectivity_monitor.h"
 #include "completion_queue.h"
+#include "log_ring.h"
+#include "pool_allocator.h"
+#include "resource_quota.h"
 #include "server.h"
 #include "server_credentials.h"
 #include "slice.h"
+#include "stats.h"
 #include "timeval.h"
 
 using grpc::node::CreateSliceFromString;
@@ -50,17 +57,17 @@ using v8::Object;
 using v8::Uint32;
 using v8::String;
 
-typedef struct log_args {
-  gpr_log_func_args core_args;
-  gpr_timespec timestamp;
-} log_args;
+// The number of log records that can be waiting for the event loop
+const size_t kLogRingCapacity = 1024;
 
 typedef struct logger_state {
   Nan::Callback *callback;
   Nan::AsyncResource *async_resource;
-  std::queue<log_args *> *pending_args;
-  uv_mutex_t mutex;
+  grpc::node::LogRing *pending_records;
   uv_async_t async;
+  /* Messages below this severity are discarded before they are copied. This
+   * mirrors the verbosity that was passed to core. */
+  std::atomic<int> min_severity;
   // Indicates that a logger has been set
   bool logger_set;
 } logger_state;
@@ -184,52 +191,65 @@ NAN_METHOD(SetDefaultRootsPem) {
 
 NAUV_WORK_CB(LogMessagesCallback) {
   Nan::HandleScope scope;
-  std::queue<log_args *> args;
-  uv_mutex_lock(&grpc_logger_state.mutex);
-  grpc_logger_state.pending_args->swap(args);
-  uv_mutex_unlock(&grpc_logger_state.mutex);
-  /* Call the callback with each log message */
-  while (!args.empty()) {
-    log_args *arg = args.front();
-    args.pop();
-    Local<Value> file = Nan::New(arg->core_args.file).ToLocalChecked();
-    Local<Value> line = Nan::New<Uint32, uint32_t>(arg->core_args.line);
-    Local<Value> severity =
-        Nan::New(gpr_log_severity_string(arg->core_args.severity))
-            .ToLocalChecked();
-    Local<Value> message = Nan::New(arg->core_args.message).ToLocalChecked();
-    Local<Value> timestamp =
-        Nan::New<v8::Date>(grpc::node::TimespecToMilliseconds(arg->timestamp))
-            .ToLocalChecked();
-    const int argc = 5;
-    Local<Value> argv[argc] = {file, line, severity, message, timestamp};
-    grpc_logger_state.callback->Call(argc, argv, grpc_logger_state.async_resource);
-    delete[] arg->core_args.message;
-    delete arg;
+  /* Deliver every record that is waiting at once, but stop after one ring's
+   * worth so that a thread that keeps logging cannot starve the loop */
+  Local<v8::Array> records = Nan::New<v8::Array>();
+  grpc::node::LogRecord record;
+  size_t count = 0;
+  while (count < grpc_logger_state.pending_records->Capacity() &&
+         grpc_logger_state.pending_records->Pop(&record)) {
+    Local<Object> record_obj = Nan::New<Object>();
+    Nan::Set(record_obj, Nan::New("file").ToLocalChecked(),
+             Nan::New(record.file).ToLocalChecked());
+    Nan::Set(record_obj, Nan::New("line").ToLocalChecked(),
+             Nan::New<Uint32, uint32_t>(record.line));
+    Nan::Set(record_obj, Nan::New("severity").ToLocalChecked(),
+             Nan::New(gpr_log_severity_string(record.severity))
+                 .ToLocalChecked());
+    Nan::Set(record_obj, Nan::New("message").ToLocalChecked(),
+             Nan::New(record.message).ToLocalChecked());
+    Nan::Set(record_obj, Nan::New("truncated").ToLocalChecked(),
+             Nan::New(record.truncated));
+    Nan::Set(record_obj, Nan::New("timestamp").ToLocalChecked(),
+             Nan::New<v8::Date>(
+                 grpc::node::TimespecToMilliseconds(record.timestamp))
+                 .ToLocalChecked());
+    Nan::Set(records, static_cast<uint32_t>(count), record_obj);
+    count++;
   }
+  if (count == grpc_logger_state.pending_records->Capacity()) {
+    // There may be more records, so come back on a later iteration
+    uv_async_send(&grpc_logger_state.async);
+  }
+  uint64_t dropped = grpc_logger_state.pending_records->TakeDropped();
+  if (count == 0 && dropped == 0) {
+    return;
+  }
+  const int argc = 2;
+  Local<Value> argv[argc] = {records,
+                             Nan::New<Number>(static_cast<double>(dropped))};
+  grpc_logger_state.callback->Call(argc, argv, grpc_logger_state.async_resource);
 }
 
 void node_log_func(gpr_log_func_args *args) {
   // TODO(mlumish): Use the core's log formatter when it becomes available
-  log_args *args_copy = new log_args;
-  size_t message_len = strlen(args->message) + 1;
-  char *message = new char[message_len];
-  memcpy(message, args->message, message_len);
-  memcpy(&args_copy->core_args, args, sizeof(gpr_log_func_args));
-  args_copy->core_args.message = message;
-  args_copy->timestamp = gpr_now(GPR_CLOCK_REALTIME);
-
-  uv_mutex_lock(&grpc_logger_state.mutex);
-  grpc_logger_state.pending_args->push(args_copy);
-  uv_mutex_unlock(&grpc_logger_state.mutex);
-
+  if (static_cast<int>(args->severity) <
+      grpc_logger_state.min_severity.load(std::memory_order_relaxed)) {
+    return;
+  }
+  /* If the ring is full the record is only counted, but the loop is still
+   * woken so that it reports the drop */
+  grpc_logger_state.pending_records->Push(args, gpr_now(GPR_CLOCK_REALTIME));
   uv_async_send(&grpc_logger_state.async);
 }
 
 void init_logger() {
-  memset(&grpc_logger_state, 0, sizeof(logger_state));
-  grpc_logger_state.pending_args = new std::queue<log_args *>();
-  uv_mutex_init(&grpc_logger_state.mutex);
+  grpc_logger_state.callback = NULL;
+  grpc_logger_state.async_resource = NULL;
+  grpc_logger_state.pending_records =
+      new grpc::node::LogRing(kLogRingCapacity);
+  grpc_logger_state.min_severity.store(GPR_LOG_SEVERITY_DEBUG,
+                                       std::memory_order_relaxed);
   uv_async_init(uv_default_loop(), &grpc_logger_state.async,
                 LogMessagesCallback);
   uv_unref((uv_handle_t *)&grpc_logger_state.async);
@@ -242,7 +262,9 @@ void init_logger() {
    that handler has to be run in the context of the JavaScript event loop, it
    will be run asynchronously. To minimize the problems that could cause for
    debugging, we leave core to do its default synchronous logging until a
-   JavaScript logger is set */
+   JavaScript logger is set. The callback is called with an array of the
+   records logged since it was last called, and the number of records that
+   were dropped because too many were waiting. */
 NAN_METHOD(SetDefaultLoggerCallback) {
   if (!info[0]->IsFunction()) {
     return Nan::ThrowTypeError(
@@ -262,6 +284,7 @@ NAN_METHOD(SetLogVerbosity) {
   }
   gpr_log_severity severity =
       static_cast<gpr_log_severity>(Nan::To<uint32_t>(info[0]).FromJust());
+  grpc_logger_state.min_severity.store(severity, std::memory_order_relaxed);
   gpr_set_log_verbosity(severity);
 }
 
@@ -269,6 +292,47 @@ NAN_METHOD(ForcePoll) {
   grpc::node::CompletionQueueForcePoll();
 }
 
+NAN_METHOD(SetBatchDispatcher) {
+  if (!info[0]->IsFunction() && !info[0]->IsNull()) {
+    return Nan::ThrowTypeError(
+        "setBatchDispatcher's argument must be a function or null");
+  }
+  grpc::node::CompletionQueueSetDispatcher(info[0]);
+}
+
+/* Returns the hit and miss counts of the pools that batch tags and ops are
+ * allocated from, keyed by the pooled type */
+NAN_METHOD(GetAllocatorStats) {
+  info.GetReturnValue().Set(grpc::node::FreeList::GetAllStats());
+}
+
+/* Returns a snapshot of the batch counts, latency histograms and completion
+ * queue stats for the whole process, with per method stats if they have been
+ * enabled, and the usage of every resource quota */
+NAN_METHOD(GetStats) {
+  info.GetReturnValue().Set(grpc::node::GetStatsSnapshot());
+}
+
+NAN_METHOD(SetPerMethodStats) {
+  if (!info[0]->IsBoolean()) {
+    return Nan::ThrowTypeError(
+        "setPerMethodStats's argument must be a boolean");
+  }
+  grpc::node::SetMethodStatsEnabled(Nan::To<bool>(info[0]).FromJust());
+}
+
+NAN_METHOD(EnableCompletionQueueThread) {
+  if (!grpc::node::CompletionQueueEnablePollThread()) {
+    return Nan::ThrowError(
+        "enableCompletionQueueThread must be called before creating any "
+        "channels or servers");
+  }
+}
+
+/* This module is not context-aware, so node refuses to load it in worker
+   threads. The class templates, string cache and object pools are still
+   process-wide, and the libuv iomgr that the default build uses runs all of
+   core's I/O on the default loop, so other environments could not use it. */
 void init(Local<Object> exports) {
   Nan::HandleScope scope;
   grpc_init();
@@ -281,13 +345,20 @@ void init(Local<Object> exports) {
   grpc_pollset_work_run_loop = 0;
 
   grpc::node::Call::Init(exports);
+  grpc::node::BatchTemplate::Init(exports);
+  grpc::node::PreparedMetadata::Init(exports);
+  grpc::node::MetadataView::Init(exports);
   grpc::node::CallCredentials::Init(exports);
   grpc::node::Channel::Init(exports);
+  grpc::node::ChannelPool::Init(exports);
   grpc::node::ChannelCredentials::Init(exports);
+  grpc::node::ConnectivityMonitor::Init(exports);
+  grpc::node::ResourceQuota::Init(exports);
   grpc::node::Server::Init(exports);
   grpc::node::ServerCredentials::Init(exports);
 
   grpc::node::CompletionQueueInit(exports);
+  grpc::node::ChannelzInit(exports);
 
   // Attach a few utility functions directly to the module
   Nan::Set(exports, Nan::New("metadataKeyIsLegal").ToLocalChecked(),
@@ -313,6 +384,22 @@ void init(Local<Object> exports) {
   Nan::Set(exports, Nan::New("forcePoll").ToLocalChecked(),
            Nan::GetFunction(Nan::New<FunctionTemplate>(ForcePoll))
                .ToLocalChecked());
+  Nan::Set(
+      exports, Nan::New("enableCompletionQueueThread").ToLocalChecked(),
+      Nan::GetFunction(Nan::New<FunctionTemplate>(EnableCompletionQueueThread))
+          .ToLocalChecked());
+  Nan::Set(exports, Nan::New("setBatchDispatcher").ToLocalChecked(),
+           Nan::GetFunction(Nan::New<FunctionTemplate>(SetBatchDispatcher))
+               .ToLocalChecked());
+  Nan::Set(exports, Nan::New("getAllocatorStats").ToLocalChecked(),
+           Nan::GetFunction(Nan::New<FunctionTemplate>(GetAllocatorStats))
+               .ToLocalChecked());
+  Nan::Set(exports, Nan::New("getStats").ToLocalChecked(),
+           Nan::GetFunction(Nan::New<FunctionTemplate>(GetStats))
+               .ToLocalChecked());
+  Nan::Set(exports, Nan::New("setPerMethodStats").ToLocalChecked(),
+           Nan::GetFunction(Nan::New<FunctionTemplate>(SetPerMethodStats))
+               .ToLocalChecked());
 }
 
 NODE_MODULE(grpc_node, init)
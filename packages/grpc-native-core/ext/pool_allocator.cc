@@ -0,0 +1,84 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <nan.h>
+
+#include "grpc/support/alloc.h"
+#include "pool_allocator.h"
+
+namespace grpc {
+namespace node {
+
+using Nan::EscapableHandleScope;
+
+using v8::Local;
+using v8::Number;
+using v8::Object;
+
+namespace {
+// The number of objects allocated at once when a free list runs out
+const size_t kSlabObjects = 64;
+
+size_t RoundUpToAlignment(size_t size) {
+  const size_t alignment = alignof(std::max_align_t);
+  return (size + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+FreeList *FreeList::all_lists = NULL;
+
+FreeList::FreeList(const char *name, size_t object_size)
+    : name(name),
+      object_size(RoundUpToAlignment(object_size < sizeof(FreeNode)
+                                         ? sizeof(FreeNode)
+                                         : object_size)),
+      free_head(NULL),
+      slab_next(NULL),
+      slab_remaining(0),
+      hits(0),
+      misses(0),
+      in_use(0),
+      next_list(all_lists) {
+  all_lists = this;
+}
+
+void FreeList::AllocateSlab() {
+  slab_next =
+      static_cast<char *>(gpr_malloc_aligned(object_size * kSlabObjects,
+                                             alignof(std::max_align_t)));
+  slab_remaining = kSlabObjects;
+}
+
+Local<Object> FreeList::GetAllStats() {
+  EscapableHandleScope scope;
+  Local<Object> stats = Nan::New<Object>();
+  for (FreeList *list = all_lists; list != NULL; list = list->next_list) {
+    Local<Object> list_stats = Nan::New<Object>();
+    Nan::Set(list_stats, Nan::New("hits").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(list->hits)));
+    Nan::Set(list_stats, Nan::New("misses").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(list->misses)));
+    Nan::Set(list_stats, Nan::New("inUse").ToLocalChecked(),
+             Nan::New<Number>(static_cast<double>(list->in_use)));
+    Nan::Set(stats, Nan::New(list->name).ToLocalChecked(), list_stats);
+  }
+  return scope.Escape(stats);
+}
+
+}  // namespace node
+}  // namespace grpc
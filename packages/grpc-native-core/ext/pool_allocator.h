@@ -0,0 +1,126 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef NET_GRPC_NODE_POOL_ALLOCATOR_H_
+#define NET_GRPC_NODE_POOL_ALLOCATOR_H_
+
+#include <cstddef>
+#include <new>
+
+#include <nan.h>
+
+namespace grpc {
+namespace node {
+
+/* Free list of fixed size objects, carved out of slabs that are never
+   returned to the system. This is not thread safe, so it must only be used
+   from the thread running the Node event loop. */
+class FreeList {
+ public:
+  FreeList(const char *name, size_t object_size);
+
+  void *Allocate() {
+    in_use++;
+    if (free_head != NULL) {
+      hits++;
+      FreeNode *node = free_head;
+      free_head = node->next;
+      return node;
+    }
+    misses++;
+    if (slab_remaining == 0) {
+      AllocateSlab();
+    }
+    void *object = slab_next;
+    slab_next += object_size;
+    slab_remaining--;
+    return object;
+  }
+
+  void Free(void *object) {
+    in_use--;
+    FreeNode *node = static_cast<FreeNode *>(object);
+    node->next = free_head;
+    free_head = node;
+  }
+
+  /* Returns an object with the name, hit and miss counts, and number of live
+     objects of every free list that has been created */
+  static v8::Local<v8::Object> GetAllStats();
+
+ private:
+  struct FreeNode {
+    FreeNode *next;
+  };
+
+  // Prevent copying
+  FreeList(const FreeList &);
+  FreeList &operator=(const FreeList &);
+
+  void AllocateSlab();
+
+  const char *name;
+  size_t object_size;
+  FreeNode *free_head;
+  char *slab_next;
+  size_t slab_remaining;
+  // Allocations that reused a freed object
+  size_t hits;
+  // Allocations that had to use fresh slab memory
+  size_t misses;
+  size_t in_use;
+  // All free lists, for reporting stats
+  FreeList *next_list;
+  static FreeList *all_lists;
+};
+
+/* Base class that makes "new T" and "delete T" use a FreeList shared by all
+   instances of T. Subclasses of T with a different size fall back to the
+   global allocator. */
+template <typename T>
+class Pooled {
+ public:
+  static void *operator new(size_t size) {
+    if (size != sizeof(T)) {
+      return ::operator new(size);
+    }
+    return GetFreeList().Allocate();
+  }
+
+  static void operator delete(void *object, size_t size) {
+    if (object == NULL) {
+      return;
+    }
+    if (size != sizeof(T)) {
+      ::operator delete(object);
+      return;
+    }
+    GetFreeList().Free(object);
+  }
+
+ private:
+  static FreeList &GetFreeList() {
+    static FreeList free_list(T::PoolName(), sizeof(T));
+    return free_list;
+  }
+};
+
+}  // namespace node
+}  // namespace grpc
+
+#endif  // NET_GRPC_NODE_POOL_ALLOCATOR_H_
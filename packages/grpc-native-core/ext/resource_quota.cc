@@ -0,0 +1,215 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <nan.h>
+#include <node.h>
+#include <uv.h>
+#include "grpc/grpc.h"
+#include "grpc/support/log.h"
+#include "src/core/lib/iomgr/resource_quota.h"
+
+#include "resource_quota.h"
+
+namespace grpc {
+namespace node {
+
+using Nan::Callback;
+using Nan::EscapableHandleScope;
+using Nan::HandleScope;
+using Nan::ObjectWrap;
+using Nan::Persistent;
+using Nan::Utf8String;
+
+using v8::Array;
+using v8::Function;
+using v8::FunctionTemplate;
+using v8::Local;
+using v8::Object;
+using v8::Value;
+
+Callback *ResourceQuota::constructor;
+Persistent<FunctionTemplate> ResourceQuota::fun_tpl;
+
+/* Every live quota, for the process stats. The list is process-wide, so it
+   is guarded by a mutex. */
+static uv_once_t quotas_once = UV_ONCE_INIT;
+static uv_mutex_t quotas_mutex;
+static std::vector<ResourceQuota *> *quotas;
+
+static void InitQuotas() {
+  GPR_ASSERT(uv_mutex_init(&quotas_mutex) == 0);
+  quotas = new std::vector<ResourceQuota *>();
+}
+
+ResourceQuota::ResourceQuota(grpc_resource_quota *quota,
+                             const std::string &name, size_t limit)
+    : wrapped_quota(quota), name(name), limit(limit) {
+  uv_once(&quotas_once, InitQuotas);
+  uv_mutex_lock(&quotas_mutex);
+  quotas->push_back(this);
+  uv_mutex_unlock(&quotas_mutex);
+}
+
+ResourceQuota::~ResourceQuota() {
+  uv_mutex_lock(&quotas_mutex);
+  quotas->erase(std::remove(quotas->begin(), quotas->end(), this),
+                quotas->end());
+  uv_mutex_unlock(&quotas_mutex);
+  // Channels and servers that were created with the quota keep their own refs
+  grpc_resource_quota_unref(wrapped_quota);
+}
+
+void ResourceQuota::Init(Local<Object> exports) {
+  HandleScope scope;
+  Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
+  tpl->SetClassName(Nan::New("ResourceQuota").ToLocalChecked());
+  tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Nan::SetPrototypeMethod(tpl, "resize", Resize);
+  Nan::SetPrototypeMethod(tpl, "getUsage", GetUsage);
+  fun_tpl.Reset(tpl);
+  Local<Function> ctr = Nan::GetFunction(tpl).ToLocalChecked();
+  Nan::Set(exports, Nan::New("ResourceQuota").ToLocalChecked(), ctr);
+  constructor = new Callback(ctr);
+}
+
+bool ResourceQuota::HasInstance(Local<Value> val) {
+  HandleScope scope;
+  return Nan::New(fun_tpl)->HasInstance(val);
+}
+
+grpc_resource_quota *ResourceQuota::GetWrappedQuota(Local<Value> val) {
+  if (!HasInstance(val)) {
+    return NULL;
+  }
+  ResourceQuota *quota = ObjectWrap::Unwrap<ResourceQuota>(
+      Nan::To<Object>(val).ToLocalChecked());
+  return quota->wrapped_quota;
+}
+
+Local<Object> ResourceQuota::GetUsageSnapshot() const {
+  EscapableHandleScope scope;
+  size_t current_limit = limit.load(std::memory_order_relaxed);
+  /* Core only keeps an estimate of its memory pressure, as the fraction of
+     the limit that is in use */
+  double usage = grpc_resource_quota_get_memory_pressure(wrapped_quota) *
+                 static_cast<double>(current_limit);
+  Local<Object> snapshot = Nan::New<Object>();
+  Nan::Set(snapshot, Nan::New("name").ToLocalChecked(),
+           Nan::New(name).ToLocalChecked());
+  Nan::Set(snapshot, Nan::New("limit").ToLocalChecked(),
+           Nan::New(static_cast<double>(current_limit)));
+  Nan::Set(snapshot, Nan::New("usage").ToLocalChecked(), Nan::New(usage));
+  return scope.Escape(snapshot);
+}
+
+/* Reads a memory limit in bytes, which must be a positive integer. Returns
+   false if val is not one */
+static bool ParseLimit(Local<Value> val, size_t *limit) {
+  if (!val->IsNumber()) {
+    return false;
+  }
+  double value = Nan::To<double>(val).FromJust();
+  // NaN fails the second check
+  if (value < 1 || value != floor(value) ||
+      value > static_cast<double>(SIZE_MAX)) {
+    return false;
+  }
+  *limit = static_cast<size_t>(value);
+  return true;
+}
+
+NAN_METHOD(ResourceQuota::New) {
+  /* Arguments:
+   * 0: The most memory in bytes that core will use for the channels and
+   *    servers created with the quota
+   * 1: Optional name for the quota, which is included in its stats
+   */
+  if (!info.IsConstructCall()) {
+    return Nan::ThrowTypeError(
+        "ResourceQuota can only be created with the new operator");
+  }
+  size_t limit;
+  if (!ParseLimit(info[0], &limit)) {
+    return Nan::ThrowTypeError(
+        "ResourceQuota's first argument must be a positive integer");
+  }
+  std::string name;
+  if (!info[1]->IsUndefined()) {
+    if (!info[1]->IsString()) {
+      return Nan::ThrowTypeError(
+          "ResourceQuota's second argument must be a string");
+    }
+    Utf8String name_str(info[1]);
+    name.assign(*name_str, name_str.length());
+  }
+  grpc_resource_quota *wrapped_quota =
+      grpc_resource_quota_create(name.empty() ? NULL : name.c_str());
+  grpc_resource_quota_resize(wrapped_quota, limit);
+  ResourceQuota *quota = new ResourceQuota(wrapped_quota, name, limit);
+  quota->Wrap(info.This());
+  info.GetReturnValue().Set(info.This());
+}
+
+NAN_METHOD(ResourceQuota::Resize) {
+  /* Arguments:
+   * 0: The new memory limit in bytes. Core frees memory down to the new limit
+   *    over time, so usage can stay above it for a while.
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "resize can only be called on ResourceQuota objects");
+  }
+  size_t limit;
+  if (!ParseLimit(info[0], &limit)) {
+    return Nan::ThrowTypeError("resize's argument must be a positive integer");
+  }
+  ResourceQuota *quota = ObjectWrap::Unwrap<ResourceQuota>(info.This());
+  grpc_resource_quota_resize(quota->wrapped_quota, limit);
+  quota->limit.store(limit, std::memory_order_relaxed);
+}
+
+NAN_METHOD(ResourceQuota::GetUsage) {
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "getUsage can only be called on ResourceQuota objects");
+  }
+  ResourceQuota *quota = ObjectWrap::Unwrap<ResourceQuota>(info.This());
+  info.GetReturnValue().Set(quota->GetUsageSnapshot());
+}
+
+Local<Array> GetResourceQuotaStats() {
+  EscapableHandleScope scope;
+  Local<Array> stats = Nan::New<Array>();
+  uv_once(&quotas_once, InitQuotas);
+  uv_mutex_lock(&quotas_mutex);
+  for (size_t i = 0; i < quotas->size(); i++) {
+    Nan::Set(stats, static_cast<uint32_t>(i),
+             (*quotas)[i]->GetUsageSnapshot());
+  }
+  uv_mutex_unlock(&quotas_mutex);
+  return scope.Escape(stats);
+}
+
+}  // namespace node
+}  // namespace grpc
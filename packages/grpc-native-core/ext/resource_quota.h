@@ -0,0 +1,79 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef NET_GRPC_NODE_RESOURCE_QUOTA_H_
+#define NET_GRPC_NODE_RESOURCE_QUOTA_H_
+
+#include <stddef.h>
+#include <atomic>
+#include <string>
+
+#include <nan.h>
+#include <node.h>
+#include "grpc/grpc.h"
+
+namespace grpc {
+namespace node {
+
+/* Wrapper for grpc_resource_quota structs. A quota bounds the memory that
+   core uses for the channels and servers it is passed to as the
+   grpc.resource_quota option, and it can be shared between several of
+   them. */
+class ResourceQuota : public Nan::ObjectWrap {
+ public:
+  static void Init(v8::Local<v8::Object> exports);
+  static bool HasInstance(v8::Local<v8::Value> val);
+
+  /* Returns the quota wrapped by the given ResourceQuota object, or NULL if
+     val is not one */
+  static grpc_resource_quota *GetWrappedQuota(v8::Local<v8::Value> val);
+
+ private:
+  ResourceQuota(grpc_resource_quota *quota, const std::string &name,
+                size_t limit);
+  ~ResourceQuota();
+
+  // Prevent copying
+  ResourceQuota(const ResourceQuota &);
+  ResourceQuota &operator=(const ResourceQuota &);
+
+  static NAN_METHOD(New);
+  static NAN_METHOD(Resize);
+  static NAN_METHOD(GetUsage);
+  static Nan::Callback *constructor;
+  static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
+
+  friend v8::Local<v8::Array> GetResourceQuotaStats();
+
+  // Returns the name, limit and estimated usage of this quota
+  v8::Local<v8::Object> GetUsageSnapshot() const;
+
+  grpc_resource_quota *wrapped_quota;
+  std::string name;
+  // Only changed on the javascript thread, but read by stats from any thread
+  std::atomic<size_t> limit;
+};
+
+/* Returns the name, limit and estimated usage in bytes of every live quota,
+   for the process stats */
+v8::Local<v8::Array> GetResourceQuotaStats();
+
+}  // namespace node
+}  // namespace grpc
+
+#endif  // NET_GRPC_NODE_RESOURCE_QUOTA_H_
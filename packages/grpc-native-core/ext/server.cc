@@ -16,6 +16,7 @@
  *
  */
 
+#include <limits>
 #include <memory>
 
 #include "server.h"
@@ -24,13 +25,16 @@
 #include <node.h>
 
 #include <vector>
+#include "byte_buffer.h"
 #include "call.h"
+#include "channelz.h"
 #include "completion_queue.h"
 #include "grpc/grpc.h"
 #include "grpc/grpc_security.h"
 #include "grpc/support/log.h"
 #include "server_credentials.h"
 #include "slice.h"
+#include "stats.h"
 #include "timeval.h"
 
 namespace grpc {
@@ -89,10 +93,43 @@ class ServerShutdownOp : public Op {
   std::string GetTypeString() const { return "try_shutdown"; }
 };
 
-class NewCallOp : public Op {
+class ServerDrainOp : public Op {
  public:
+  explicit ServerDrainOp(Server *server) : server(server) {}
+
+  Local<Value> GetNodeValue() const {
+    EscapableHandleScope scope;
+    Local<Object> result = Nan::New<Object>();
+    Nan::Set(result, Nan::New("cancelledCalls").ToLocalChecked(),
+             Nan::New(static_cast<double>(server->drain_cancelled_calls)));
+    return scope.Escape(result);
+  }
+
+  bool ParseOp(Local<Value> value, grpc_op *out) { return true; }
+  bool IsFinalOp() { return false; }
+  void OnComplete(bool success) {
+    server->FinishDrain();
+    if (success) {
+      server->FinishShutdown();
+    }
+  }
+
+ protected:
+  std::string GetTypeString() const { return "drain"; }
+
+ private:
+  Server *server;
+};
+
+class NewCallOp : public Op, public Pooled<NewCallOp> {
+ public:
+  static const char *PoolName() { return "newCallOp"; }
   NewCallOp() {
     call = NULL;
+    repost_server = NULL;
+    registered_method = NULL;
+    payload = NULL;
+    metadata_view = false;
     grpc_call_details_init(&details);
     grpc_metadata_array_init(&request_metadata);
   }
@@ -100,6 +137,9 @@ class NewCallOp : public Op {
   ~NewCallOp() {
     grpc_call_details_destroy(&details);
     grpc_metadata_array_destroy(&request_metadata);
+    if (payload != NULL) {
+      grpc_byte_buffer_destroy(payload);
+    }
   }
 
   Local<Value> GetNodeValue() const {
@@ -108,27 +148,79 @@ class NewCallOp : public Op {
       return scope.Escape(Nan::Null());
     }
     Local<Object> obj = Nan::New<Object>();
-    Nan::Set(obj, Nan::New("call").ToLocalChecked(), Call::WrapStruct(call));
-    // TODO(murgatroid99): Use zero-copy string construction instead
-    Nan::Set(obj, Nan::New("method").ToLocalChecked(),
-             CopyStringFromSlice(details.method));
-    Nan::Set(obj, Nan::New("host").ToLocalChecked(),
-             CopyStringFromSlice(details.host));
-    Nan::Set(obj, Nan::New("deadline").ToLocalChecked(),
-             Nan::New<Date>(TimespecToMilliseconds(details.deadline))
-                 .ToLocalChecked());
+    Local<Value> call_value = Call::WrapStruct(call);
+    Nan::Set(obj, Nan::New("call").ToLocalChecked(), call_value);
+    if (in_flight_calls && Call::HasInstance(call_value)) {
+      ObjectWrap::Unwrap<Call>(Nan::To<Object>(call_value).ToLocalChecked())
+          ->TrackOutstanding(in_flight_calls);
+    }
+    if (MethodStatsEnabled() && Call::HasInstance(call_value)) {
+      MethodStats *method_stats;
+      if (registered_method == NULL) {
+        grpc_slice method = details.method;
+        method_stats = GetMethodStats(
+            reinterpret_cast<const char *>(GRPC_SLICE_START_PTR(method)),
+            GRPC_SLICE_LENGTH(method));
+      } else {
+        Utf8String path(Nan::New(registered_method->path));
+        method_stats = GetMethodStats(*path, path.length());
+      }
+      if (method_stats != NULL) {
+        ObjectWrap::Unwrap<Call>(Nan::To<Object>(call_value).ToLocalChecked())
+            ->SetMethodStats(method_stats);
+      }
+    }
+    if (registered_method == NULL) {
+      Nan::Set(obj, Nan::New("method").ToLocalChecked(),
+               CachedStringFromSlice(details.method));
+      Nan::Set(obj, Nan::New("host").ToLocalChecked(),
+               CachedStringFromSlice(details.host));
+      Nan::Set(obj, Nan::New("deadline").ToLocalChecked(),
+               Nan::New<Date>(TimespecToMilliseconds(details.deadline))
+                   .ToLocalChecked());
+    } else {
+      // Core does not report the method and host for registered calls
+      Nan::Set(obj, Nan::New("method").ToLocalChecked(),
+               Nan::New(registered_method->path));
+      Nan::Set(obj, Nan::New("host").ToLocalChecked(), Nan::Null());
+      Nan::Set(obj, Nan::New("deadline").ToLocalChecked(),
+               Nan::New<Date>(TimespecToMilliseconds(deadline))
+                   .ToLocalChecked());
+      if (registered_method->read_payload) {
+        // This is null if the client closed without sending a message
+        Nan::Set(obj, Nan::New("payload").ToLocalChecked(),
+                 ByteBufferToBuffer(payload));
+      }
+    }
     Nan::Set(obj, Nan::New("metadata").ToLocalChecked(),
-             ParseMetadata(&request_metadata));
+             ReceivedMetadataValue(&request_metadata, metadata_view));
     return scope.Escape(obj);
   }
 
   bool ParseOp(Local<Value> value, grpc_op *out) { return true; }
   bool IsFinalOp() { return false; }
-  void OnComplete(bool success) {}
+  void OnComplete(bool success) {
+    // Requests only fail when the server is shutting down
+    if (success && repost_server != NULL) {
+      repost_server->RepostRequestCall(registered_method);
+    }
+  }
 
   grpc_call *call;
+  // The server to post a replacement request on, for pooled requests
+  Server *repost_server;
+  // The method this request is for, or NULL for a generic request
+  Server::RegisteredMethod *registered_method;
+  // Only filled in for generic requests
   grpc_call_details details;
+  // Only filled in for registered method requests
+  gpr_timespec deadline;
+  grpc_byte_buffer *payload;
   grpc_metadata_array request_metadata;
+  // Whether the metadata is passed to JS as a MetadataView
+  bool metadata_view;
+  // The server's count of in flight calls, which the new call is added to
+  std::shared_ptr<size_t> in_flight_calls;
 
  protected:
   std::string GetTypeString() const { return "new_call"; }
@@ -141,10 +233,18 @@ NAN_METHOD(ShutdownCallback) {
   }
 }
 
-Server::Server(grpc_server *server) :
-    wrapped_server(server), is_shutdown(false) {}
-
-Server::~Server() { grpc_server_destroy(this->wrapped_server); }
+Server::Server(grpc_server *server)
+    : wrapped_server(server),
+      is_shutdown(false),
+      metadata_views(false),
+      in_flight_calls(new size_t(0)),
+      drain_timer(NULL),
+      drain_cancelled_calls(0) {}
+
+Server::~Server() {
+  FinishDrain();
+  grpc_server_destroy(this->wrapped_server);
+}
 
 void Server::Init(Local<Object> exports) {
   HandleScope scope;
@@ -152,10 +252,18 @@ void Server::Init(Local<Object> exports) {
   tpl->SetClassName(Nan::New("Server").ToLocalChecked());
   tpl->InstanceTemplate()->SetInternalFieldCount(1);
   Nan::SetPrototypeMethod(tpl, "requestCall", RequestCall);
+  Nan::SetPrototypeMethod(tpl, "requestCalls", RequestCalls);
+  Nan::SetPrototypeMethod(tpl, "registerMethod", RegisterMethod);
+  Nan::SetPrototypeMethod(tpl, "requestRegisteredCall",
+                          RequestRegisteredCall);
   Nan::SetPrototypeMethod(tpl, "addHttp2Port", AddHttp2Port);
   Nan::SetPrototypeMethod(tpl, "start", Start);
   Nan::SetPrototypeMethod(tpl, "tryShutdown", TryShutdown);
   Nan::SetPrototypeMethod(tpl, "forceShutdown", ForceShutdown);
+  Nan::SetPrototypeMethod(tpl, "drain", Drain);
+  Nan::SetPrototypeMethod(tpl, "getInFlightCalls", GetInFlightCalls);
+  Nan::SetPrototypeMethod(tpl, "getChannelz", GetChannelz);
+  Nan::SetPrototypeMethod(tpl, "setMetadataViews", SetMetadataViews);
   fun_tpl.Reset(tpl);
   Local<Function> ctr = Nan::GetFunction(tpl).ToLocalChecked();
   Nan::Set(exports, Nan::New("Server").ToLocalChecked(), ctr);
@@ -175,18 +283,35 @@ void Server::FinishShutdown() {
   running_self_ref.Reset();
 }
 
+static void DeleteDrainTimer(uv_handle_t *handle) {
+  delete reinterpret_cast<uv_timer_t *>(handle);
+}
+
+void Server::FinishDrain() {
+  if (drain_timer != NULL) {
+    uv_close(reinterpret_cast<uv_handle_t *>(drain_timer), DeleteDrainTimer);
+    drain_timer = NULL;
+  }
+}
+
+void Server::DrainDeadlineCallback(uv_timer_t *handle) {
+  Server *server = static_cast<Server *>(handle->data);
+  server->drain_cancelled_calls = *server->in_flight_calls;
+  server->FinishDrain();
+  grpc_server_cancel_all_calls(server->wrapped_server);
+}
+
 void Server::ShutdownServer() {
   Nan::HandleScope scope;
   if (!this->is_shutdown) {
-    Callback *shutdown_callback =
-        new Callback(Nan::New(shutdown_cb));
     ServerShutdownOp *op = new ServerShutdownOp(this);
     unique_ptr<OpVec> ops(new OpVec());
     ops->push_back(unique_ptr<Op>(op));
 
     grpc_server_shutdown_and_notify(
         this->wrapped_server, GetCompletionQueue(),
-        new struct tag(shutdown_callback, ops.release(), NULL, Nan::Null()));
+        new struct tag(Nan::New(shutdown_cb), ops.release(), NULL,
+                       Nan::Null()));
     grpc_server_cancel_all_calls(this->wrapped_server);
     CompletionQueueNext();
   }
@@ -215,7 +340,8 @@ NAN_METHOD(Server::New) {
     DeallocateChannelArgs(channel_args);
     return Nan::ThrowTypeError(
         "Server options must be an object with "
-        "string keys and integer or string values");
+        "string keys and integer or string values, or a ResourceQuota "
+        "for grpc.resource_quota");
   }
   wrapped_server = grpc_server_create(channel_args, NULL);
   DeallocateChannelArgs(channel_args);
@@ -225,23 +351,203 @@ NAN_METHOD(Server::New) {
   info.GetReturnValue().Set(info.This());
 }
 
+grpc_call_error Server::RequestCallWithCallback(Local<Function> callback,
+                                                bool pooled,
+                                                RegisteredMethod *method) {
+  NewCallOp *op = new NewCallOp();
+  if (pooled) {
+    op->repost_server = this;
+  }
+  op->registered_method = method;
+  op->metadata_view = metadata_views;
+  op->in_flight_calls = in_flight_calls;
+  unique_ptr<OpVec> ops(new OpVec());
+  ops->push_back(unique_ptr<Op>(op));
+  struct tag *tag_struct = new struct tag(callback, ops.release(), NULL,
+                                          Nan::Null());
+  grpc_call_error error;
+  if (method == NULL) {
+    error = grpc_server_request_call(
+        wrapped_server, &op->call, &op->details, &op->request_metadata,
+        GetCompletionQueue(), GetCompletionQueue(), tag_struct);
+  } else {
+    error = grpc_server_request_registered_call(
+        wrapped_server, method->handle, &op->call, &op->deadline,
+        &op->request_metadata, method->read_payload ? &op->payload : NULL,
+        GetCompletionQueue(), GetCompletionQueue(), tag_struct);
+  }
+  if (error == GRPC_CALL_OK) {
+    CompletionQueueNext();
+  } else {
+    DestroyTag(tag_struct);
+  }
+  return error;
+}
+
+void Server::RepostRequestCall(RegisteredMethod *method) {
+  HandleScope scope;
+  Nan::Callback *callback =
+      method == NULL ? &pooled_request_callback
+                     : &method->pooled_request_callback;
+  if (is_shutdown || callback->IsEmpty()) {
+    return;
+  }
+  grpc_call_error error =
+      RequestCallWithCallback(callback->GetFunction(), true, method);
+  if (error != GRPC_CALL_OK) {
+    gpr_log(GPR_ERROR, "Failed to re-post a pooled call request: %d", error);
+  }
+}
+
+/* Gets the registered method with the id in the given argument, or NULL if
+ * the argument is not a valid id */
+static Server::RegisteredMethod *GetRegisteredMethod(
+    const std::vector<unique_ptr<Server::RegisteredMethod>> &methods,
+    Local<Value> id) {
+  if (!id->IsUint32()) {
+    return NULL;
+  }
+  uint32_t index = Nan::To<uint32_t>(id).FromJust();
+  if (index >= methods.size()) {
+    return NULL;
+  }
+  return methods[index].get();
+}
+
 NAN_METHOD(Server::RequestCall) {
   if (!HasInstance(info.This())) {
     return Nan::ThrowTypeError("requestCall can only be called on a Server");
   }
   Server *server = ObjectWrap::Unwrap<Server>(info.This());
-  NewCallOp *op = new NewCallOp();
-  unique_ptr<OpVec> ops(new OpVec());
-  ops->push_back(unique_ptr<Op>(op));
-  grpc_call_error error = grpc_server_request_call(
-      server->wrapped_server, &op->call, &op->details, &op->request_metadata,
-      GetCompletionQueue(), GetCompletionQueue(),
-      new struct tag(new Callback(info[0].As<Function>()), ops.release(), NULL,
-                     Nan::Null()));
+  grpc_call_error error =
+      server->RequestCallWithCallback(info[0].As<Function>(), false, NULL);
   if (error != GRPC_CALL_OK) {
     return Nan::ThrowError(nanErrorWithCode("requestCall failed", error));
   }
-  CompletionQueueNext();
+}
+
+NAN_METHOD(Server::RequestCalls) {
+  /* Arguments:
+   * 0: The number of call requests to keep outstanding
+   * 1: Callback for each incoming call
+   * 2: Optional registered method id, to only accept calls to that method
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError("requestCalls can only be called on a Server");
+  }
+  if (!info[0]->IsUint32() || Nan::To<uint32_t>(info[0]).FromJust() == 0) {
+    return Nan::ThrowTypeError(
+        "requestCalls's first argument must be a positive integer");
+  }
+  if (!info[1]->IsFunction()) {
+    return Nan::ThrowTypeError(
+        "requestCalls's second argument must be a callback");
+  }
+  Server *server = ObjectWrap::Unwrap<Server>(info.This());
+  RegisteredMethod *method = NULL;
+  Nan::Callback *callback = &server->pooled_request_callback;
+  if (!(info[2]->IsUndefined() || info[2]->IsNull())) {
+    method = GetRegisteredMethod(server->registered_methods, info[2]);
+    if (method == NULL) {
+      return Nan::ThrowTypeError(
+          "requestCalls's third argument must be a registered method id");
+    }
+    callback = &method->pooled_request_callback;
+  }
+  if (!callback->IsEmpty()) {
+    return Nan::ThrowError(
+        "requestCalls can only be called once for each method");
+  }
+  callback->Reset(info[1].As<Function>());
+  uint32_t depth = Nan::To<uint32_t>(info[0]).FromJust();
+  for (uint32_t i = 0; i < depth; i++) {
+    grpc_call_error error =
+        server->RequestCallWithCallback(info[1].As<Function>(), true, method);
+    if (error != GRPC_CALL_OK) {
+      return Nan::ThrowError(nanErrorWithCode("requestCalls failed", error));
+    }
+  }
+}
+
+NAN_METHOD(Server::RegisterMethod) {
+  /* Arguments:
+   * 0: Method path
+   * 1: Optional boolean, true to receive the request message with the call
+   * Returns an id to pass to requestRegisteredCall and requestCalls
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "registerMethod can only be called on a Server");
+  }
+  if (!info[0]->IsString()) {
+    return Nan::ThrowTypeError("registerMethod's argument must be a string");
+  }
+  Server *server = ObjectWrap::Unwrap<Server>(info.This());
+  if (!server->running_self_ref.IsEmpty()) {
+    return Nan::ThrowError(
+        "registerMethod must be called before the server is started");
+  }
+  bool read_payload = Nan::To<bool>(info[1]).FromMaybe(false);
+  void *handle = grpc_server_register_method(
+      server->wrapped_server, *Utf8String(info[0]), NULL,
+      read_payload ? GRPC_SRM_PAYLOAD_READ_INITIAL_BYTE_BUFFER
+                   : GRPC_SRM_PAYLOAD_NONE,
+      0);
+  if (handle == NULL) {
+    return Nan::ThrowError("registerMethod failed for a duplicate method");
+  }
+  RegisteredMethod *method = new RegisteredMethod();
+  method->handle = handle;
+  method->read_payload = read_payload;
+  method->path.Reset(Nan::To<String>(info[0]).ToLocalChecked());
+  server->registered_methods.push_back(unique_ptr<RegisteredMethod>(method));
+  double id = static_cast<double>(server->registered_methods.size() - 1);
+  info.GetReturnValue().Set(Nan::New<Number>(id));
+}
+
+NAN_METHOD(Server::RequestRegisteredCall) {
+  /* Arguments:
+   * 0: Registered method id
+   * 1: Callback
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "requestRegisteredCall can only be called on a Server");
+  }
+  Server *server = ObjectWrap::Unwrap<Server>(info.This());
+  RegisteredMethod *method =
+      GetRegisteredMethod(server->registered_methods, info[0]);
+  if (method == NULL) {
+    return Nan::ThrowTypeError(
+        "requestRegisteredCall's first argument must be a registered method "
+        "id");
+  }
+  if (!info[1]->IsFunction()) {
+    return Nan::ThrowTypeError(
+        "requestRegisteredCall's second argument must be a callback");
+  }
+  grpc_call_error error =
+      server->RequestCallWithCallback(info[1].As<Function>(), false, method);
+  if (error != GRPC_CALL_OK) {
+    return Nan::ThrowError(
+        nanErrorWithCode("requestRegisteredCall failed", error));
+  }
+}
+
+NAN_METHOD(Server::SetMetadataViews) {
+  /* Arguments:
+   * 0: Boolean, true to pass the metadata of calls requested after this as
+   *    MetadataView objects instead of plain objects
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "setMetadataViews can only be called on a Server");
+  }
+  if (!info[0]->IsBoolean()) {
+    return Nan::ThrowTypeError("setMetadataViews's argument must be a boolean");
+  }
+  Server *server = ObjectWrap::Unwrap<Server>(info.This());
+  server->metadata_views = Nan::To<bool>(info[0]).FromJust();
 }
 
 NAN_METHOD(Server::AddHttp2Port) {
@@ -259,14 +565,24 @@ NAN_METHOD(Server::AddHttp2Port) {
   Server *server = ObjectWrap::Unwrap<Server>(info.This());
   ServerCredentials *creds_object = ObjectWrap::Unwrap<ServerCredentials>(
       Nan::To<Object>(info[1]).ToLocalChecked());
-  grpc_server_credentials *creds = creds_object->GetWrappedServerCredentials();
   int port;
-  if (creds == NULL) {
-    port = grpc_server_add_insecure_http2_port(server->wrapped_server,
-                                               *Utf8String(info[0]));
-  } else {
+  if (creds_object->IsReloadable()) {
+    grpc_server_credentials *creds =
+        creds_object->CreateReloadableCredentials();
     port = grpc_server_add_secure_http2_port(server->wrapped_server,
                                              *Utf8String(info[0]), creds);
+    // The port keeps its own reference to the credentials
+    grpc_server_credentials_release(creds);
+  } else {
+    grpc_server_credentials *creds =
+        creds_object->GetWrappedServerCredentials();
+    if (creds == NULL) {
+      port = grpc_server_add_insecure_http2_port(server->wrapped_server,
+                                                 *Utf8String(info[0]));
+    } else {
+      port = grpc_server_add_secure_http2_port(server->wrapped_server,
+                                               *Utf8String(info[0]), creds);
+    }
   }
   info.GetReturnValue().Set(Nan::New<Number>(port));
 }
@@ -295,8 +611,8 @@ NAN_METHOD(Server::TryShutdown) {
   ops->push_back(unique_ptr<Op>(op));
   grpc_server_shutdown_and_notify(
       server->wrapped_server, GetCompletionQueue(),
-      new struct tag(new Nan::Callback(info[0].As<Function>()), ops.release(),
-                     NULL, Nan::Null()));
+      new struct tag(info[0].As<Function>(), ops.release(), NULL,
+                     Nan::Null()));
   CompletionQueueNext();
 }
 
@@ -309,5 +625,69 @@ NAN_METHOD(Server::ForceShutdown) {
   server->ShutdownServer();
 }
 
+NAN_METHOD(Server::Drain) {
+  /* Arguments:
+   * 0: Deadline for the calls in flight to finish, as a Date or a number of
+   *    milliseconds since the epoch. Infinity waits for them indefinitely
+   * 1: Callback for when the server has shut down, with the number of calls
+   *    that were cancelled at the deadline
+   * The server stops accepting new calls immediately. */
+  Nan::HandleScope scope;
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError("drain can only be called on a Server");
+  }
+  if (!info[0]->IsDate() && !info[0]->IsNumber()) {
+    return Nan::ThrowTypeError("drain's first argument must be a deadline");
+  }
+  if (!info[1]->IsFunction()) {
+    return Nan::ThrowTypeError("drain's second argument must be a callback");
+  }
+  Server *server = ObjectWrap::Unwrap<Server>(info.This());
+  if (server->drain_timer != NULL) {
+    return Nan::ThrowError("The server is already draining");
+  }
+  double deadline = Nan::To<double>(info[0]).FromJust();
+  server->drain_cancelled_calls = 0;
+  if (deadline != std::numeric_limits<double>::infinity()) {
+    double now = TimespecToMilliseconds(gpr_now(GPR_CLOCK_REALTIME));
+    double timeout = deadline > now ? deadline - now : 0;
+    server->drain_timer = new uv_timer_t;
+    uv_timer_init(uv_default_loop(), server->drain_timer);
+    server->drain_timer->data = server;
+    uv_timer_start(server->drain_timer, DrainDeadlineCallback,
+                   static_cast<uint64_t>(timeout), 0);
+  }
+  ServerDrainOp *op = new ServerDrainOp(server);
+  unique_ptr<OpVec> ops(new OpVec());
+  ops->push_back(unique_ptr<Op>(op));
+  grpc_server_shutdown_and_notify(
+      server->wrapped_server, GetCompletionQueue(),
+      new struct tag(info[1].As<Function>(), ops.release(), NULL,
+                     Nan::Null()));
+  CompletionQueueNext();
+}
+
+NAN_METHOD(Server::GetInFlightCalls) {
+  /* Returns the number of calls that have been accepted and have not
+   * finished. While the server drains, this reports its progress. */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "getInFlightCalls can only be called on a Server");
+  }
+  Server *server = ObjectWrap::Unwrap<Server>(info.This());
+  info.GetReturnValue().Set(
+      Nan::New(static_cast<double>(*server->in_flight_calls)));
+}
+
+NAN_METHOD(Server::GetChannelz) {
+  /* Returns the server's channelz data, with its call counts, last call time
+   * and the ids of its listen sockets, or null if channelz is disabled */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError("getChannelz can only be called on a Server");
+  }
+  Server *server = ObjectWrap::Unwrap<Server>(info.This());
+  info.GetReturnValue().Set(GetServerChannelz(server->wrapped_server));
+}
+
 }  // namespace node
 }  // namespace grpc
@@ -19,8 +19,12 @@
 #ifndef NET_GRPC_NODE_SERVER_H_
 #define NET_GRPC_NODE_SERVER_H_
 
+#include <memory>
+#include <vector>
+
 #include <nan.h>
 #include <node.h>
+#include <uv.h>
 #include "grpc/grpc.h"
 
 namespace grpc {
@@ -39,8 +43,29 @@ class Server : public Nan::ObjectWrap {
   static bool HasInstance(v8::Local<v8::Value> val);
 
   void FinishShutdown();
+  // Stops the drain timer, after the shutdown that it bounds has completed
+  void FinishDrain();
+
+  /* A method registered with grpc_server_register_method. Calls to it are
+     matched by core, and only delivered to requests for that method. */
+  struct RegisteredMethod {
+    void *handle;
+    Nan::Persistent<v8::String> path;
+    /* Whether core reads the request message before completing the request
+       for the call, so it arrives along with the new call */
+    bool read_payload;
+    // The callback for every call accepted through requestCalls
+    Nan::Callback pooled_request_callback;
+  };
+
+  /* Replaces a request from the pool started by requestCalls that has
+     completed with a new one. method is NULL for the pool of generic
+     requests */
+  void RepostRequestCall(RegisteredMethod *method);
 
  private:
+  friend class ServerDrainOp;
+
   explicit Server(grpc_server *server);
   ~Server();
 
@@ -49,19 +74,51 @@ class Server : public Nan::ObjectWrap {
   Server &operator=(const Server &);
 
   void ShutdownServer();
+  /* Called when a drain's deadline passes before its shutdown completes.
+     Cancels the calls that are still in flight */
+  static void DrainDeadlineCallback(uv_timer_t *handle);
+  /* Asks core for the next incoming call to the given registered method, or
+     for the next call to any unregistered method if method is NULL. The
+     request completes with the given callback. If pooled is true, the request
+     is re-posted when it completes */
+  grpc_call_error RequestCallWithCallback(v8::Local<v8::Function> callback,
+                                          bool pooled,
+                                          RegisteredMethod *method);
 
   static NAN_METHOD(New);
   static NAN_METHOD(RequestCall);
+  static NAN_METHOD(RequestCalls);
+  static NAN_METHOD(RegisterMethod);
+  static NAN_METHOD(RequestRegisteredCall);
   static NAN_METHOD(AddHttp2Port);
   static NAN_METHOD(Start);
   static NAN_METHOD(TryShutdown);
   static NAN_METHOD(ForceShutdown);
+  static NAN_METHOD(Drain);
+  static NAN_METHOD(GetInFlightCalls);
+  static NAN_METHOD(GetChannelz);
+  static NAN_METHOD(SetMetadataViews);
   static Nan::Callback *constructor;
   static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
   Nan::Persistent<v8::Value> running_self_ref;
 
   grpc_server *wrapped_server;
   bool is_shutdown;
+  // Whether new calls' metadata is passed to JS as a MetadataView
+  bool metadata_views;
+  // The callback for every generic call accepted through requestCalls
+  Nan::Callback pooled_request_callback;
+  // Indexed by the ids returned by registerMethod
+  std::vector<std::unique_ptr<RegisteredMethod>> registered_methods;
+  /* The number of calls that have been passed to JS and have not finished.
+     Shared with the calls, which may outlive the server */
+  std::shared_ptr<size_t> in_flight_calls;
+  /* Pending while a drain with a deadline is in progress, and NULL otherwise.
+     Allocated separately, because it has to outlive the server until it is
+     closed */
+  uv_timer_t *drain_timer;
+  // How many calls were still in flight when the drain deadline passed
+  size_t drain_cancelled_calls;
 };
 
 }  // namespace node
@@ -54,11 +54,18 @@ using v8::Value;
 Nan::Callback *ServerCredentials::constructor;
 Persistent<FunctionTemplate> ServerCredentials::fun_tpl;
 
-ServerCredentials::ServerCredentials(grpc_server_credentials *credentials)
-    : wrapped_credentials(credentials) {}
+ServerCredentials::ServerCredentials(grpc_server_credentials *credentials,
+                                     CertificateReloadState *reload_state)
+    : wrapped_credentials(credentials),
+      reload_state(reload_state),
+      reload_state_shared(false) {}
 
 ServerCredentials::~ServerCredentials() {
   grpc_server_credentials_release(wrapped_credentials);
+  if (reload_state != NULL && !reload_state_shared) {
+    uv_mutex_destroy(&reload_state->mutex);
+    delete reload_state;
+  }
 }
 
 void ServerCredentials::Init(Local<Object> exports) {
@@ -66,6 +73,7 @@ void ServerCredentials::Init(Local<Object> exports) {
   Local<FunctionTemplate> tpl = Nan::New<FunctionTemplate>(New);
   tpl->SetClassName(Nan::New("ServerCredentials").ToLocalChecked());
   tpl->InstanceTemplate()->SetInternalFieldCount(1);
+  Nan::SetPrototypeMethod(tpl, "updateCertificates", UpdateCertificates);
   Local<Function> ctr = tpl->GetFunction();
   Nan::Set(
       ctr, Nan::New("createSsl").ToLocalChecked(),
@@ -73,6 +81,9 @@ void ServerCredentials::Init(Local<Object> exports) {
   Nan::Set(ctr, Nan::New("createInsecure").ToLocalChecked(),
            Nan::GetFunction(Nan::New<FunctionTemplate>(CreateInsecure))
                .ToLocalChecked());
+  Nan::Set(ctr, Nan::New("createSslReloadable").ToLocalChecked(),
+           Nan::GetFunction(Nan::New<FunctionTemplate>(CreateSslReloadable))
+               .ToLocalChecked());
   fun_tpl.Reset(tpl);
   constructor = new Nan::Callback(ctr);
   Nan::Set(exports, Nan::New("ServerCredentials").ToLocalChecked(), ctr);
@@ -98,10 +109,119 @@ Local<Value> ServerCredentials::WrapStruct(
   }
 }
 
+static Local<Value> WrapReloadState(Nan::Callback *constructor,
+                                    CertificateReloadState *reload_state) {
+  Nan::EscapableHandleScope scope;
+  const int argc = 2;
+  Local<Value> argv[argc] = {
+      Nan::New<External>(static_cast<void *>(NULL)),
+      Nan::New<External>(reinterpret_cast<void *>(reload_state))};
+  MaybeLocal<Object> maybe_instance =
+      Nan::NewInstance(constructor->GetFunction(), argc, argv);
+  if (maybe_instance.IsEmpty()) {
+    return scope.Escape(Nan::Null());
+  } else {
+    return scope.Escape(maybe_instance.ToLocalChecked());
+  }
+}
+
 grpc_server_credentials *ServerCredentials::GetWrappedServerCredentials() {
   return wrapped_credentials;
 }
 
+bool ServerCredentials::IsReloadable() { return reload_state != NULL; }
+
+/* Each port gets its own fetcher state, because core only switches a port to
+ * new certificates when its fetcher reports a change, and it creates each
+ * port's handshaker from the first result */
+typedef struct certificate_fetcher_state {
+  CertificateReloadState *reload_state;
+  // The generation of the certificates that this port was last given
+  uint64_t generation;
+} certificate_fetcher_state;
+
+static grpc_ssl_certificate_config_reload_status FetchCertificateConfig(
+    void *user_data, grpc_ssl_server_certificate_config **config) {
+  certificate_fetcher_state *fetcher =
+      reinterpret_cast<certificate_fetcher_state *>(user_data);
+  CertificateReloadState *state = fetcher->reload_state;
+  grpc_ssl_certificate_config_reload_status status =
+      GRPC_SSL_CERTIFICATE_CONFIG_RELOAD_UNCHANGED;
+  uv_mutex_lock(&state->mutex);
+  if (fetcher->generation != state->generation) {
+    size_t pair_count = state->private_keys.size();
+    std::vector<grpc_ssl_pem_key_cert_pair> key_cert_pairs(pair_count);
+    for (size_t i = 0; i < pair_count; i++) {
+      key_cert_pairs[i].private_key = state->private_keys[i].get();
+      key_cert_pairs[i].cert_chain = state->cert_chains[i].get();
+    }
+    // This copies the certificates, and core takes ownership of the result
+    *config = grpc_ssl_server_certificate_config_create(
+        state->root_certs.get(), key_cert_pairs.data(), pair_count);
+    fetcher->generation = state->generation;
+    status = GRPC_SSL_CERTIFICATE_CONFIG_RELOAD_NEW;
+  }
+  uv_mutex_unlock(&state->mutex);
+  return status;
+}
+
+grpc_server_credentials *ServerCredentials::CreateReloadableCredentials() {
+  certificate_fetcher_state *fetcher = new certificate_fetcher_state;
+  fetcher->reload_state = reload_state;
+  fetcher->generation = 0;
+  reload_state_shared = true;
+  grpc_ssl_server_credentials_options *options =
+      grpc_ssl_server_credentials_create_options_using_config_fetcher(
+          reload_state->client_certificate_request, FetchCertificateConfig,
+          fetcher);
+  return grpc_ssl_server_credentials_create_with_options(options);
+}
+
+/* Copies root certificates and key/cert pairs out of JavaScript values.
+ * Returns an error message if they are not valid, or NULL on success. */
+static const char *ParseCertificates(Local<Value> root_certs_value,
+                                     Local<Value> pairs_value,
+                                     StringOrNull *root_certs,
+                                     std::vector<StringOrNull> *private_keys,
+                                     std::vector<StringOrNull> *cert_chains) {
+  if (::node::Buffer::HasInstance(root_certs_value)) {
+    root_certs->assign(root_certs_value);
+  } else if (!(root_certs_value->IsNull() ||
+               root_certs_value->IsUndefined())) {
+    return "Root certificates must be a Buffer if provided";
+  }
+  if (!pairs_value->IsArray()) {
+    return "Key/cert pairs must be a list of objects";
+  }
+  Local<Array> pair_list = Local<Array>::Cast(pairs_value);
+  uint32_t key_cert_pair_count = pair_list->Length();
+  if (key_cert_pair_count == 0) {
+    return "At least one key/cert pair is required";
+  }
+  private_keys->resize(key_cert_pair_count);
+  cert_chains->resize(key_cert_pair_count);
+  Local<String> key_key = Nan::New("private_key").ToLocalChecked();
+  Local<String> cert_key = Nan::New("cert_chain").ToLocalChecked();
+  for (uint32_t i = 0; i < key_cert_pair_count; i++) {
+    Local<Value> pair_val = Nan::Get(pair_list, i).ToLocalChecked();
+    if (!pair_val->IsObject()) {
+      return "Key/cert pairs must be objects";
+    }
+    Local<Object> pair_obj = Nan::To<Object>(pair_val).ToLocalChecked();
+    Local<Value> maybe_key = Nan::Get(pair_obj, key_key).ToLocalChecked();
+    Local<Value> maybe_cert = Nan::Get(pair_obj, cert_key).ToLocalChecked();
+    if (!::node::Buffer::HasInstance(maybe_key)) {
+      return "private_key must be a Buffer";
+    }
+    if (!::node::Buffer::HasInstance(maybe_cert)) {
+      return "cert_chain must be a Buffer";
+    }
+    (*private_keys)[i].assign(maybe_key);
+    (*cert_chains)[i].assign(maybe_cert);
+  }
+  return NULL;
+}
+
 NAN_METHOD(ServerCredentials::New) {
   if (info.IsConstructCall()) {
     if (!info[0]->IsExternal()) {
@@ -111,7 +231,13 @@ NAN_METHOD(ServerCredentials::New) {
     Local<External> ext = info[0].As<External>();
     grpc_server_credentials *creds_value =
         reinterpret_cast<grpc_server_credentials *>(ext->Value());
-    ServerCredentials *credentials = new ServerCredentials(creds_value);
+    CertificateReloadState *reload_state = NULL;
+    if (info[1]->IsExternal()) {
+      reload_state = reinterpret_cast<CertificateReloadState *>(
+          info[1].As<External>()->Value());
+    }
+    ServerCredentials *credentials =
+        new ServerCredentials(creds_value, reload_state);
     credentials->Wrap(info.This());
     info.GetReturnValue().Set(info.This());
   } else {
@@ -188,5 +314,73 @@ NAN_METHOD(ServerCredentials::CreateInsecure) {
   info.GetReturnValue().Set(WrapStruct(NULL));
 }
 
+NAN_METHOD(ServerCredentials::CreateSslReloadable) {
+  /* Arguments:
+   * 0: Root certificates for verifying client certificates (optional)
+   * 1: Array of {private_key, cert_chain} objects
+   * 2: Whether to request and verify client certificates (optional)
+   */
+  grpc_ssl_client_certificate_request_type client_certificate_request =
+      GRPC_SSL_DONT_REQUEST_CLIENT_CERTIFICATE;
+  if (info[2]->IsBoolean()) {
+    client_certificate_request =
+        Nan::To<bool>(info[2]).FromJust()
+            ? GRPC_SSL_REQUEST_AND_REQUIRE_CLIENT_CERTIFICATE_AND_VERIFY
+            : GRPC_SSL_DONT_REQUEST_CLIENT_CERTIFICATE;
+  } else if (!(info[2]->IsUndefined() || info[2]->IsNull())) {
+    return Nan::ThrowTypeError(
+        "createSslReloadable's third argument must be a boolean if provided");
+  }
+  CertificateReloadState *reload_state = new CertificateReloadState;
+  const char *error =
+      ParseCertificates(info[0], info[1], &reload_state->root_certs,
+                        &reload_state->private_keys,
+                        &reload_state->cert_chains);
+  if (error != NULL) {
+    delete reload_state;
+    return Nan::ThrowTypeError(error);
+  }
+  uv_mutex_init(&reload_state->mutex);
+  reload_state->generation = 1;
+  reload_state->client_certificate_request = client_certificate_request;
+  info.GetReturnValue().Set(WrapReloadState(constructor, reload_state));
+}
+
+NAN_METHOD(ServerCredentials::UpdateCertificates) {
+  /* Arguments:
+   * 0: Root certificates for verifying client certificates (optional)
+   * 1: Array of {private_key, cert_chain} objects
+   * Ports that use these credentials switch to the new certificates at their
+   * next handshake. Connections that are already established are not
+   * affected.
+   */
+  if (!HasInstance(info.This())) {
+    return Nan::ThrowTypeError(
+        "updateCertificates can only be called on ServerCredentials");
+  }
+  ServerCredentials *credentials =
+      ObjectWrap::Unwrap<ServerCredentials>(info.This());
+  if (credentials->reload_state == NULL) {
+    return Nan::ThrowError(
+        "updateCertificates can only be called on credentials created with "
+        "createSslReloadable");
+  }
+  StringOrNull root_certs;
+  std::vector<StringOrNull> private_keys;
+  std::vector<StringOrNull> cert_chains;
+  const char *error = ParseCertificates(info[0], info[1], &root_certs,
+                                        &private_keys, &cert_chains);
+  if (error != NULL) {
+    return Nan::ThrowTypeError(error);
+  }
+  CertificateReloadState *state = credentials->reload_state;
+  uv_mutex_lock(&state->mutex);
+  state->root_certs = root_certs;
+  state->private_keys.swap(private_keys);
+  state->cert_chains.swap(cert_chains);
+  state->generation++;
+  uv_mutex_unlock(&state->mutex);
+}
+
 }  // namespace node
 }  // namespace grpc
@@ -19,14 +19,33 @@
 #ifndef NET_GRPC_NODE_SERVER_CREDENTIALS_H_
 #define NET_GRPC_NODE_SERVER_CREDENTIALS_H_
 
+#include <stdint.h>
+#include <vector>
+
 #include <nan.h>
 #include <node.h>
+#include <uv.h>
 #include "grpc/grpc.h"
 #include "grpc/grpc_security.h"
 
+#include "util.h"
+
 namespace grpc {
 namespace node {
 
+/* The current certificates of reloadable server credentials. Every port that
+   uses the credentials checks the generation before each handshake, and
+   switches to the current certificates if they have changed. */
+struct CertificateReloadState {
+  uv_mutex_t mutex;
+  // Incremented every time the certificates are updated
+  uint64_t generation;
+  StringOrNull root_certs;
+  std::vector<StringOrNull> private_keys;
+  std::vector<StringOrNull> cert_chains;
+  grpc_ssl_client_certificate_request_type client_certificate_request;
+};
+
 /* Wrapper class for grpc_server_credentials structs */
 class ServerCredentials : public Nan::ObjectWrap {
  public:
@@ -38,8 +57,17 @@ class ServerCredentials : public Nan::ObjectWrap {
   /* Returns the grpc_server_credentials struct that this object wraps */
   grpc_server_credentials *GetWrappedServerCredentials();
 
+  /* Indicates that this object has reloadable certificates, so it does not
+     wrap a grpc_server_credentials struct that can be shared by every port */
+  bool IsReloadable();
+
+  /* Returns new credentials for one port that follow this object's
+     certificates. The caller must release them. */
+  grpc_server_credentials *CreateReloadableCredentials();
+
  private:
-  explicit ServerCredentials(grpc_server_credentials *credentials);
+  ServerCredentials(grpc_server_credentials *credentials,
+                    CertificateReloadState *reload_state);
   ~ServerCredentials();
 
   // Prevent copying
@@ -49,11 +77,17 @@ class ServerCredentials : public Nan::ObjectWrap {
   static NAN_METHOD(New);
   static NAN_METHOD(CreateSsl);
   static NAN_METHOD(CreateInsecure);
+  static NAN_METHOD(CreateSslReloadable);
+  static NAN_METHOD(UpdateCertificates);
   static Nan::Callback *constructor;
   // Used for typechecking instances of this javascript class
   static Nan::Persistent<v8::FunctionTemplate> fun_tpl;
 
   grpc_server_credentials *wrapped_credentials;
+  /* Owned by this object, unless a port is using it. Core does not say when
+     it is done with a certificate fetcher, so then it is never freed. */
+  CertificateReloadState *reload_state;
+  bool reload_state_shared;
 };
 
 }  // namespace node
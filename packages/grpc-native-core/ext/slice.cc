@@ -29,6 +29,7 @@ namespace node {
 using Nan::Persistent;
 
 using v8::Local;
+using v8::MaybeLocal;
 using v8::String;
 using v8::Value;
 
@@ -46,6 +47,32 @@ void string_destroy_func(void *user_data) {
 void buffer_destroy_func(void *user_data) {
   delete reinterpret_cast<PersistentValue *>(user_data);
 }
+
+size_t HashSlice(const grpc_slice &slice) {
+  // FNV-1a
+  const uint8_t *data = GRPC_SLICE_START_PTR(slice);
+  size_t hash = 2166136261u;
+  for (size_t i = 0; i < GRPC_SLICE_LENGTH(slice); i++) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+typedef Nan::Persistent<String, Nan::CopyablePersistentTraits<String>>
+    PersistentString;
+/* A direct-mapped cache from interned slices to the strings that were created
+   from them. A new key replaces whatever was cached in its slot, so keys that
+   peers send once cannot keep the keys that keep arriving out of the cache;
+   at worst they cost those keys one more copy. */
+struct CachedString {
+  grpc_slice key;
+  bool used;
+  PersistentString string;
+};
+// Must be a power of two
+const size_t kStringCacheSlots = 512;
+const size_t kMaxCachedStringLength = 256;
+CachedString *string_cache = NULL;
 }  // namespace
 
 grpc_slice CreateSliceFromString(const Local<String> source) {
@@ -74,6 +101,41 @@ Local<String> CopyStringFromSlice(const grpc_slice slice) {
           .ToLocalChecked());
 }
 
+Local<String> CachedStringFromSlice(const grpc_slice slice) {
+  Nan::EscapableHandleScope scope;
+  size_t length = GRPC_SLICE_LENGTH(slice);
+  if (length == 0 || length > kMaxCachedStringLength) {
+    return scope.Escape(CopyStringFromSlice(slice));
+  }
+  if (string_cache == NULL) {
+    string_cache = new CachedString[kStringCacheSlots];
+    for (size_t i = 0; i < kStringCacheSlots; i++) {
+      string_cache[i].used = false;
+    }
+  }
+  CachedString *entry =
+      &string_cache[HashSlice(slice) & (kStringCacheSlots - 1)];
+  if (entry->used && grpc_slice_eq(entry->key, slice)) {
+    return scope.Escape(Nan::New(entry->string));
+  }
+  // Internalized strings are faster to use as property keys
+  MaybeLocal<String> maybe_string = String::NewFromUtf8(
+      v8::Isolate::GetCurrent(),
+      reinterpret_cast<const char *>(GRPC_SLICE_START_PTR(slice)),
+      v8::NewStringType::kInternalized, static_cast<int>(length));
+  if (maybe_string.IsEmpty()) {
+    return scope.Escape(CopyStringFromSlice(slice));
+  }
+  Local<String> string = maybe_string.ToLocalChecked();
+  if (entry->used) {
+    grpc_slice_unref(entry->key);
+  }
+  entry->key = grpc_slice_intern(slice);
+  entry->used = true;
+  entry->string.Reset(string);
+  return scope.Escape(string);
+}
+
 Local<Value> CreateBufferFromSlice(const grpc_slice slice) {
   Nan::EscapableHandleScope scope;
   grpc_slice *slice_ptr = new grpc_slice;
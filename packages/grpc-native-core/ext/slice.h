@@ -32,6 +32,12 @@ grpc_slice CreateSliceFromBuffer(const v8::Local<v8::Value> source);
 
 v8::Local<v8::String> CopyStringFromSlice(const grpc_slice slice);
 
+/* Like CopyStringFromSlice, but for strings that are expected to repeat, such
+   as metadata keys and method names. Returns the same internalized string
+   for slices with the same contents while that string stays in a fixed-size
+   cache, where each new key replaces the one in its slot. */
+v8::Local<v8::String> CachedStringFromSlice(const grpc_slice slice);
+
 v8::Local<v8::Value> CreateBufferFromSlice(const grpc_slice slice);
 
 }  // namespace node
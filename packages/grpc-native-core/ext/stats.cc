@@ -0,0 +1,214 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <math.h>
+#include <string>
+#include <unordered_map>
+
+#include <nan.h>
+#include <node.h>
+#include <uv.h>
+#include "grpc/support/log.h"
+
+#include "resource_quota.h"
+#include "stats.h"
+
+namespace grpc {
+namespace node {
+
+using v8::Array;
+using v8::Local;
+using v8::Object;
+
+// The most methods that per method stats will be kept for
+const size_t kMaxStatsMethods = 256;
+
+static ProcessStats process_stats;
+
+static std::atomic<bool> method_stats_enabled(false);
+
+/* The method stats are process-wide, so the map is guarded by a mutex.
+   Recording into stats that have been looked up does not need the mutex. */
+static uv_once_t method_stats_once = UV_ONCE_INIT;
+static uv_mutex_t method_stats_mutex;
+static std::unordered_map<std::string, MethodStats *> *method_stats;
+
+static void InitMethodStats() {
+  GPR_ASSERT(uv_mutex_init(&method_stats_mutex) == 0);
+  method_stats = new std::unordered_map<std::string, MethodStats *>();
+}
+
+static int HighestBit(uint64_t value) {
+  int bit = 0;
+  for (int shift = 32; shift > 0; shift >>= 1) {
+    if (value >> shift) {
+      value >>= shift;
+      bit += shift;
+    }
+  }
+  return bit;
+}
+
+Histogram::Histogram() : sum(0), max(0) {
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    counts[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t Histogram::BucketFor(uint64_t value) {
+  if (value < kSubBuckets) {
+    return static_cast<size_t>(value);
+  }
+  int magnitude = HighestBit(value);
+  size_t sub_bucket = static_cast<size_t>(
+      (value >> (magnitude - kSubBucketBits)) & (kSubBuckets - 1));
+  return (magnitude - kSubBucketBits + 1) * kSubBuckets + sub_bucket;
+}
+
+double Histogram::BucketUpperBound(size_t bucket) {
+  if (bucket < kSubBuckets) {
+    return static_cast<double>(bucket + 1);
+  }
+  int magnitude = static_cast<int>(bucket / kSubBuckets) + kSubBucketBits - 1;
+  size_t sub_bucket = bucket % kSubBuckets;
+  return ldexp(static_cast<double>(kSubBuckets + sub_bucket + 1),
+               magnitude - kSubBucketBits);
+}
+
+Local<Object> Histogram::Snapshot() const {
+  Nan::EscapableHandleScope scope;
+  static const double kPercentiles[] = {50, 90, 99, 99.9};
+  static const char *kPercentileNames[] = {"p50", "p90", "p99", "p999"};
+  const size_t num_percentiles = sizeof(kPercentiles) / sizeof(double);
+  uint64_t bucket_counts[kNumBuckets];
+  uint64_t total = 0;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    bucket_counts[i] = counts[i].load(std::memory_order_relaxed);
+    total += bucket_counts[i];
+  }
+  Local<Object> snapshot = Nan::New<Object>();
+  Nan::Set(snapshot, Nan::New("count").ToLocalChecked(),
+           Nan::New(static_cast<double>(total)));
+  Nan::Set(snapshot, Nan::New("sum").ToLocalChecked(),
+           Nan::New(static_cast<double>(sum.load(std::memory_order_relaxed))));
+  Nan::Set(snapshot, Nan::New("max").ToLocalChecked(),
+           Nan::New(static_cast<double>(max.load(std::memory_order_relaxed))));
+  Local<Array> buckets = Nan::New<Array>();
+  double percentile_values[num_percentiles] = {0};
+  size_t next_percentile = 0;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; i++) {
+    if (bucket_counts[i] == 0) {
+      continue;
+    }
+    double upper_bound = BucketUpperBound(i);
+    Local<Array> bucket = Nan::New<Array>(2);
+    Nan::Set(bucket, 0, Nan::New(upper_bound));
+    Nan::Set(bucket, 1, Nan::New(static_cast<double>(bucket_counts[i])));
+    Nan::Set(buckets, buckets->Length(), bucket);
+    seen += bucket_counts[i];
+    while (next_percentile < num_percentiles &&
+           seen * 100.0 >= kPercentiles[next_percentile] * total) {
+      percentile_values[next_percentile++] = upper_bound;
+    }
+  }
+  Nan::Set(snapshot, Nan::New("buckets").ToLocalChecked(), buckets);
+  for (size_t i = 0; i < num_percentiles; i++) {
+    Nan::Set(snapshot, Nan::New(kPercentileNames[i]).ToLocalChecked(),
+             Nan::New(percentile_values[i]));
+  }
+  return scope.Escape(snapshot);
+}
+
+ProcessStats &GetProcessStats() { return process_stats; }
+
+bool MethodStatsEnabled() {
+  return method_stats_enabled.load(std::memory_order_relaxed);
+}
+
+void SetMethodStatsEnabled(bool enabled) {
+  method_stats_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+MethodStats *GetMethodStats(const char *method, size_t length) {
+  if (!MethodStatsEnabled()) {
+    return NULL;
+  }
+  uv_once(&method_stats_once, InitMethodStats);
+  std::string key(method, length);
+  MethodStats *stats = NULL;
+  uv_mutex_lock(&method_stats_mutex);
+  std::unordered_map<std::string, MethodStats *>::iterator it =
+      method_stats->find(key);
+  if (it != method_stats->end()) {
+    stats = it->second;
+  } else if (method_stats->size() < kMaxStatsMethods) {
+    stats = new MethodStats();
+    (*method_stats)[key] = stats;
+  }
+  uv_mutex_unlock(&method_stats_mutex);
+  return stats;
+}
+
+static void SetCounter(Local<Object> obj, const char *name,
+                       const std::atomic<uint64_t> &counter) {
+  Nan::Set(obj, Nan::New(name).ToLocalChecked(),
+           Nan::New(static_cast<double>(
+               counter.load(std::memory_order_relaxed))));
+}
+
+Local<Object> GetStatsSnapshot() {
+  Nan::EscapableHandleScope scope;
+  Local<Object> snapshot = Nan::New<Object>();
+  SetCounter(snapshot, "batchesStarted", process_stats.batches_started);
+  SetCounter(snapshot, "batchesCompleted", process_stats.batches_completed);
+  SetCounter(snapshot, "batchesFailed", process_stats.batches_failed);
+  SetCounter(snapshot, "drains", process_stats.drains);
+  Nan::Set(snapshot, Nan::New("batchLatency").ToLocalChecked(),
+           process_stats.batch_latency.Snapshot());
+  Nan::Set(snapshot, Nan::New("queueDelay").ToLocalChecked(),
+           process_stats.queue_delay.Snapshot());
+  Nan::Set(snapshot, Nan::New("completionTime").ToLocalChecked(),
+           process_stats.completion_time.Snapshot());
+  Nan::Set(snapshot, Nan::New("eventsPerDrain").ToLocalChecked(),
+           process_stats.events_per_drain.Snapshot());
+  Local<Object> methods = Nan::New<Object>();
+  uv_once(&method_stats_once, InitMethodStats);
+  uv_mutex_lock(&method_stats_mutex);
+  for (std::unordered_map<std::string, MethodStats *>::iterator it =
+           method_stats->begin();
+       it != method_stats->end(); ++it) {
+    Local<Object> method = Nan::New<Object>();
+    SetCounter(method, "calls", it->second->calls);
+    SetCounter(method, "batchesFailed", it->second->batches_failed);
+    Nan::Set(method, Nan::New("batchLatency").ToLocalChecked(),
+             it->second->batch_latency.Snapshot());
+    Nan::Set(methods,
+             Nan::New(it->first.data(), static_cast<int>(it->first.size()))
+                 .ToLocalChecked(),
+             method);
+  }
+  uv_mutex_unlock(&method_stats_mutex);
+  Nan::Set(snapshot, Nan::New("methods").ToLocalChecked(), methods);
+  Nan::Set(snapshot, Nan::New("resourceQuotas").ToLocalChecked(),
+           GetResourceQuotaStats());
+  return scope.Escape(snapshot);
+}
+
+}  // namespace node
+}  // namespace grpc
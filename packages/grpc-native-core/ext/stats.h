@@ -0,0 +1,123 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef NET_GRPC_NODE_STATS_H_
+#define NET_GRPC_NODE_STATS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include <nan.h>
+#include <node.h>
+
+namespace grpc {
+namespace node {
+
+/* A histogram with log-linear buckets: values below kSubBuckets get their own
+   buckets, and every larger power of two is split into kSubBuckets equal
+   buckets, so any recorded value is within 1/kSubBuckets of its bucket's
+   bounds. Recording only uses relaxed atomics, so it is safe from any thread,
+   but a snapshot taken while values are being recorded may be slightly
+   inconsistent. */
+class Histogram {
+ public:
+  static const int kSubBucketBits = 3;
+  static const size_t kSubBuckets = 1 << kSubBucketBits;
+  static const size_t kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  Histogram();
+
+  void Record(uint64_t value) {
+    counts[BucketFor(value)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen_max = max.load(std::memory_order_relaxed);
+    while (value > seen_max &&
+           !max.compare_exchange_weak(seen_max, value,
+                                      std::memory_order_relaxed)) {
+    }
+  }
+
+  /* Returns an object with the count, sum and max of the recorded values, an
+     array of [upper bound, count] pairs for the buckets that are not empty,
+     and the median, 90th, 99th and 99.9th percentiles, estimated as the upper
+     bounds of the buckets they fall in */
+  v8::Local<v8::Object> Snapshot() const;
+
+ private:
+  // Prevent copying
+  Histogram(const Histogram &);
+  Histogram &operator=(const Histogram &);
+
+  static size_t BucketFor(uint64_t value);
+  static double BucketUpperBound(size_t bucket);
+
+  /* The total count is summed from these when a snapshot is taken, so that
+     it always matches the buckets */
+  std::atomic<uint64_t> counts[kNumBuckets];
+  std::atomic<uint64_t> sum;
+  std::atomic<uint64_t> max;
+};
+
+/* Stats for the calls to one method, which are only kept when per method
+   stats are enabled. These are never freed once created. */
+struct MethodStats {
+  std::atomic<uint64_t> calls;
+  std::atomic<uint64_t> batches_failed;
+  // Nanoseconds from starting a batch to its completion being read
+  Histogram batch_latency;
+};
+
+/* Stats for every call in the process. All times
+   are in nanoseconds. */
+struct ProcessStats {
+  std::atomic<uint64_t> batches_started;
+  std::atomic<uint64_t> batches_completed;
+  std::atomic<uint64_t> batches_failed;
+  // The number of times the completion queue was drained
+  std::atomic<uint64_t> drains;
+  // From grpc_call_start_batch to the completion being read from the queue
+  Histogram batch_latency;
+  /* From the polling thread reading a completion to the event loop thread
+     handling it. This is only recorded when the polling thread is enabled,
+     because otherwise completions are handled as soon as they are read. */
+  Histogram queue_delay;
+  // Building the arguments for a completed batch's callback
+  Histogram completion_time;
+  // The number of completions handled in each drain of the queue
+  Histogram events_per_drain;
+};
+
+ProcessStats &GetProcessStats();
+
+/* Returns the stats for method, creating them the first time, or NULL if per
+   method stats are disabled or too many methods have stats already */
+MethodStats *GetMethodStats(const char *method, size_t length);
+
+bool MethodStatsEnabled();
+
+void SetMethodStatsEnabled(bool enabled);
+
+/* Returns a snapshot of the process stats, with the per method stats in its
+   methods property, keyed by method */
+v8::Local<v8::Object> GetStatsSnapshot();
+
+}  // namespace node
+}  // namespace grpc
+
+#endif  // NET_GRPC_NODE_STATS_H_
@@ -127,7 +127,10 @@ declare module "grpc" {
    * core will log synchronously directly to stdout unless this function is
    * called. Note: the output format here is intended to be informational, and
    * is not guaranteed to stay the same in the future.
-   * Logs will be directed to logger.error.
+   * Logs will be directed to logger.error. Messages are passed to the logger
+   * in batches, and if too many are waiting to be passed, later ones are
+   * dropped and the number dropped is logged instead. Messages longer than 512
+   * bytes are cut off, and end with '...'.
    * @param logger A Console-like object.
    */
   export function setLogger(logger: Console): void;
@@ -139,6 +142,37 @@ declare module "grpc" {
    */
   export function setLogVerbosity(verbosity: logVerbosity): void;
 
+  /**
+   * Poll the completion queue from a dedicated native thread instead of from
+   * the event loop. This must be called before any clients or servers are
+   * created.
+   */
+  export function enableCompletionQueueThread(): void;
+
+  /**
+   * Deliver all of the operations that complete in one pass over the
+   * completion queue to JavaScript in a single call, instead of one call per
+   * operation. Their callbacks share a single async context.
+   * @param enabled Pass false to go back to calling each callback separately
+   */
+  export function enableBatchDispatch(enabled?: boolean): void;
+
+  /**
+   * Get the channelz data for a subchannel, with its state, call counts, last
+   * call time and the ids of its sockets.
+   * @param id The subchannel's id, from a channel's channelz data
+   * @return The channelz data, or null if there is no subchannel with that id
+   */
+  export function getChannelzSubchannel(id: number|string): object|null;
+
+  /**
+   * Get the channelz data for a socket, which includes its stream and
+   * message counts, keepalives and flow control windows.
+   * @param id The socket's id, from a subchannel's or server's channelz data
+   * @return The channelz data, or null if there is no socket with that id
+   */
+  export function getChannelzSocket(id: number|string): object|null;
+
   /**
    * Server object that stores request handlers and delegates incoming requests to those handlers
    */
@@ -200,6 +234,31 @@ declare module "grpc" {
      */
     forceShutdown(): void;
 
+    /**
+     * Shuts down the server with a bounded drain. The server stops receiving
+     * new calls immediately, and only the calls that are still in flight at
+     * the deadline are cancelled. Only one drain can be in progress.
+     * @param deadline When to cancel the remaining calls
+     * @param callback Called when the server has shut down, with an error if
+     *     the drain failed, or with the number of calls that were cancelled at
+     *     the deadline
+     */
+    drain(deadline: Deadline,
+          callback: (error: Error | null, cancelledCalls?: number) => void): void;
+
+    /**
+     * Get the number of calls that the server has accepted and that have not
+     * finished. While the server drains, this reports its progress.
+     */
+    getInFlightCalls(): number;
+
+    /**
+     * Get the server's channelz data, which includes its call counts, last
+     * call time and the ids of its listen sockets.
+     * @return The channelz data, or null if channelz is disabled
+     */
+    getChannelz(): object|null;
+
     /**
      * Add a service to the server, with a corresponding implementation.
      * @param service The service descriptor
@@ -577,6 +636,25 @@ declare module "grpc" {
      * @return The ServerCredentials
      */
     static createSsl(rootCerts: Buffer | null, keyCertPairs: KeyCertPair[], checkClientCertificate?: boolean): ServerCredentials;
+    /**
+     * Create SSL server credentials whose certificates can be replaced with
+     * `updateCertificates` while servers are using them
+     * @param rootCerts Root CA certificates for validating client certificates
+     * @param keyCertPairs A list of private key and certificate chain pairs to
+     * be used for authenticating the server
+     * @param checkClientCertificate Indicates that the server should request
+     * and verify the client's certificates.
+     * Defaults to `false`.
+     * @return The ServerCredentials
+     */
+    static createSslReloadable(rootCerts: Buffer | null, keyCertPairs: KeyCertPair[], checkClientCertificate?: boolean): ServerCredentials;
+    /**
+     * Replace the certificates of credentials created with
+     * `createSslReloadable`. Ports switch to them at their next handshake.
+     * @param rootCerts Root CA certificates for validating client certificates
+     * @param keyCertPairs The new private key and certificate chain pairs
+     */
+    updateCertificates(rootCerts: Buffer | null, keyCertPairs: KeyCertPair[]): void;
   }
 
   /**
@@ -785,6 +863,17 @@ declare module "grpc" {
     NO_COMPRESS,
   }
 
+  /**
+   * Compression levels, for a server call's setCompression. Core picks the
+   * algorithm for a level from the ones that the client says it accepts.
+   */
+  export enum compressionLevel {
+    NONE = 0,
+    LOW,
+    MEDIUM,
+    HIGH,
+  }
+
   /**
    * Log verbosity constants. Maps setting names to code numbers.
    */
@@ -869,9 +958,11 @@ declare module "grpc" {
      * passed to the callback can optionally have a 'code' value attached to it,
      * which corresponds to a status code that this library uses.
      * @param metadataGenerator The function that generates metadata
+     * @param options.cacheTtl The number of milliseconds to reuse successfully
+     *     generated metadata for, for each service URL
      * @return The credentials object
      */
-    createFromMetadataGenerator(metadataGenerator: metadataGenerator): CallCredentials;
+    createFromMetadataGenerator(metadataGenerator: metadataGenerator, options?: { cacheTtl?: number }): CallCredentials;
 
     /**
      * Create a gRPC credential from a Google credential object.
@@ -1513,7 +1604,7 @@ declare module "grpc" {
      * @param credentials Channel credentials to use when connecting
      * @param options A map of channel options that will be passed to the core
      */
-    constructor(target: string, credentials: ChannelCredentials, options: {[key:string]: string|number});
+    constructor(target: string, credentials: ChannelCredentials, options: {[key:string]: string|number|ResourceQuota});
     /**
      * Close the channel. This has the same functionality as the existing grpc.Client.prototype.close
      */
@@ -1529,6 +1620,12 @@ declare module "grpc" {
      *     call starts.
      */
     getConnectivityState(tryToConnect: boolean): connectivityState;
+    /**
+     * Get the channel's channelz data, which includes its call counts, last
+     * call time and the ids of its subchannels.
+     * @return The channelz data, or null if channelz is disabled
+     */
+    getChannelz(): object|null;
     /**
      * Watch for connectivity state changes.
      * @param currentState The state to watch for transitions from. This should
@@ -1554,4 +1651,93 @@ declare module "grpc" {
      */
     createCall(method: string, deadline: Date|number, host: string|null, parentCall: Call|null, propagateFlags: number|null): Call;
   }  
+
+  /**
+   * A fixed number of channels to the same target, which calls are spread
+   * across. Each channel has its own connections.
+   */
+  export class ChannelPool {
+    /**
+     * @param target The address of the server to connect to
+     * @param credentials Channel credentials to use when connecting
+     * @param options A map of channel options that will be passed to the core
+     *     for every channel
+     * @param size The number of channels in the pool
+     * @param policy How to pick the channel for each call. Channels that are
+     *     failing to connect are skipped either way.
+     */
+    constructor(target: string, credentials: ChannelCredentials, options: {[key:string]: string|number|ResourceQuota}, size: number, policy?: 'round_robin'|'least_outstanding');
+    /**
+     * Close every channel in the pool
+     */
+    close(): void;
+    /**
+     * Return the target that the pool's channels connect to
+     */
+    getTarget(): string;
+    /**
+     * Get the best connectivity state of any channel in the pool.
+     * @param tryToConnect If true, idle channels will start connecting
+     */
+    getConnectivityState(tryToConnect: boolean): connectivityState;
+    /**
+     * Create a call on one of the pool's channels, with the same arguments as
+     * Channel#createCall.
+     */
+    createCall(method: string, deadline: Date|number, host: string|null, parentCall: Call|null, propagateFlags: number|null): Call;
+    /**
+     * Get the number of unfinished calls on each channel in the pool
+     */
+    getOutstandingCalls(): number[];
+  }
+
+  /**
+   * Watches the connectivity state of many channels at once, and reports the
+   * changes seen in each turn of the event loop together.
+   */
+  export class ConnectivityMonitor {
+    /**
+     * @param callback Called with [index, state] pairs, where index is the
+     *     value that add returned for the channel
+     * @param watchPeriod How long each native watch lasts, in milliseconds.
+     *     Defaults to 10 seconds.
+     */
+    constructor(callback: (changes: [number, connectivityState][]) => void, watchPeriod?: number);
+    /**
+     * Start watching a channel
+     * @param channel The channel to watch
+     * @return The index that identifies the channel in the callback
+     */
+    add(channel: Channel): number;
+    /**
+     * Stop reporting changes for a channel
+     * @param index The index that add returned for the channel
+     */
+    remove(index: number): void;
+    /**
+     * Stop reporting changes for every channel
+     */
+    close(): void;
+  }
+
+  /**
+   * A limit on the memory that core uses for the channels and servers that
+   * are created with it as their grpc.resource_quota option.
+   */
+  export class ResourceQuota {
+    /**
+     * @param limit The memory limit in bytes
+     * @param name A name for the quota, which is included in its usage
+     */
+    constructor(limit: number, name?: string);
+    /**
+     * Change the memory limit. Memory above a lower limit is freed over time.
+     * @param limit The new memory limit in bytes
+     */
+    resize(limit: number): void;
+    /**
+     * Get the quota's current limit and an estimate of the memory in use
+     */
+    getUsage(): {name: string, limit: number, usage: number};
+  }
 }
\ No newline at end of file
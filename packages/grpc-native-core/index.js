@@ -191,22 +191,30 @@ var log_template = function(args) {
  * core will log synchronously directly to stdout unless this function is
  * called. Note: the output format here is intended to be informational, and
  * is not guaranteed to stay the same in the future.
- * Logs will be directed to logger.error.
+ * Logs will be directed to logger.error. Messages are passed to the logger in
+ * batches, and if too many are waiting to be passed, later ones are dropped
+ * and the number dropped is logged instead. Messages longer than 512 bytes are
+ * cut off, and end with '...'.
  * @memberof grpc
  * @alias grpc.setLogger
  * @param {Console} logger A Console-like object.
  */
 exports.setLogger = function setLogger(logger) {
   common.logger = logger;
-  grpc.setDefaultLoggerCallback(function(file, line, severity,
-                                         message, timestamp) {
-    logger.error(log_template({
-      file: path.basename(file),
-      line: line,
-      severity: severity,
-      message: message,
-      timestamp: timestamp.toISOString()
-    }));
+  grpc.setDefaultLoggerCallback(function(records, dropped) {
+    records.forEach(function(record) {
+      logger.error(log_template({
+        file: path.basename(record.file),
+        line: record.line,
+        severity: record.severity,
+        message: record.truncated ? record.message + '...' : record.message,
+        timestamp: record.timestamp.toISOString()
+      }));
+    });
+    if (dropped > 0) {
+      logger.error(`gRPC dropped ${dropped} log messages because they were ` +
+                   'logged faster than they could be handled');
+    }
   });
 };
 
@@ -222,6 +230,77 @@ exports.setLogVerbosity = function setLogVerbosity(verbosity) {
   grpc.setLogVerbosity(verbosity);
 };
 
+/**
+ * Poll the completion queue from a dedicated native thread instead of from the
+ * event loop. The thread blocks waiting for completed operations and wakes the
+ * event loop once for each burst of them, so completions are handled as soon
+ * as they happen instead of on the next turn of the event loop. This must be
+ * called before any clients or servers are created.
+ * @memberof grpc
+ * @alias grpc.enableCompletionQueueThread
+ */
+exports.enableCompletionQueueThread = function enableCompletionQueueThread() {
+  grpc.enableCompletionQueueThread();
+};
+
+/**
+ * Calls the callbacks for a group of completed batches, as passed from the
+ * native batch dispatcher
+ * @private
+ * @param {Array} completions Flat list of callback, error, and result triples
+ */
+function dispatchCompletions(completions) {
+  for (var i = 0; i < completions.length; i += 3) {
+    try {
+      completions[i](completions[i + 1], completions[i + 2]);
+    } catch (e) {
+      // Rethrow asynchronously so that one callback can't starve the others
+      process.nextTick(function() {
+        throw e;
+      });
+    }
+  }
+}
+
+/**
+ * Deliver all of the operations that complete in one pass over the completion
+ * queue to JavaScript in a single call, which then calls each operation's
+ * callback. This saves a native to JavaScript transition per operation on
+ * busy processes, but those callbacks share one async context instead of each
+ * having their own.
+ * @memberof grpc
+ * @alias grpc.enableBatchDispatch
+ * @param {boolean=} [enabled=true] Pass false to go back to calling each
+ *     callback separately
+ */
+exports.enableBatchDispatch = function enableBatchDispatch(enabled) {
+  grpc.setBatchDispatcher(enabled === false ? null : dispatchCompletions);
+};
+
+/**
+ * Get the channelz data for a subchannel, with its state, call counts, last
+ * call time and the ids of its sockets.
+ * @memberof grpc
+ * @alias grpc.getChannelzSubchannel
+ * @param {number|string} id The subchannel's id, from the subchannelRef list
+ *     of a channel's channelz data
+ * @return {?Object} The channelz data, in its JSON form, or null if there is
+ *     no subchannel with that id
+ */
+exports.getChannelzSubchannel = grpc.getChannelzSubchannel;
+
+/**
+ * Get the channelz data for a socket, which includes its stream and message
+ * counts, keepalives and local and remote flow control windows.
+ * @memberof grpc
+ * @alias grpc.getChannelzSocket
+ * @param {number|string} id The socket's id, from the socketRef list of a
+ *     subchannel or the listenSocket list of a server
+ * @return {?Object} The channelz data, in its JSON form, or null if there is
+ *     no socket with that id
+ */
+exports.getChannelzSocket = grpc.getChannelzSocket;
+
 exports.Server = server.Server;
 
 exports.Metadata = Metadata;
@@ -234,6 +313,8 @@ exports.callError = constants.callError;
 
 exports.writeFlags = constants.writeFlags;
 
+exports.compressionLevel = constants.compressionLevel;
+
 exports.logVerbosity = constants.logVerbosity;
 
 exports.methodTypes = constants.methodTypes;
@@ -277,6 +358,34 @@ exports.ServerCredentials = grpc.ServerCredentials;
  * @return {grpc.ServerCredentials}
  */
 
+/**
+ * Create SSL server credentials whose certificates can be replaced while
+ * servers are using them. Each port that uses the credentials switches to the
+ * new certificates at its next handshake, and connections that are already
+ * established are not affected. At least one key/cert pair is required.
+ * @name grpc.ServerCredentials.createSslReloadable
+ * @kind function
+ * @param {?Buffer} rootCerts Root CA certificates for validating client
+ *     certificates
+ * @param {Array<grpc.ServerCredentials~keyCertPair>} keyCertPairs A list of
+ *     private key and certificate chain pairs to be used for authenticating
+ *     the server
+ * @param {boolean} [checkClientCertificate=false] Indicates that the server
+ *     should request and verify the client's certificates
+ * @return {grpc.ServerCredentials}
+ */
+
+/**
+ * Replace the certificates of credentials created with
+ * grpc.ServerCredentials.createSslReloadable
+ * @name grpc.ServerCredentials#updateCertificates
+ * @kind function
+ * @param {?Buffer} rootCerts Root CA certificates for validating client
+ *     certificates
+ * @param {Array<grpc.ServerCredentials~keyCertPair>} keyCertPairs The new
+ *     private key and certificate chain pairs
+ */
+
 exports.makeGenericClientConstructor = client.makeClientConstructor;
 
 exports.getClientChannel = client.getClientChannel;
@@ -300,7 +409,10 @@ exports.closeClient = function closeClient(client_obj) {
 exports.Client = client.Client;
 
 /**
- * @typedef {Object.<string, string | number>} grpc~ChannelOptions
+ * Channel options map directly to core channel args. The value of
+ * grpc.resource_quota must be a {@link grpc.ResourceQuota}.
+ * @typedef {Object.<string, string | number | grpc.ResourceQuota>}
+ *     grpc~ChannelOptions
  */
 
 /**
@@ -338,6 +450,18 @@ exports.Channel = grpc.Channel;
  * @return {grpc.connectivityState} The current connectivity state
  */
 
+/**
+ * Get the channel's channelz data, which includes its target, state, the
+ * number of calls started, succeeded and failed, the time of its last call
+ * and the ids of its subchannels. Each subchannel's data can be looked up with
+ * {@link grpc.getChannelzSubchannel}. It has the same counts for the
+ * subchannel alone, and the ids of its sockets.
+ * @name grpc.Channel#getChannelz
+ * @kind function
+ * @return {?Object} The channelz data, in its JSON form, or null if channelz
+ *     is disabled by setting the grpc.enable_channelz option to 0
+ */
+
 /**
  * @callback grpc.Channel~watchConnectivityStateCallback
  * @param {Error?} error
@@ -379,3 +503,127 @@ exports.Channel = grpc.Channel;
  *     from parentCall
  * @return {grpc~Call}
  */
+
+/**
+ * A fixed number of channels to the same target, which calls are spread
+ * across. Each channel has its own connections, so a pool can use more
+ * connections to one server than a single Channel would. A pool can be passed
+ * as the channelOverride option of a Client, but it does not support
+ * watchConnectivityState, so it cannot be used with waitForReady.
+ * @constructor ChannelPool
+ * @memberof grpc
+ * @param {string} target The address of the server to connect to
+ * @param {grpc.ChannelCredentials} credentials Channel credentials to use when
+ *     connecting
+ * @param {grpc~ChannelOptions} options A map of channel options that will be
+ *     passed to the core for every channel
+ * @param {number} size The number of channels in the pool
+ * @param {string=} policy How to pick the channel for each call:
+ *     "round_robin" (the default) rotates through the channels, and
+ *     "least_outstanding" picks the channel with the fewest unfinished calls.
+ *     Channels that are failing to connect are skipped either way.
+ */
+exports.ChannelPool = grpc.ChannelPool;
+
+/**
+ * Close every channel in the pool
+ * @name grpc.ChannelPool#close
+ * @kind function
+ */
+
+/**
+ * Return the target that the pool's channels connect to
+ * @name grpc.ChannelPool#getTarget
+ * @kind function
+ * @return {string} The target
+ */
+
+/**
+ * Get the best connectivity state of any channel in the pool.
+ * @name grpc.ChannelPool#getConnectivityState
+ * @kind function
+ * @param {boolean} tryToConnect If true, idle channels will start connecting
+ * @return {grpc.connectivityState} The best current connectivity state
+ */
+
+/**
+ * Create a call on one of the pool's channels. This takes the same arguments
+ * as {@link grpc.Channel#createCall}.
+ * @name grpc.ChannelPool#createCall
+ * @kind function
+ * @return {grpc~Call}
+ */
+
+/**
+ * Get the number of unfinished calls on each channel in the pool
+ * @name grpc.ChannelPool#getOutstandingCalls
+ * @kind function
+ * @return {number[]}
+ */
+
+/**
+ * Watches the connectivity state of many channels at once. Each channel is
+ * watched natively for as long as it is in the monitor, so its callback is
+ * only called when a channel's state changes. The changes seen in one turn of
+ * the event loop are reported together. Channels stop being watched when they
+ * are removed or closed. While the monitor has channels to watch, it keeps the
+ * process running.
+ * @constructor ConnectivityMonitor
+ * @memberof grpc
+ * @param {function(Array.<Array.<number>>)} callback Called with an array of
+ *     [index, state] pairs, where index is the value that
+ *     {@link grpc.ConnectivityMonitor#add} returned for the channel and state
+ *     is its new {@link grpc.connectivityState}
+ * @param {number=} watchPeriod How long each native watch lasts, in
+ *     milliseconds, before it is started again. Channels that are still open
+ *     stop being watched within this long of the monitor being closed.
+ *     Defaults to 10 seconds.
+ */
+exports.ConnectivityMonitor = grpc.ConnectivityMonitor;
+
+/**
+ * Start watching a channel
+ * @name grpc.ConnectivityMonitor#add
+ * @kind function
+ * @param {grpc.Channel} channel The channel to watch
+ * @return {number} The index that identifies the channel in the callback
+ */
+
+/**
+ * Stop reporting changes for a channel
+ * @name grpc.ConnectivityMonitor#remove
+ * @kind function
+ * @param {number} index The index that add returned for the channel
+ */
+
+/**
+ * Stop reporting changes for every channel
+ * @name grpc.ConnectivityMonitor#close
+ * @kind function
+ */
+
+/**
+ * A limit on the memory that core uses for the channels and servers that are
+ * created with it as their grpc.resource_quota option, mostly to buffer the
+ * message data that they receive. One quota can be shared by any number of
+ * channels and servers.
+ * @constructor ResourceQuota
+ * @memberof grpc
+ * @param {number} limit The memory limit in bytes
+ * @param {string=} name A name for the quota, which is included in its usage
+ */
+exports.ResourceQuota = grpc.ResourceQuota;
+
+/**
+ * Change the memory limit. Memory above a lower limit is freed over time.
+ * @name grpc.ResourceQuota#resize
+ * @kind function
+ * @param {number} limit The new memory limit in bytes
+ */
+
+/**
+ * Get the quota's current limit and an estimate of the memory in use
+ * @name grpc.ResourceQuota#getUsage
+ * @kind function
+ * @return {{name: string, limit: number, usage: number}}
+ */
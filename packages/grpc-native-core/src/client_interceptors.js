@@ -149,6 +149,10 @@ var common = require('./common');
 var methodTypes = constants.methodTypes;
 var EventEmitter = require('events').EventEmitter;
 
+/* The value for ops that receive metadata. Received metadata arrives as a
+ * native view, and Metadata only converts the entries that are read. */
+var RECV_METADATA_VIEW = {view: true};
+
 /**
  * A custom error thrown when interceptor configuration fails.
  * @param {string} message The error message
@@ -807,9 +811,9 @@ function _getUnaryInterceptor(method_definition, channel, emitter, callback) {
     final_requester.halfClose = function () {
       var batch = {
         [grpc.opType.SEND_CLOSE_FROM_CLIENT]: true,
-        [grpc.opType.RECV_INITIAL_METADATA]: true,
+        [grpc.opType.RECV_INITIAL_METADATA]: RECV_METADATA_VIEW,
         [grpc.opType.RECV_MESSAGE]: true,
-        [grpc.opType.RECV_STATUS_ON_CLIENT]: true
+        [grpc.opType.RECV_STATUS_ON_CLIENT]: RECV_METADATA_VIEW
       };
       var callback = function (err, response) {
         response.status.metadata = Metadata._fromCoreRepresentation(
@@ -873,7 +877,7 @@ function _getClientStreamingInterceptor(method_definition, channel, emitter,
     final_requester.start = function (metadata, listener) {
       var metadata_batch = {
         [grpc.opType.SEND_INITIAL_METADATA]: metadata._getCoreRepresentation(),
-        [grpc.opType.RECV_INITIAL_METADATA]: true
+        [grpc.opType.RECV_INITIAL_METADATA]: RECV_METADATA_VIEW
       };
       first_listener = listener;
       call.startBatch(metadata_batch, function (err, response) {
@@ -887,7 +891,7 @@ function _getClientStreamingInterceptor(method_definition, channel, emitter,
       });
       var recv_batch = {};
       recv_batch[grpc.opType.RECV_MESSAGE] = true;
-      recv_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+      recv_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = RECV_METADATA_VIEW;
       call.startBatch(recv_batch, function (err, response) {
         response.status.metadata = Metadata._fromCoreRepresentation(
           response.status.metadata);
@@ -993,7 +997,7 @@ function _getServerStreamingInterceptor(method_definition, channel, emitter) {
       metadata = metadata.clone();
       var metadata_batch = {
         [grpc.opType.SEND_INITIAL_METADATA]: metadata._getCoreRepresentation(),
-        [grpc.opType.RECV_INITIAL_METADATA]: true
+        [grpc.opType.RECV_INITIAL_METADATA]: RECV_METADATA_VIEW
       };
       var callback = function(err, response) {
         if (err) {
@@ -1007,7 +1011,7 @@ function _getServerStreamingInterceptor(method_definition, channel, emitter) {
       batch_state = _startBatchIfReady(call, metadata_batch, batch_state,
                                        callback);
       var status_batch = {
-        [grpc.opType.RECV_STATUS_ON_CLIENT]: true
+        [grpc.opType.RECV_STATUS_ON_CLIENT]: RECV_METADATA_VIEW
       };
       call.startBatch(status_batch, function(err, response) {
         if (err) {
@@ -1083,7 +1087,7 @@ function _getBidiStreamingInterceptor(method_definition, channel, emitter) {
     final_requester.start = function (metadata, listener) {
       var metadata_batch = {
         [grpc.opType.SEND_INITIAL_METADATA]: metadata._getCoreRepresentation(),
-        [grpc.opType.RECV_INITIAL_METADATA]: true
+        [grpc.opType.RECV_INITIAL_METADATA]: RECV_METADATA_VIEW
       };
       first_listener = listener;
       call.startBatch(metadata_batch, function (err, response) {
@@ -1096,7 +1100,7 @@ function _getBidiStreamingInterceptor(method_definition, channel, emitter) {
         listener.onReceiveMetadata(response.metadata);
       });
       var recv_batch = {};
-      recv_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+      recv_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = RECV_METADATA_VIEW;
       call.startBatch(recv_batch, function (err, response) {
         var status = response.status;
         if (status.code === constants.status.OK) {
@@ -224,6 +224,21 @@ exports.writeFlags = {
   NO_COMPRESS: 2
 };
 
+/**
+ * Compression levels, for a server call's setCompression. Core picks the
+ * algorithm for a level from the ones that the client says it accepts.
+ * @memberof grpc
+ * @alias grpc.compressionLevel
+ * @readonly
+ * @enum {number}
+ */
+exports.compressionLevel = {
+  NONE: 0,
+  LOW: 1,
+  MEDIUM: 2,
+  HIGH: 3
+};
+
 /**
  * @memberof grpc
  * @alias grpc.logVerbosity
@@ -156,13 +156,22 @@ exports.createSsl = function(root_certs, private_key, cert_chain, verify_options
  * function gets the service URL and a callback as parameters. The error
  * passed to the callback can optionally have a 'code' value attached to it,
  * which corresponds to a status code that this library uses.
+ *
+ * If options.cacheTtl is set, metadata that is generated successfully is
+ * reused for calls to the same service URL for that many milliseconds, without
+ * calling the generator again. Those calls get the metadata without waiting
+ * for the event loop.
  * @memberof grpc.credentials
  * @alias grpc.credentials.createFromMetadataGenerator
  * @param {grpc.credentials~generateMetadata} metadata_generator The function
  *     that generates metadata
+ * @param {Object=} options Options for the credentials
+ * @param {number=} options.cacheTtl The number of milliseconds to cache
+ *     generated metadata for. Defaults to 0, which disables caching
  * @return {grpc.credentials~CallCredentials} The credentials object
  */
-exports.createFromMetadataGenerator = function(metadata_generator) {
+exports.createFromMetadataGenerator = function(metadata_generator, options) {
+  var cache_ttl = (options && options.cacheTtl) || 0;
   return CallCredentials.createFromPlugin(function(service_url, cb_data,
                                                    callback) {
     metadata_generator({service_url: service_url}, function(error, metadata) {
@@ -181,7 +190,7 @@ exports.createFromMetadataGenerator = function(metadata_generator) {
       }
       callback(code, message, metadata._getCoreRepresentation(), cb_data);
     });
-  });
+  }, cache_ttl);
 };
 
 function getAuthorizationHeaderFromGoogleCredential(google_credential, url, callback) {
@@ -34,6 +34,22 @@ var grpc = require('./grpc_extension');
  */
 function Metadata() {
   this._internal_repr = {};
+  /* Received metadata is kept in a native view until something needs to
+   * change it, so that only the entries that are read get converted */
+  this._view = null;
+}
+
+/**
+ * Replace the metadata's view with a mutable copy of its entries, if it has a
+ * view.
+ * @private
+ * @param {grpc.Metadata} metadata The metadata to copy
+ */
+function materialize(metadata) {
+  if (metadata._view !== null) {
+    metadata._internal_repr = metadata._view.toObject();
+    metadata._view = null;
+  }
 }
 
 function normalizeKey(key) {
@@ -72,6 +88,7 @@ function validate(key, value) {
 Metadata.prototype.set = function(key, value) {
   key = normalizeKey(key);
   validate(key, value);
+  materialize(this);
   this._internal_repr[key] = [value];
 };
 
@@ -84,6 +101,7 @@ Metadata.prototype.set = function(key, value) {
 Metadata.prototype.add = function(key, value) {
   key = normalizeKey(key);
   validate(key, value);
+  materialize(this);
   if (!this._internal_repr[key]) {
     this._internal_repr[key] = [];
   }
@@ -96,6 +114,7 @@ Metadata.prototype.add = function(key, value) {
  */
 Metadata.prototype.remove = function(key) {
   key = normalizeKey(key);
+  materialize(this);
   if (Object.prototype.hasOwnProperty.call(this._internal_repr, key)) {
     delete this._internal_repr[key];
   }
@@ -108,6 +127,9 @@ Metadata.prototype.remove = function(key) {
  */
 Metadata.prototype.get = function(key) {
   key = normalizeKey(key);
+  if (this._view !== null) {
+    return this._view.getAll(key);
+  }
   if (Object.prototype.hasOwnProperty.call(this._internal_repr, key)) {
     return this._internal_repr[key];
   } else {
@@ -122,6 +144,13 @@ Metadata.prototype.get = function(key) {
  */
 Metadata.prototype.getMap = function() {
   var result = {};
+  var view = this._view;
+  if (view !== null) {
+    _.forEach(view.keys(), function(key) {
+      result[key] = view.get(key);
+    });
+    return result;
+  }
   _.forOwn(this._internal_repr, function(values, key) {
     if(values.length > 0) {
       result[key] = values[0];
@@ -136,6 +165,11 @@ Metadata.prototype.getMap = function() {
  */
 Metadata.prototype.clone = function() {
   var copy = new Metadata();
+  if (this._view !== null) {
+    // Views never change, so the copy can share this one
+    copy._view = this._view;
+    return copy;
+  }
   _.forOwn(this._internal_repr, function(value, key) {
     copy._internal_repr[key] = _.clone(value);
   });
@@ -149,6 +183,7 @@ Metadata.prototype.clone = function() {
  * @return {Object.<String, Array.<String|Buffer>>} The metadata
  */
 Metadata.prototype._getCoreRepresentation = function() {
+  materialize(this);
   return this._internal_repr;
 };
 
@@ -156,12 +191,15 @@ Metadata.prototype._getCoreRepresentation = function() {
  * Creates a Metadata object from a metadata map in the internal format.
  * Intended for internal use only. API stability is not guaranteed.
  * @private
- * @param {Object.<String, Array.<String|Buffer>>} The metadata
+ * @param {Object.<String, Array.<String|Buffer>>|grpc.MetadataView} The
+ *     metadata, or a native view of received metadata
  * @return {Metadata} The new Metadata object
  */
 Metadata._fromCoreRepresentation = function(metadata) {
   var newMetadata = new Metadata();
-  if (metadata) {
+  if (metadata instanceof grpc.MetadataView) {
+    newMetadata._view = metadata;
+  } else if (metadata) {
     _.forOwn(metadata, function(value, key) {
       newMetadata._internal_repr[key] = _.clone(value);
     });
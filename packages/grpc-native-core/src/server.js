@@ -37,6 +37,13 @@ var util = require('util');
 
 var EventEmitter = require('events').EventEmitter;
 
+/**
+ * The number of bytes of messages that are read ahead of a readable stream's
+ * consumer, before reading waits for the consumer to catch up
+ * @private
+ */
+var READ_AHEAD_HIGH_WATER_MARK = 64 * 1024;
+
 /**
  * Handle an error on a call by sending it as a status
  * @private
@@ -203,6 +210,7 @@ function setUpReadable(stream, deserialize) {
   stream.deserialize = common.wrapIgnoreNull(deserialize);
   stream.finished = false;
   stream.reading = false;
+  stream.wantsData = false;
 
   stream.terminate = function() {
     stream.finished = true;
@@ -293,38 +301,45 @@ function ServerWritableStream(call, metadata, serialize) {
 }
 
 /**
- * Start writing a chunk of data. This is an implementation of a method required
- * for implementing stream.Writable.
+ * Start writing several chunks of data. This is an implementation of a method
+ * for implementing stream.Writable. The messages are queued natively, and
+ * each one is sent as soon as the one before it has been. The BUFFER_HINT
+ * write flag is ignored for these messages.
  * @private
- * @param {Buffer} chunk The chunk of data to write
- * @param {string} encoding Used to pass write flags
- * @param {function(Error=)} callback Callback to indicate that the write is
+ * @param {Array<{chunk: *, encoding: string}>} chunks The chunks of data to
+ *     write, each with the write flags passed as its encoding
+ * @param {function(Error=)} callback Callback to indicate that every write is
  *     complete
  */
-function _write(chunk, encoding, callback) {
+function _writev(chunks, callback) {
   /* jshint validthis: true */
-  var batch = {};
   var self = this;
-  var message;
-  try {
-    message = this.serialize(chunk);
-  } catch (e) {
-    e.code = constants.status.INTERNAL;
-    callback(e);
-    return;
+  var messages = [];
+  for (var i = 0; i < chunks.length; i++) {
+    var message;
+    try {
+      message = this.serialize(chunks[i].chunk);
+    } catch (e) {
+      e.code = constants.status.INTERNAL;
+      callback(e);
+      return;
+    }
+    if (_.isFinite(chunks[i].encoding)) {
+      /* Attach the encoding if it is a finite number. This is the closest we
+       * can get to checking that it is valid flags */
+      message.grpcWriteFlags = chunks[i].encoding;
+    }
+    messages.push(message);
   }
   if (!this.call.metadataSent) {
+    var batch = {};
     batch[grpc.opType.SEND_INITIAL_METADATA] =
         (new Metadata())._getCoreRepresentation();
     this.call.metadataSent = true;
+    // A failure here also fails the queued messages
+    this.call.startBatch(batch, function() {});
   }
-  if (_.isFinite(encoding)) {
-    /* Attach the encoding if it is a finite number. This is the closest we
-     * can get to checking that it is valid flags */
-    message.grpcWriteFlags = encoding;
-  }
-  batch[grpc.opType.SEND_MESSAGE] = message;
-  this.call.startBatch(batch, function(err, value) {
+  this.call.queueMessages(messages, function(err) {
     if (err) {
       self.emit('error', err);
       return;
@@ -333,7 +348,22 @@ function _write(chunk, encoding, callback) {
   });
 }
 
+/**
+ * Start writing a chunk of data. This is an implementation of a method required
+ * for implementing stream.Writable.
+ * @private
+ * @param {Buffer} chunk The chunk of data to write
+ * @param {string} encoding Used to pass write flags
+ * @param {function(Error=)} callback Callback to indicate that the write is
+ *     complete
+ */
+function _write(chunk, encoding, callback) {
+  /* jshint validthis: true */
+  _writev.call(this, [{chunk: chunk, encoding: encoding}], callback);
+}
+
 ServerWritableStream.prototype._write = _write;
+ServerWritableStream.prototype._writev = _writev;
 
 /**
  * Emitted when the call has been cancelled. After this has been emitted, the
@@ -372,55 +402,64 @@ function ServerReadableStream(call, metadata, deserialize) {
 }
 
 /**
- * Start reading from the gRPC data source. This is an implementation of a
- * method required for implementing stream.Readable
- * @access private
- * @param {number} size Ignored
+ * Push the messages that have been read ahead onto the read queue
+ * @private
+ * @param {Readable} stream The stream to push the messages onto
  */
-function _read(size) {
-  /* jshint validthis: true */
-  var self = this;
-  /**
-   * Callback to be called when a READ event is received. Pushes the data onto
-   * the read queue and starts reading again if applicable
-   * @param {grpc.Event} event READ event object
-   */
-  function readCallback(err, event) {
-    if (err) {
-      self.terminate();
+function pushReadAheadMessages(stream) {
+  var messages = stream.call.takeMessages();
+  for (var i = 0; i < messages.length; i++) {
+    if (stream.finished) {
+      stream.push(null);
       return;
     }
-    if (self.finished) {
-      self.push(null);
-      return;
-    }
-    var data = event.read;
+    var data = messages[i];
     var deserialized;
     try {
-      deserialized = self.deserialize(data);
+      deserialized = stream.deserialize(data);
     } catch (e) {
       e.code = constants.status.INTERNAL;
-      self.emit('error', e);
+      stream.emit('error', e);
       return;
     }
-    if (self.push(deserialized) && data !== null) {
-      var read_batch = {};
-      read_batch[grpc.opType.RECV_MESSAGE] = true;
-      self.call.startBatch(read_batch, readCallback);
-    } else {
-      self.reading = false;
+    stream.wantsData = stream.push(deserialized);
+    if (data === null) {
+      return;
     }
   }
+}
+
+/**
+ * Start reading from the gRPC data source. This is an implementation of a
+ * method required for implementing stream.Readable. Messages are read ahead
+ * natively, without waiting for each one to be handled, up to
+ * READ_AHEAD_HIGH_WATER_MARK bytes.
+ * @access private
+ * @param {number} size Ignored
+ */
+function _read(size) {
+  /* jshint validthis: true */
+  var self = this;
   if (self.finished) {
     self.push(null);
-  } else {
-    if (!self.reading) {
-      self.reading = true;
-      var batch = {};
-      batch[grpc.opType.RECV_MESSAGE] = true;
-      self.call.startBatch(batch, readCallback);
-    }
+    return;
+  }
+  self.wantsData = true;
+  if (self.reading) {
+    pushReadAheadMessages(self);
+    return;
   }
+  self.reading = true;
+  self.call.startReadAhead(READ_AHEAD_HIGH_WATER_MARK, function(err) {
+    if (err) {
+      self.terminate();
+      return;
+    }
+    // Otherwise, the messages wait until the next call to _read
+    if (self.wantsData) {
+      pushReadAheadMessages(self);
+    }
+  });
 }
 
 ServerReadableStream.prototype._read = _read;
@@ -466,6 +505,7 @@ function ServerDuplexStream(call, metadata, serialize, deserialize) {
 
 ServerDuplexStream.prototype._read = _read;
 ServerDuplexStream.prototype._write = _write;
+ServerDuplexStream.prototype._writev = _writev;
 
 /**
  * Send the initial metadata for a writable stream.
@@ -565,22 +605,18 @@ ServerDuplexStream.prototype.waitForCancel = waitForCancel;
  * @param {grpc~serialize} handler.serialize The serialization function for
  *     response data
  * @param {grpc.Metadata} metadata Metadata from the client
+ * @param {?Buffer=} payload The request message, if it was read along with the
+ *     call
  */
-function handleUnary(call, handler, metadata) {
+function handleUnary(call, handler, metadata, payload) {
   var emitter = new ServerUnaryCall(call, metadata);
   emitter.on('error', function(error) {
     handleError(call, error);
   });
   emitter.waitForCancel();
-  var batch = {};
-  batch[grpc.opType.RECV_MESSAGE] = true;
-  call.startBatch(batch, function(err, result) {
-    if (err) {
-      handleError(call, err);
-      return;
-    }
+  function handleRequest(message) {
     try {
-      emitter.request = handler.deserialize(result.read);
+      emitter.request = handler.deserialize(message);
     } catch (e) {
       e.code = constants.status.INTERNAL;
       handleError(call, e);
@@ -599,6 +635,19 @@ function handleUnary(call, handler, metadata) {
         sendUnaryResponse(call, value, handler.serialize, trailer, flags);
       }
     });
+  }
+  if (payload !== undefined) {
+    handleRequest(payload);
+    return;
+  }
+  var batch = {};
+  batch[grpc.opType.RECV_MESSAGE] = true;
+  call.startBatch(batch, function(err, result) {
+    if (err) {
+      handleError(call, err);
+      return;
+    }
+    handleRequest(result.read);
   });
 }
 
@@ -620,25 +669,34 @@ function handleUnary(call, handler, metadata) {
  * @param {grpc~serialize} handler.serialize The serialization function for
  *     response data
  * @param {grpc.Metadata} metadata Metadata from the client
+ * @param {?Buffer=} payload The request message, if it was read along with the
+ *     call
  */
-function handleServerStreaming(call, handler, metadata) {
+function handleServerStreaming(call, handler, metadata, payload) {
   var stream = new ServerWritableStream(call, metadata, handler.serialize);
   stream.waitForCancel();
-  var batch = {};
-  batch[grpc.opType.RECV_MESSAGE] = true;
-  call.startBatch(batch, function(err, result) {
-    if (err) {
-      stream.emit('error', err);
-      return;
-    }
+  function handleRequest(message) {
     try {
-      stream.request = handler.deserialize(result.read);
+      stream.request = handler.deserialize(message);
     } catch (e) {
       e.code = constants.status.INTERNAL;
       stream.emit('error', e);
       return;
     }
     handler.func(stream);
+  }
+  if (payload !== undefined) {
+    handleRequest(payload);
+    return;
+  }
+  var batch = {};
+  batch[grpc.opType.RECV_MESSAGE] = true;
+  call.startBatch(batch, function(err, result) {
+    if (err) {
+      stream.emit('error', err);
+      return;
+    }
+    handleRequest(result.read);
   });
 }
 
@@ -721,7 +779,11 @@ var streamHandlers = {
  * @memberof grpc
  * @constructor
  * @param {Object=} options Options that should be passed to the internal server
- *     implementation
+ *     implementation. The option 'grpc-node.request_call_depth' is handled by
+ *     this library instead: if it is greater than 1, that many requests for
+ *     incoming calls are kept outstanding, and each one is replaced natively
+ *     as soon as it completes, instead of waiting for JavaScript to ask for
+ *     the next call.
  * @example
  * var server = new grpc.Server();
  * server.addProtoService(protobuf_service_descriptor, service_implementation);
@@ -730,7 +792,14 @@ var streamHandlers = {
  */
 function Server(options) {
   this.handlers = {};
+  this.request_call_depth = 1;
+  if (options && options.hasOwnProperty('grpc-node.request_call_depth')) {
+    this.request_call_depth = options['grpc-node.request_call_depth'];
+    options = _.omit(options, 'grpc-node.request_call_depth');
+  }
   var server = new grpc.Server(options);
+  // Metadata only converts the entries of a view that handlers read
+  server.setMetadataViews(true);
   this._server = server;
   this.started = false;
 }
@@ -744,7 +813,16 @@ Server.prototype.start = function() {
   }
   var self = this;
   this.started = true;
+  /* Register every method that has a handler, so that core matches calls to
+   * them and they do not have to be looked up by name for each call */
+  var method_ids = _.mapValues(this.handlers, function(handler, name) {
+    // Methods with a single request message get it along with the call
+    var read_payload = (handler.type === 'unary' ||
+                        handler.type === 'server_stream');
+    return self._server.registerMethod(name, read_payload);
+  });
   this._server.start();
+  var pooled = this.request_call_depth > 1;
   /**
    * Handles the SERVER_RPC_NEW event. If there is a handler associated with
    * the requested method, use that handler to respond to the request. Then
@@ -763,7 +841,9 @@ Server.prototype.start = function() {
     if (method === null) {
       return;
     }
-    self._server.requestCall(handleNewCall);
+    if (!pooled) {
+      self._server.requestCall(handleNewCall);
+    }
     var handler;
     if (self.handlers.hasOwnProperty(method)) {
       handler = self.handlers[method];
@@ -782,7 +862,42 @@ Server.prototype.start = function() {
     }
     streamHandlers[handler.type](call, handler, metadata);
   }
-  this._server.requestCall(handleNewCall);
+  /**
+   * Make a function that handles new calls to a single registered method
+   * @param {number} method_id The id returned by registerMethod
+   * @param {Object} handler The handler for the method
+   * @return {function(Error, grpc.internal~Event)} The new call handler
+   */
+  function makeRegisteredCallHandler(method_id, handler) {
+    return function handleRegisteredCall(err, event) {
+      if (err) {
+        return;
+      }
+      if (!pooled) {
+        self._server.requestRegisteredCall(method_id, handleRegisteredCall);
+      }
+      var details = event.new_call;
+      var metadata = Metadata._fromCoreRepresentation(details.metadata);
+      streamHandlers[handler.type](details.call, handler, metadata,
+                                   details.payload);
+    };
+  }
+  // Unregistered methods still arrive through the generic call requests
+  if (pooled) {
+    this._server.requestCalls(this.request_call_depth, handleNewCall);
+  } else {
+    this._server.requestCall(handleNewCall);
+  }
+  _.forEach(method_ids, function(method_id, name) {
+    var handleRegisteredCall = makeRegisteredCallHandler(method_id,
+                                                         self.handlers[name]);
+    if (pooled) {
+      self._server.requestCalls(self.request_call_depth, handleRegisteredCall,
+                                method_id);
+    } else {
+      self._server.requestRegisteredCall(method_id, handleRegisteredCall);
+    }
+  });
 };
 
 /**
@@ -841,6 +956,47 @@ Server.prototype.forceShutdown = function() {
   this._server.forceShutdown();
 };
 
+/**
+ * Shuts down the server with a bounded drain. The server stops receiving new
+ * calls immediately, and calls that are in flight have until the deadline to
+ * complete. Only the calls that are still in flight at the deadline are
+ * cancelled. This method is idempotent with tryShutdown and forceShutdown,
+ * but only one drain can be in progress.
+ * @param {grpc~Deadline} deadline When to cancel the remaining calls
+ * @param {function(?Error, number=)} callback Called when the server has shut
+ *     down, with an error if the drain failed, or with the number of calls
+ *     that were cancelled at the deadline
+ */
+Server.prototype.drain = function(deadline, callback) {
+  this._server.drain(deadline, function(err, event) {
+    if (err) {
+      callback(err);
+      return;
+    }
+    callback(null, event.drain.cancelledCalls);
+  });
+};
+
+/**
+ * Get the number of calls that the server has accepted and that have not
+ * finished. While the server drains, this reports its progress.
+ * @return {number}
+ */
+Server.prototype.getInFlightCalls = function() {
+  return this._server.getInFlightCalls();
+};
+
+/**
+ * Get the server's channelz data, which includes the number of calls started,
+ * succeeded and failed, the time of its last call and the ids of its listen
+ * sockets.
+ * @return {?Object} The channelz data, in its JSON form, or null if channelz
+ *     is disabled by setting the grpc.enable_channelz option to 0
+ */
+Server.prototype.getChannelz = function() {
+  return this._server.getChannelz();
+};
+
 var unimplementedStatusResponse = {
   code: constants.status.UNIMPLEMENTED,
   details: 'The server does not implement this method'
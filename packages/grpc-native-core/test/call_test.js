@@ -19,6 +19,8 @@
 'use strict';
 
 var assert = require('assert');
+var child_process = require('child_process');
+var path = require('path');
 var grpc = require('../src/grpc_extension');
 var constants = require('../src/constants');
 
@@ -201,6 +203,87 @@ describe('call', function() {
         call.startBatch(batch, function(){});
       }, TypeError);
     });
+    it('should succeed with an array of buffers', function(done) {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.doesNotThrow(function() {
+        var batch = {};
+        batch[grpc.opType.SEND_MESSAGE] = [new Buffer('abc'),
+                                           new Buffer('def')];
+        call.startBatch(batch, function(err, resp) {
+          assert.ifError(err);
+          assert.deepEqual(resp, {'send_message': true});
+          done();
+        });
+      });
+    });
+    it('should fail with an array containing a non-buffer', function() {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.throws(function() {
+        var batch = {};
+        batch[grpc.opType.SEND_MESSAGE] = [new Buffer('abc'), 'def'];
+        call.startBatch(batch, function(){});
+      }, TypeError);
+    });
+    it('should succeed with a message and flags', function(done) {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.doesNotThrow(function() {
+        var batch = {};
+        batch[grpc.opType.SEND_MESSAGE] = {
+          message: new Buffer('abc'),
+          flags: constants.writeFlags.NO_COMPRESS
+        };
+        call.startBatch(batch, function(err, resp) {
+          assert.ifError(err);
+          assert.deepEqual(resp, {'send_message': true});
+          done();
+        });
+      });
+    });
+    it('should fail with non-numeric flags', function() {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.throws(function() {
+        var batch = {};
+        batch[grpc.opType.SEND_MESSAGE] = {
+          message: new Buffer('abc'),
+          flags: 'NO_COMPRESS'
+        };
+        call.startBatch(batch, function(){});
+      }, TypeError);
+    });
+  });
+  describe('setCompression', function() {
+    it('should accept a level, an algorithm name, or null', function() {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.doesNotThrow(function() {
+        call.setCompression(constants.compressionLevel.HIGH);
+        call.setCompression('gzip');
+        call.setCompression(null);
+      });
+    });
+    it('should reject unknown levels and algorithms', function() {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.throws(function() {
+        call.setCompression(100);
+      }, RangeError);
+      assert.throws(function() {
+        call.setCompression('not-an-algorithm');
+      }, RangeError);
+      assert.throws(function() {
+        call.setCompression({});
+      }, TypeError);
+    });
+    it('should send initial metadata with an algorithm', function(done) {
+      var call = channel.createCall('method', getDeadline(1));
+      call.setCompression('gzip');
+      var batch = {};
+      batch[grpc.opType.SEND_INITIAL_METADATA] =
+          new grpc.PreparedMetadata({'key': ['value']});
+      call.startBatch(batch, function(err, resp) {
+        assert.ifError(err);
+        assert.deepEqual(resp, {'send_metadata': true});
+        done();
+      });
+    });
   });
   describe('startBatch with status', function() {
     it('should fail without a code', function() {
@@ -273,6 +356,138 @@ describe('call', function() {
       }, TypeError);
     });
   });
+  describe('BatchTemplate', function() {
+    it('should accept an array of distinct op types', function() {
+      assert.doesNotThrow(function() {
+        new grpc.BatchTemplate([grpc.opType.SEND_INITIAL_METADATA,
+                                grpc.opType.SEND_MESSAGE,
+                                grpc.opType.RECV_STATUS_ON_CLIENT]);
+      });
+    });
+    it('should reject anything other than an array of op types', function() {
+      assert.throws(function() {
+        new grpc.BatchTemplate();
+      }, TypeError);
+      assert.throws(function() {
+        new grpc.BatchTemplate(['abc']);
+      }, TypeError);
+      assert.throws(function() {
+        new grpc.BatchTemplate([100]);
+      });
+    });
+    it('should reject repeated op types', function() {
+      assert.throws(function() {
+        new grpc.BatchTemplate([grpc.opType.SEND_MESSAGE,
+                                grpc.opType.SEND_MESSAGE]);
+      });
+    });
+  });
+  describe('startBatchFromTemplate', function() {
+    var batch_template;
+    before(function() {
+      batch_template = new grpc.BatchTemplate([
+        grpc.opType.SEND_INITIAL_METADATA,
+        grpc.opType.SEND_MESSAGE]);
+    });
+    it('should succeed with values in template order', function(done) {
+      var call = channel.createCall('method', getDeadline(1));
+      call.startBatchFromTemplate(
+          batch_template, [{'key1': ['value1']}, new Buffer('abc')],
+          function(err, resp) {
+            assert.ifError(err);
+            assert.deepEqual(resp, {'send_metadata': true,
+                                    'send_message': true});
+            done();
+          });
+    });
+    it('should fail with incorrectly typed values', function() {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.throws(function() {
+        call.startBatchFromTemplate(batch_template, [{}, 'abc'],
+                                    function(){});
+      }, TypeError);
+      assert.throws(function() {
+        call.startBatchFromTemplate(batch_template, {}, function(){});
+      }, TypeError);
+    });
+    it('should fail without a template', function() {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.throws(function() {
+        call.startBatchFromTemplate({}, [], function(){});
+      }, TypeError);
+    });
+  });
+  describe('startReadAhead', function() {
+    it('should reject a bad high water mark or callback', function() {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.throws(function() {
+        call.startReadAhead('abc', function() {});
+      }, TypeError);
+      assert.throws(function() {
+        call.startReadAhead(1024);
+      }, TypeError);
+    });
+    it('should be required before takeMessages', function() {
+      var call = channel.createCall('method', getDeadline(1));
+      assert.throws(function() {
+        call.takeMessages();
+      });
+    });
+  });
+  describe('queueMessages', function() {
+    it('should require a non-empty array of Buffers and a callback',
+       function() {
+         var call = channel.createCall('method', getDeadline(1));
+         assert.throws(function() {
+           call.queueMessages(new Buffer('abc'), function() {});
+         }, TypeError);
+         assert.throws(function() {
+           call.queueMessages(['abc'], function() {});
+         }, TypeError);
+         assert.throws(function() {
+           call.queueMessages([new Buffer('abc')]);
+         }, TypeError);
+         assert.throws(function() {
+           call.queueMessages([], function() {});
+         });
+       });
+  });
+  describe('PreparedMetadata', function() {
+    it('should accept a metadata object or nothing', function() {
+      assert.doesNotThrow(function() {
+        new grpc.PreparedMetadata();
+        new grpc.PreparedMetadata({'key': ['value']});
+      });
+    });
+    it('should reject invalid metadata', function() {
+      assert.throws(function() {
+        new grpc.PreparedMetadata('abc');
+      }, TypeError);
+      assert.throws(function() {
+        new grpc.PreparedMetadata({'key': 'value'});
+      }, TypeError);
+    });
+    it('should be accepted as initial metadata', function(done) {
+      var call = channel.createCall('method', getDeadline(1));
+      var batch = {};
+      batch[grpc.opType.SEND_INITIAL_METADATA] =
+          new grpc.PreparedMetadata({'key1': ['value1']});
+      call.startBatch(batch, function(err, resp) {
+        assert.ifError(err);
+        assert.deepEqual(resp, {'send_metadata': true});
+        done();
+      });
+    });
+    it('should return a new object from append', function() {
+      var prepared = new grpc.PreparedMetadata({'key1': ['value1']});
+      var appended = prepared.append({'key2': ['value2']});
+      assert(appended instanceof grpc.PreparedMetadata);
+      assert.notStrictEqual(appended, prepared);
+      assert.throws(function() {
+        prepared.append({'key3': 'value3'});
+      }, TypeError);
+    });
+  });
   describe('cancel', function() {
     it('should succeed', function() {
       var call = channel.createCall('method', getDeadline(1));
@@ -323,5 +538,177 @@ describe('call', function() {
       var call = channel.createCall('method', getDeadline(1));
       assert.strictEqual(typeof call.getPeer(), 'string');
     });
+    it('should still return the peer after the call has finished',
+       function(done) {
+         var call = channel.createCall('method', getDeadline(1));
+         var batch = {};
+         batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+         call.startBatch(batch, function(err, response) {
+           // The call is only finished after the callback returns
+           setImmediate(function() {
+             var peer = call.getPeer();
+             assert.strictEqual(typeof peer, 'string');
+             assert.strictEqual(call.getPeer(), peer);
+             done();
+           });
+         });
+         call.cancel();
+       });
+  });
+  describe('getAllocatorStats', function() {
+    it('should reuse tags from finished batches', function(done) {
+      var call = channel.createCall('method', getDeadline(1));
+      call.startBatch({}, function(err) {
+        assert.ifError(err);
+        // The first tag is released after this callback returns
+        setImmediate(function() {
+          var before = grpc.getAllocatorStats().tag;
+          var second_call = channel.createCall('method', getDeadline(1));
+          second_call.startBatch({}, function(err) {
+            assert.ifError(err);
+            var after = grpc.getAllocatorStats().tag;
+            assert(after.hits > before.hits);
+            done();
+          });
+        });
+      });
+    });
+  });
+  describe('Call', function() {
+    it('should not be constructible from JavaScript', function() {
+      assert.throws(function() {
+        new grpc.Call();
+      }, TypeError);
+    });
+    it('should allocate calls from a free list', function() {
+      // Earlier tests have created calls, so the free list exists
+      var before = grpc.getAllocatorStats().call;
+      var call = channel.createCall('method', getDeadline(1));
+      var after = grpc.getAllocatorStats().call;
+      assert(call instanceof grpc.Call);
+      assert.strictEqual(after.hits + after.misses,
+                         before.hits + before.misses + 1);
+    });
+  });
+  describe('getStats', function() {
+    afterEach(function() {
+      grpc.setPerMethodStats(false);
+    });
+    it('should count and time completed batches', function(done) {
+      var before = grpc.getStats();
+      var call = channel.createCall('method', getDeadline(1));
+      var batch = {};
+      batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+      call.startBatch(batch, function(err) {
+        assert.ifError(err);
+        var after = grpc.getStats();
+        assert.strictEqual(after.batchesStarted, before.batchesStarted + 1);
+        assert.strictEqual(after.batchesCompleted,
+                           before.batchesCompleted + 1);
+        assert.strictEqual(after.batchLatency.count,
+                           before.batchLatency.count + 1);
+        assert(after.batchLatency.p50 > 0);
+        assert(after.batchLatency.buckets.length > 0);
+        done();
+      });
+    });
+    it('should keep stats per method when enabled', function(done) {
+      grpc.setPerMethodStats(true);
+      var call = channel.createCall('/stats/method', getDeadline(1));
+      var batch = {};
+      batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+      call.startBatch(batch, function(err) {
+        assert.ifError(err);
+        var method = grpc.getStats().methods['/stats/method'];
+        assert.strictEqual(method.calls, 1);
+        assert.strictEqual(method.batchLatency.count, 1);
+        done();
+      });
+    });
+    it('should not keep stats per method by default', function() {
+      channel.createCall('/stats/unseen', getDeadline(1));
+      assert.strictEqual(grpc.getStats().methods['/stats/unseen'], undefined);
+    });
+  });
+  describe('setBatchDispatcher', function() {
+    afterEach(function() {
+      grpc.setBatchDispatcher(null);
+    });
+    it('should pass completions to the dispatcher', function(done) {
+      var dispatched = 0;
+      grpc.setBatchDispatcher(function(completions) {
+        assert.strictEqual(completions.length % 3, 0);
+        for (var i = 0; i < completions.length; i += 3) {
+          dispatched++;
+          completions[i](completions[i + 1], completions[i + 2]);
+        }
+      });
+      var call = channel.createCall('method', getDeadline(1));
+      var batch = {};
+      batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+      call.startBatch(batch, function(err, resp) {
+        assert.ifError(err);
+        assert.deepEqual(resp, {'send_metadata': true});
+        assert.strictEqual(dispatched, 1);
+        done();
+      });
+    });
+    it('should reject anything other than a function or null', function() {
+      assert.throws(function() {
+        grpc.setBatchDispatcher('dispatcher');
+      }, TypeError);
+    });
+  });
+  describe('completion queue thread', function() {
+    it('should not be enabled after calls have been created', function() {
+      channel.createCall('method', getDeadline(1));
+      assert.throws(function() {
+        grpc.enableCompletionQueueThread();
+      });
+    });
+    it('should complete calls when enabled first', function(done) {
+      this.timeout(15000);
+      /* The thread can only be enabled before anything uses the queue, so
+       * this runs in a new process. The process only exits on its own if the
+       * thread stops keeping the loop alive once the calls are done. */
+      var script = [
+        'var grpc = require(' + JSON.stringify(path.resolve(__dirname, '..')) +
+            ');',
+        'grpc.enableCompletionQueueThread();',
+        'var identity = function(value) { return value; };',
+        'var service = {echo: {path: "/test/echo", requestStream: false,',
+        '  responseStream: false, requestSerialize: identity,',
+        '  requestDeserialize: identity, responseSerialize: identity,',
+        '  responseDeserialize: identity}};',
+        'var server = new grpc.Server();',
+        'server.addService(service, {echo: function(call, callback) {',
+        '  callback(null, call.request);',
+        '}});',
+        'var port = server.bind("localhost:0",',
+        '                       grpc.ServerCredentials.createInsecure());',
+        'server.start();',
+        'var Client = grpc.makeGenericClientConstructor(service);',
+        'var client = new Client("localhost:" + port,',
+        '                        grpc.credentials.createInsecure());',
+        // Enough calls at once that completions arrive in bursts
+        'var remaining = 32;',
+        'for (var i = 0; i < 32; i++) {',
+        '  client.echo(Buffer.from("ping" + i), function(err, response) {',
+        '    if (err) { throw err; }',
+        '    if (--remaining === 0) {',
+        '      client.close();',
+        '      server.tryShutdown(function() { console.log("done"); });',
+        '    }',
+        '  });',
+        '}'
+      ].join('\n');
+      child_process.execFile(
+          process.execPath, ['-e', script], {timeout: 10000},
+          function(err, stdout) {
+            assert.ifError(err);
+            assert.strictEqual(stdout.trim(), 'done');
+            done();
+          });
+    });
   });
 });
@@ -20,6 +20,7 @@
 
 var assert = require('assert');
 var grpc = require('..');
+var grpcExtension = require('../src/grpc_extension');
 
 /**
  * This is used for testing functions with multiple asynchronous calls that
@@ -89,6 +90,20 @@ describe('channel', function() {
         new grpc.Channel('hostname', insecureCreds, {'key' : new Date()});
       });
     });
+    it('should accept a ResourceQuota for the resource quota', function() {
+      var quota = new grpc.ResourceQuota(1024 * 1024);
+      assert.doesNotThrow(function() {
+        new grpc.Channel('hostname', insecureCreds,
+                         {'grpc.resource_quota': quota});
+      });
+      assert.throws(function() {
+        new grpc.Channel('hostname', insecureCreds, {'key': quota});
+      });
+      assert.throws(function() {
+        new grpc.Channel('hostname', insecureCreds,
+                         {'grpc.resource_quota': 1024});
+      });
+    });
     it('should succeed without the new keyword', function() {
       assert.doesNotThrow(function() {
         var channel = grpc.Channel('hostname', insecureCreds);
@@ -132,6 +147,43 @@ describe('channel', function() {
                          grpc.connectivityState.IDLE);
     });
   });
+  describe('getChannelz', function() {
+    it('should report the channel when channelz is enabled', function() {
+      var channel = new grpc.Channel('localhost', insecureCreds,
+                                     {'grpc.enable_channelz': 1});
+      var channelz = channel.getChannelz();
+      assert(channelz.channel.ref.channelId);
+      assert.strictEqual(channelz.channel.data.target, 'localhost');
+      channel.close();
+    });
+    it('should return null when channelz is disabled', function() {
+      var channel = new grpc.Channel('localhost', insecureCreds,
+                                     {'grpc.enable_channelz': 0});
+      assert.strictEqual(channel.getChannelz(), null);
+      channel.close();
+    });
+    it('should fail on a closed channel', function() {
+      var channel = new grpc.Channel('localhost', insecureCreds, {});
+      channel.close();
+      assert.throws(function() {
+        channel.getChannelz();
+      });
+    });
+  });
+  describe('channelz lookups', function() {
+    it('should require ids', function() {
+      assert.throws(function() {
+        grpc.getChannelzSubchannel({});
+      }, TypeError);
+      assert.throws(function() {
+        grpc.getChannelzSocket('abc');
+      }, TypeError);
+    });
+    it('should return null for unknown ids', function() {
+      assert.strictEqual(grpc.getChannelzSubchannel('9007199254740991'), null);
+      assert.strictEqual(grpc.getChannelzSocket(9007199254740991), null);
+    });
+  });
   describe('watchConnectivityState', function() {
     var channel;
     beforeEach(function() {
@@ -179,3 +231,169 @@ describe('channel', function() {
     });
   });
 });
+describe('ConnectivityMonitor', function() {
+  var channel;
+  var monitor;
+  beforeEach(function() {
+    channel = new grpc.Channel('localhost', insecureCreds, {});
+  });
+  afterEach(function() {
+    monitor.close();
+    channel.close();
+  });
+  it('should require a callback', function() {
+    monitor = new grpc.ConnectivityMonitor(function() {});
+    assert.throws(function() {
+      new grpc.ConnectivityMonitor();
+    }, TypeError);
+    assert.throws(function() {
+      new grpc.ConnectivityMonitor(function() {}, 0);
+    }, TypeError);
+  });
+  it('should only accept channels', function() {
+    monitor = new grpc.ConnectivityMonitor(function() {});
+    assert.throws(function() {
+      monitor.add({});
+    }, TypeError);
+  });
+  it('should report a forced connection attempt', function(done) {
+    var old_state = channel.getConnectivityState();
+    monitor = new grpc.ConnectivityMonitor(function(changes) {
+      assert.strictEqual(changes[0][0], 0);
+      assert.notEqual(changes[0][1], old_state);
+      // Later changes are not checked
+      monitor.remove(0);
+      done();
+    });
+    assert.strictEqual(monitor.add(channel), 0);
+    channel.getConnectivityState(true);
+  });
+});
+describe('ResourceQuota', function() {
+  it('should require a positive integer limit', function() {
+    assert.doesNotThrow(function() {
+      new grpc.ResourceQuota(1024, 'name');
+    });
+    assert.throws(function() {
+      new grpc.ResourceQuota();
+    }, TypeError);
+    assert.throws(function() {
+      new grpc.ResourceQuota(0);
+    }, TypeError);
+    assert.throws(function() {
+      new grpc.ResourceQuota(1.5);
+    }, TypeError);
+  });
+  it('should report its limit in its usage and in the stats', function() {
+    var quota = new grpc.ResourceQuota(4096, 'stats quota');
+    quota.resize(8192);
+    var usage = quota.getUsage();
+    assert.strictEqual(usage.name, 'stats quota');
+    assert.strictEqual(usage.limit, 8192);
+    assert(usage.usage >= 0);
+    var stats = grpcExtension.getStats().resourceQuotas.filter(function(stat) {
+      return stat.name === 'stats quota';
+    });
+    assert.strictEqual(stats.length, 1);
+    assert.strictEqual(stats[0].limit, 8192);
+  });
+  it('should be shareable between a server and a channel', function() {
+    var quota = new grpc.ResourceQuota(1024 * 1024);
+    var server = new grpc.Server({'grpc.resource_quota': quota});
+    var channel = new grpc.Channel('localhost', insecureCreds,
+                                   {'grpc.resource_quota': quota});
+    channel.close();
+    server.forceShutdown();
+  });
+});
+describe('ChannelPool', function() {
+  var deadline;
+  beforeEach(function() {
+    deadline = new Date();
+    deadline.setSeconds(deadline.getSeconds() + 10);
+  });
+  describe('constructor', function() {
+    it('should require a positive size', function() {
+      assert.doesNotThrow(function() {
+        new grpc.ChannelPool('hostname', insecureCreds, {}, 2);
+      });
+      assert.throws(function() {
+        new grpc.ChannelPool('hostname', insecureCreds, {});
+      }, TypeError);
+      assert.throws(function() {
+        new grpc.ChannelPool('hostname', insecureCreds, {}, 0);
+      }, TypeError);
+    });
+    it('should require a known pick policy, if provided', function() {
+      assert.doesNotThrow(function() {
+        new grpc.ChannelPool('hostname', insecureCreds, {}, 2,
+                             'least_outstanding');
+      });
+      assert.throws(function() {
+        new grpc.ChannelPool('hostname', insecureCreds, {}, 2, 'random');
+      }, TypeError);
+    });
+    it('should require the same options as a Channel', function() {
+      assert.throws(function() {
+        new grpc.ChannelPool('hostname', insecureCreds, {key: {}}, 2);
+      }, TypeError);
+    });
+  });
+  describe('createCall', function() {
+    var pool;
+    afterEach(function() {
+      pool.close();
+    });
+    it('should spread calls across the channels in turn', function() {
+      pool = new grpc.ChannelPool('localhost', insecureCreds, {}, 3);
+      var calls = [];
+      for (var i = 0; i < 4; i++) {
+        calls.push(pool.createCall('method', deadline));
+        assert(calls[i] instanceof grpcExtension.Call);
+      }
+      assert.deepEqual(pool.getOutstandingCalls(), [2, 1, 1]);
+    });
+    it('should pick the channel with the fewest outstanding calls',
+       function(done) {
+      pool = new grpc.ChannelPool('localhost', insecureCreds, {}, 2,
+                                  'least_outstanding');
+      var first = pool.createCall('method', deadline);
+      pool.createCall('method', deadline);
+      assert.deepEqual(pool.getOutstandingCalls(), [1, 1]);
+      var batch = {};
+      batch[grpcExtension.opType.RECV_STATUS_ON_CLIENT] = true;
+      first.startBatch(batch, function(err) {
+        assert.ifError(err);
+        // The call finishes after this callback returns
+        setImmediate(function() {
+          assert.deepEqual(pool.getOutstandingCalls(), [0, 1]);
+          pool.createCall('method', deadline);
+          assert.deepEqual(pool.getOutstandingCalls(), [1, 1]);
+          done();
+        });
+      });
+      first.cancel();
+    });
+    it('should check its arguments like a Channel', function() {
+      pool = new grpc.ChannelPool('localhost', insecureCreds, {}, 2);
+      assert.throws(function() {
+        pool.createCall(5, deadline);
+      }, TypeError);
+    });
+    it('should fail after the pool is closed', function() {
+      pool = new grpc.ChannelPool('localhost', insecureCreds, {}, 2);
+      pool.close();
+      assert.throws(function() {
+        pool.createCall('method', deadline);
+      });
+    });
+  });
+  describe('getConnectivityState', function() {
+    it('should return IDLE for a new pool', function() {
+      var pool = new grpc.ChannelPool('localhost', insecureCreds, {}, 2);
+      assert.strictEqual(pool.getConnectivityState(),
+                         grpc.connectivityState.IDLE);
+      pool.close();
+    });
+  });
+});
@@ -66,6 +66,8 @@ var fakeFailingGoogleCredentials = {
 };
 
 var key_data, pem_data, ca_data;
+// A self-signed pair for the same names, which ca_data does not trust
+var untrusted_key_data, untrusted_pem_data;
 
 before(function() {
   var key_path = path.join(__dirname, '/data/server1.key');
@@ -74,6 +76,10 @@ before(function() {
   key_data = fs.readFileSync(key_path);
   pem_data = fs.readFileSync(pem_path);
   ca_data = fs.readFileSync(ca_path);
+  untrusted_key_data =
+      fs.readFileSync(path.join(__dirname, '/data/untrusted.key'));
+  untrusted_pem_data =
+      fs.readFileSync(path.join(__dirname, '/data/untrusted.pem'));
 });
 
 describe('channel credentials', function() {
@@ -222,6 +228,78 @@ describe('server credentials', function() {
       }, TypeError);
     });
   });
+  describe('#createSslReloadable', function() {
+    it('accepts the same arguments as createSsl', function() {
+      var creds;
+      assert.doesNotThrow(function() {
+        creds = grpc.ServerCredentials.createSslReloadable(
+            ca_data, [{private_key: key_data, cert_chain: pem_data}], true);
+      });
+      assert.notEqual(creds, null);
+    });
+    it('fails without a key/cert pair', function() {
+      assert.throws(function() {
+        grpc.ServerCredentials.createSslReloadable(ca_data, []);
+      }, TypeError);
+    });
+    it('fails if a pair does not have Buffers', function() {
+      assert.throws(function() {
+        grpc.ServerCredentials.createSslReloadable(
+            null, [{private_key: 'test', cert_chain: pem_data}]);
+      }, TypeError);
+    });
+    it('only allows updating reloadable credentials', function() {
+      var creds = grpc.ServerCredentials.createSsl(
+          null, [{private_key: key_data, cert_chain: pem_data}]);
+      assert.throws(function() {
+        creds.updateCertificates(
+            null, [{private_key: key_data, cert_chain: pem_data}]);
+      });
+    });
+    it('uses the new certificates for new connections', function(done) {
+      var proto = grpc.load(__dirname + '/test_service.proto');
+      var server = new grpc.Server();
+      server.addService(proto.TestService.service, {
+        unary: function(call, cb) {
+          cb(null, {});
+        }
+      });
+      var creds = grpc.ServerCredentials.createSslReloadable(
+          null, [{private_key: key_data, cert_chain: pem_data}]);
+      var port = server.bind('localhost:0', creds);
+      server.start();
+      /* Channels with different options don't share subchannels, so each
+       * client makes its own connection, with its own handshake */
+      var clientCount = 0;
+      var newClient = function() {
+        clientCount++;
+        return new proto.TestService(
+            'localhost:' + port, grpc.credentials.createSsl(ca_data), {
+              'grpc.ssl_target_name_override': 'foo.test.google.fr',
+              'grpc.default_authority': 'foo.test.google.fr',
+              'grpc.test_connection_id': clientCount
+            });
+      };
+      newClient().unary({}, function(err, data) {
+        assert.ifError(err);
+        creds.updateCertificates(
+            null, [{private_key: untrusted_key_data,
+                    cert_chain: untrusted_pem_data}]);
+        newClient().unary({}, function(err, data) {
+          // The client does not trust the new certificate
+          assert(err);
+          assert.strictEqual(err.code, grpc.status.UNAVAILABLE);
+          creds.updateCertificates(
+              null, [{private_key: key_data, cert_chain: pem_data}]);
+          newClient().unary({}, function(err, data) {
+            assert.ifError(err);
+            server.forceShutdown();
+            done();
+          });
+        });
+      });
+    });
+  });
 });
 
 describe('client credentials', function() {
@@ -378,6 +456,35 @@ describe('client credentials', function() {
       done();
     });
   });
+  it('Should reuse cached metadata until it expires', function(done) {
+    var generated = 0;
+    var metadataUpdater = function(service_url, callback) {
+      generated++;
+      var metadata = new grpc.Metadata();
+      metadata.set('plugin_key', 'plugin_value_' + generated);
+      callback(null, metadata);
+    };
+    var creds = grpc.credentials.createFromMetadataGenerator(
+        metadataUpdater, {cacheTtl: 60000});
+    var combined_creds = grpc.credentials.combineChannelCredentials(
+        client_ssl_creds, creds);
+    var client = new Client('localhost:' + port, combined_creds,
+                            client_options);
+    var call = client.unary({}, function(err, data) {
+      assert.ifError(err);
+      var call2 = client.unary({}, function(err, data) {
+        assert.ifError(err);
+      });
+      call2.on('metadata', function(metadata) {
+        assert.deepEqual(metadata.get('plugin_key'), ['plugin_value_1']);
+        assert.strictEqual(generated, 1);
+        done();
+      });
+    });
+    call.on('metadata', function(metadata) {
+      assert.deepEqual(metadata.get('plugin_key'), ['plugin_value_1']);
+    });
+  });
   it('should fail the call if the updater fails', function(done) {
     var metadataUpdater = function(service_url, callback) {
       var error = new Error('Authentication error');
@@ -162,6 +162,140 @@ describe('end-to-end', function() {
       });
     });
   });
+  it('should receive metadata views', function(complete) {
+    var done = multiDone(complete, 2);
+    var call = channel.createCall(
+                             'dummy_method',
+                             Infinity);
+    var client_batch = {};
+    client_batch[grpc.opType.SEND_INITIAL_METADATA] = {
+      client_key: ['value1', 'value2'],
+      'client-bin': [new Buffer('abc')]
+    };
+    client_batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+    client_batch[grpc.opType.RECV_INITIAL_METADATA] = {view: true};
+    client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = {view: true};
+    call.startBatch(client_batch, function(err, response) {
+      assert.ifError(err);
+      assert(response.metadata instanceof grpc.MetadataView);
+      assert.strictEqual(response.metadata.get('server_key'), 'server_value');
+      assert(response.status.metadata instanceof grpc.MetadataView);
+      assert.deepEqual(response.status.metadata.toObject(),
+                       {trailer_key: ['trailer_value']});
+      done();
+    });
+
+    server.setMetadataViews(true);
+    server.requestCall(function(err, call_details) {
+      var metadata = call_details.new_call.metadata;
+      assert(metadata instanceof grpc.MetadataView);
+      assert.notEqual(metadata.keys().indexOf('client_key'), -1);
+      assert.notEqual(metadata.keys().indexOf('client-bin'), -1);
+      assert.strictEqual(metadata.get('client_key'), 'value1');
+      assert.deepEqual(metadata.getAll('client_key'), ['value1', 'value2']);
+      assert.deepEqual(metadata.getAll('client-bin'), [new Buffer('abc')]);
+      assert.strictEqual(metadata.get('missing_key'), undefined);
+      assert.deepEqual(metadata.getAll('missing_key'), []);
+      var server_call = call_details.new_call.call;
+      var server_batch = {};
+      server_batch[grpc.opType.SEND_INITIAL_METADATA] = {
+        server_key: ['server_value']
+      };
+      server_batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+        metadata: {trailer_key: ['trailer_value']},
+        code: constants.status.OK,
+        details: ''
+      };
+      server_batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+      server_call.startBatch(server_batch, function(err, response) {
+        assert.ifError(err);
+        done();
+      });
+    });
+    // Only the request above gets a view
+    server.setMetadataViews(false);
+  });
+  it('should send prepared metadata', function(complete) {
+    var done = multiDone(complete, 2);
+    var prepared = new grpc.PreparedMetadata({shared_key: ['shared_value']});
+    var call = channel.createCall(
+                             'dummy_method',
+                             Infinity);
+    var client_batch = {};
+    client_batch[grpc.opType.SEND_INITIAL_METADATA] =
+        prepared.append({client_key: ['client_value']});
+    client_batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+    client_batch[grpc.opType.RECV_INITIAL_METADATA] = true;
+    client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+    call.startBatch(client_batch, function(err, response) {
+      assert.ifError(err);
+      assert.deepEqual(response.metadata, {shared_key: ['shared_value']});
+      assert.deepEqual(response.status.metadata,
+                       {shared_key: ['shared_value']});
+      done();
+    });
+
+    server.requestCall(function(err, call_details) {
+      var new_call = call_details.new_call;
+      assert.strictEqual(new_call.metadata.shared_key[0], 'shared_value');
+      assert.strictEqual(new_call.metadata.client_key[0], 'client_value');
+      var server_call = new_call.call;
+      var server_batch = {};
+      server_batch[grpc.opType.SEND_INITIAL_METADATA] = prepared;
+      server_batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+        metadata: prepared,
+        code: constants.status.OK,
+        details: ''
+      };
+      server_batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+      server_call.startBatch(server_batch, function(err, response) {
+        assert.ifError(err);
+        done();
+      });
+    });
+  });
+  it('should send the same prepared metadata on concurrent calls',
+     function(complete) {
+       var callCount = 4;
+       var done = multiDone(complete, callCount * 2);
+       var prepared = new grpc.PreparedMetadata({
+         key1: ['value1'],
+         key2: ['value2', 'value3']
+       });
+       var expected = {key1: ['value1'], key2: ['value2', 'value3']};
+       // Every batch is started before any of them completes
+       for (var i = 0; i < callCount; i++) {
+         var call = channel.createCall('dummy_method', Infinity);
+         var client_batch = {};
+         client_batch[grpc.opType.SEND_INITIAL_METADATA] = prepared;
+         client_batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+         client_batch[grpc.opType.RECV_INITIAL_METADATA] = true;
+         client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+         call.startBatch(client_batch, function(err, response) {
+           assert.ifError(err);
+           assert.deepEqual(response.metadata, expected);
+           assert.deepEqual(response.status.metadata, expected);
+           done();
+         });
+         server.requestCall(function(err, call_details) {
+           var new_call = call_details.new_call;
+           assert.deepEqual(new_call.metadata.key1, expected.key1);
+           assert.deepEqual(new_call.metadata.key2, expected.key2);
+           var server_batch = {};
+           server_batch[grpc.opType.SEND_INITIAL_METADATA] = prepared;
+           server_batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+             metadata: prepared,
+             code: constants.status.OK,
+             details: ''
+           };
+           server_batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+           new_call.call.startBatch(server_batch, function(err, response) {
+             assert.ifError(err);
+             done();
+           });
+         });
+       }
+     });
   it('should send and receive data without error', function(complete) {
     var req_text = 'client_request';
     var reply_text = 'server_response';
@@ -218,6 +352,293 @@ describe('end-to-end', function() {
       });
     });
   });
+  it('should read ahead on a stream', function(complete) {
+    var done = multiDone(complete, 2);
+    var requests = ['first', 'second', 'third'];
+    var call = channel.createCall(
+                             'dummy_method',
+                             Infinity);
+    var client_batch = {};
+    client_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+    client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+    call.startBatch(client_batch, function(err, response) {
+      assert.ifError(err);
+      assert.strictEqual(response.status.code, constants.status.OK);
+      done();
+    });
+    // Core only allows one send at a time, so each one waits for the last
+    var sendNext = function(index) {
+      var batch = {};
+      if (index < requests.length) {
+        batch[grpc.opType.SEND_MESSAGE] = new Buffer(requests[index]);
+      } else {
+        batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+      }
+      call.startBatch(batch, function(err) {
+        assert.ifError(err);
+        if (index < requests.length) {
+          sendNext(index + 1);
+        }
+      });
+    };
+    sendNext(0);
+
+    server.requestCall(function(err, call_details) {
+      var server_call = call_details.new_call.call;
+      var received = [];
+      server_call.startReadAhead(1024, function(err) {
+        assert.ifError(err);
+        var messages = server_call.takeMessages();
+        for (var i = 0; i < messages.length; i++) {
+          if (messages[i] === null) {
+            assert.deepEqual(received, requests);
+            var server_batch = {};
+            server_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+            server_batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+              metadata: {},
+              code: constants.status.OK,
+              details: ''
+            };
+            server_batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+            server_call.startBatch(server_batch, function(err, response) {
+              assert.ifError(err);
+              done();
+            });
+            return;
+          }
+          received.push(messages[i].toString());
+        }
+      });
+      assert.throws(function() {
+        server_call.startReadAhead(1024, function() {});
+      });
+    });
+  });
+  it('should send queued messages in order', function(complete) {
+    var done = multiDone(complete, 3);
+    var requests = ['first', 'second', 'third', 'fourth'];
+    var call = channel.createCall(
+                             'dummy_method',
+                             Infinity);
+    var client_batch = {};
+    client_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+    client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+    call.startBatch(client_batch, function(err, response) {
+      assert.ifError(err);
+      assert.strictEqual(response.status.code, constants.status.OK);
+      done();
+    });
+    call.queueMessages([new Buffer(requests[0]), new Buffer(requests[1])],
+                       function(err) {
+                         assert.ifError(err);
+                       });
+    // Queued while the first group is still being sent
+    call.queueMessages([new Buffer(requests[2]), new Buffer(requests[3])],
+                       function(err) {
+                         assert.ifError(err);
+                         var close_batch = {};
+                         close_batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+                         call.startBatch(close_batch, function(err) {
+                           assert.ifError(err);
+                           done();
+                         });
+                       });
+
+    server.requestCall(function(err, call_details) {
+      var server_call = call_details.new_call.call;
+      var received = [];
+      var read = function() {
+        var batch = {};
+        batch[grpc.opType.RECV_MESSAGE] = true;
+        server_call.startBatch(batch, function(err, response) {
+          assert.ifError(err);
+          if (response.read !== null) {
+            received.push(response.read.toString());
+            read();
+            return;
+          }
+          assert.deepEqual(received, requests);
+          var server_batch = {};
+          server_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+          server_batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+            metadata: {},
+            code: constants.status.OK,
+            details: ''
+          };
+          server_batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+          server_call.startBatch(server_batch, function(err, response) {
+            assert.ifError(err);
+            done();
+          });
+        });
+      };
+      read();
+    });
+  });
+  it('should send queued messages that ask to be buffered', function(complete) {
+    var done = multiDone(complete, 2);
+    var hint = constants.writeFlags.BUFFER_HINT;
+    var call = channel.createCall(
+                             'dummy_method',
+                             Infinity);
+    var client_batch = {};
+    client_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+    client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+    call.startBatch(client_batch, function(err, response) {
+      assert.ifError(err);
+      assert.strictEqual(response.status.code, constants.status.OK);
+      done();
+    });
+    /* Each message is only sent once the one before it completes, so the
+     * queue would stall if core held them for a later flush */
+    call.queueMessages([{message: new Buffer('first'), flags: hint},
+                        {message: new Buffer('second'), flags: hint}],
+                       function(err) {
+                         assert.ifError(err);
+                         var close_batch = {};
+                         close_batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+                         call.startBatch(close_batch, function(err) {
+                           assert.ifError(err);
+                         });
+                       });
+
+    server.requestCall(function(err, call_details) {
+      var server_call = call_details.new_call.call;
+      var received = [];
+      var read = function() {
+        var batch = {};
+        batch[grpc.opType.RECV_MESSAGE] = true;
+        server_call.startBatch(batch, function(err, response) {
+          assert.ifError(err);
+          if (response.read !== null) {
+            received.push(response.read.toString());
+            read();
+            return;
+          }
+          assert.deepEqual(received, ['first', 'second']);
+          var server_batch = {};
+          server_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+          server_batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+            metadata: {},
+            code: constants.status.OK,
+            details: ''
+          };
+          server_batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+          server_call.startBatch(server_batch, function(err, response) {
+            assert.ifError(err);
+            done();
+          });
+        });
+      };
+      read();
+    });
+  });
+  it('should send and receive messages as slices', function(complete) {
+    var done = multiDone(complete, 2);
+    var req_text = 'client_request';
+    var status_text = 'success';
+    var call = channel.createCall(
+                             'dummy_method',
+                             Infinity);
+    var client_batch = {};
+    client_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+    client_batch[grpc.opType.SEND_MESSAGE] = [new Buffer('client_'),
+                                              new Buffer('request')];
+    client_batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+    client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+    call.startBatch(client_batch, function(err, response) {
+      assert.ifError(err);
+      assert.strictEqual(response.status.code, constants.status.OK);
+      done();
+    });
+
+    server.requestCall(function(err, call_details) {
+      var server_call = call_details.new_call.call;
+      var server_batch = {};
+      server_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+      server_batch[grpc.opType.RECV_MESSAGE] = {slices: true};
+      server_call.startBatch(server_batch, function(err, response) {
+        assert.ifError(err);
+        assert(Array.isArray(response.read));
+        response.read.forEach(function(slice) {
+          assert(Buffer.isBuffer(slice));
+        });
+        assert.strictEqual(Buffer.concat(response.read).toString(), req_text);
+        var end_batch = {};
+        end_batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+          metadata: {},
+          code: constants.status.OK,
+          details: status_text
+        };
+        end_batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+        server_call.startBatch(end_batch, function(err, response) {
+          assert.ifError(err);
+          assert(response.send_status);
+          done();
+        });
+      });
+    });
+  });
+  it('should reuse a batch template across calls', function(complete) {
+    var call_count = 3;
+    var done = multiDone(complete, call_count * 2);
+    var status_text = 'success';
+    var client_template = new grpc.BatchTemplate([
+      grpc.opType.SEND_INITIAL_METADATA,
+      grpc.opType.SEND_MESSAGE,
+      grpc.opType.SEND_CLOSE_FROM_CLIENT,
+      grpc.opType.RECV_INITIAL_METADATA,
+      grpc.opType.RECV_MESSAGE,
+      grpc.opType.RECV_STATUS_ON_CLIENT]);
+    var server_template = new grpc.BatchTemplate([
+      grpc.opType.SEND_INITIAL_METADATA,
+      grpc.opType.SEND_MESSAGE,
+      grpc.opType.SEND_STATUS_FROM_SERVER,
+      grpc.opType.RECV_CLOSE_ON_SERVER]);
+    function handleCall(err, call_details) {
+      var server_call = call_details.new_call.call;
+      var read_batch = {};
+      read_batch[grpc.opType.RECV_MESSAGE] = true;
+      server_call.startBatch(read_batch, function(err, response) {
+        assert.ifError(err);
+        server_call.startBatchFromTemplate(server_template, [
+          {},
+          new Buffer('reply_' + response.read.toString()),
+          {metadata: {}, code: constants.status.OK, details: status_text},
+          true
+        ], function(err, response) {
+          assert.ifError(err);
+          assert(response.send_status);
+          assert(!response.cancelled);
+          done();
+        });
+      });
+    }
+    function makeCall(index) {
+      var call = channel.createCall('dummy_method', Infinity);
+      call.startBatchFromTemplate(client_template, [
+        {},
+        new Buffer('request' + index),
+        true,
+        true,
+        true,
+        true
+      ], function(err, response) {
+        assert.ifError(err);
+        assert.strictEqual(response.read.toString(),
+                           'reply_request' + index);
+        assert.deepEqual(response.status, {code: constants.status.OK,
+                                           details: status_text,
+                                           metadata: {}});
+        if (index + 1 < call_count) {
+          makeCall(index + 1);
+        }
+        done();
+      });
+      server.requestCall(handleCall);
+    }
+    makeCall(0);
+  });
   it('should send multiple messages', function(complete) {
     var done = multiDone(complete, 2);
     var requests = ['req1', 'req2'];
@@ -104,6 +104,172 @@ describe('server', function() {
       });
     });
   });
+  describe('requestCalls', function() {
+    var server;
+    var port;
+    beforeEach(function() {
+      server = new grpc.Server();
+      port = server.addHttp2Port('localhost:0',
+                                 grpc.ServerCredentials.createInsecure());
+      server.start();
+    });
+    afterEach(function() {
+      server.forceShutdown();
+    });
+    it('should reject invalid arguments', function() {
+      assert.throws(function() {
+        server.requestCalls(0, function() {});
+      }, TypeError);
+      assert.throws(function() {
+        server.requestCalls(2);
+      }, TypeError);
+    });
+    it('should only be called once', function() {
+      server.requestCalls(2, function() {});
+      assert.throws(function() {
+        server.requestCalls(2, function() {});
+      });
+    });
+    it('should keep accepting calls without being called again',
+       function(done) {
+         var call_count = 5;
+         var received = 0;
+         server.requestCalls(2, function(err, event) {
+           if (err) {
+             return;
+           }
+           var server_call = event.new_call.call;
+           var batch = {};
+           batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+           batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+             code: 0,
+             details: '',
+             metadata: {}
+           };
+           batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+           server_call.startBatch(batch, function() {});
+           received++;
+         });
+         var insecure = grpc.ChannelCredentials.createInsecure();
+         var channel = new grpc.Channel('localhost:' + port, insecure);
+         var finished = 0;
+         for (var i = 0; i < call_count; i++) {
+           var call = channel.createCall('method', Infinity);
+           var client_batch = {};
+           client_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+           client_batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+           client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+           call.startBatch(client_batch, function(err, response) {
+             assert.ifError(err);
+             assert.strictEqual(response.status.code, 0);
+             finished++;
+             if (finished === call_count) {
+               assert.strictEqual(received, call_count);
+               channel.close();
+               done();
+             }
+           });
+         }
+       });
+  });
+  describe('registerMethod', function() {
+    var server;
+    var port;
+    beforeEach(function() {
+      server = new grpc.Server();
+      port = server.addHttp2Port('localhost:0',
+                                 grpc.ServerCredentials.createInsecure());
+    });
+    afterEach(function() {
+      server.forceShutdown();
+    });
+    it('should return a distinct id for each method', function() {
+      var id1 = server.registerMethod('/service/method1');
+      var id2 = server.registerMethod('/service/method2');
+      assert.strictEqual(typeof id1, 'number');
+      assert.notStrictEqual(id1, id2);
+    });
+    it('should reject a method that is already registered', function() {
+      server.registerMethod('/service/method');
+      assert.throws(function() {
+        server.registerMethod('/service/method');
+      });
+    });
+    it('should fail after the server has started', function() {
+      server.start();
+      assert.throws(function() {
+        server.registerMethod('/service/method');
+      });
+    });
+    it('should deliver matching calls to registered requests', function(done) {
+      var method_id = server.registerMethod('/service/method');
+      server.start();
+      server.requestRegisteredCall(method_id, function(err, event) {
+        assert.ifError(err);
+        assert.strictEqual(event.new_call.method, '/service/method');
+        var batch = {};
+        batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+        batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+          code: 0,
+          details: '',
+          metadata: {}
+        };
+        batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+        event.new_call.call.startBatch(batch, function() {});
+      });
+      var insecure = grpc.ChannelCredentials.createInsecure();
+      var channel = new grpc.Channel('localhost:' + port, insecure);
+      var call = channel.createCall('/service/method', Infinity);
+      var client_batch = {};
+      client_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+      client_batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+      client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+      call.startBatch(client_batch, function(err, response) {
+        assert.ifError(err);
+        assert.strictEqual(response.status.code, 0);
+        channel.close();
+        done();
+      });
+    });
+    it('should read the request message with the call if asked to',
+       function(done) {
+         var method_id = server.registerMethod('/service/method', true);
+         server.start();
+         server.requestRegisteredCall(method_id, function(err, event) {
+           assert.ifError(err);
+           assert.strictEqual(event.new_call.payload.toString(), 'request');
+           var batch = {};
+           batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+           batch[grpc.opType.SEND_STATUS_FROM_SERVER] = {
+             code: 0,
+             details: '',
+             metadata: {}
+           };
+           batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+           event.new_call.call.startBatch(batch, function() {});
+         });
+         var insecure = grpc.ChannelCredentials.createInsecure();
+         var channel = new grpc.Channel('localhost:' + port, insecure);
+         var call = channel.createCall('/service/method', Infinity);
+         var client_batch = {};
+         client_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+         client_batch[grpc.opType.SEND_MESSAGE] = new Buffer('request');
+         client_batch[grpc.opType.SEND_CLOSE_FROM_CLIENT] = true;
+         client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+         call.startBatch(client_batch, function(err, response) {
+           assert.ifError(err);
+           assert.strictEqual(response.status.code, 0);
+           channel.close();
+           done();
+         });
+       });
+    it('should reject unknown method ids', function() {
+      server.start();
+      assert.throws(function() {
+        server.requestRegisteredCall(3, function() {});
+      }, TypeError);
+    });
+  });
   describe('shutdown', function() {
     var server;
     beforeEach(function() {
@@ -133,4 +299,59 @@ describe('server', function() {
       server.forceShutdown();
     });
   });
+  describe('drain', function() {
+    var server;
+    var channel;
+    beforeEach(function() {
+      server = new grpc.Server();
+      var port = server.addHttp2Port('localhost:0',
+                                     grpc.ServerCredentials.createInsecure());
+      server.start();
+      var insecure = grpc.ChannelCredentials.createInsecure();
+      channel = new grpc.Channel('localhost:' + port, insecure);
+    });
+    afterEach(function() {
+      channel.close();
+      server.forceShutdown();
+    });
+    it('should reject invalid arguments', function() {
+      assert.throws(function() {
+        server.drain('soon', function() {});
+      }, TypeError);
+      assert.throws(function() {
+        server.drain(Infinity);
+      }, TypeError);
+    });
+    it('should finish without cancelling if no calls are in flight',
+       function(done) {
+      server.drain(Date.now() + 1000, function(err, event) {
+        assert.ifError(err);
+        assert.strictEqual(event.drain.cancelledCalls, 0);
+        done();
+      });
+    });
+    it('should cancel the calls left at the deadline', function(done) {
+      server.requestCall(function(err, event) {
+        assert.ifError(err);
+        var batch = {};
+        batch[grpc.opType.RECV_CLOSE_ON_SERVER] = true;
+        event.new_call.call.startBatch(batch, function() {});
+        assert.strictEqual(server.getInFlightCalls(), 1);
+        server.drain(Date.now() + 100, function(err, event) {
+          assert.ifError(err);
+          assert.strictEqual(event.drain.cancelledCalls, 1);
+          done();
+        });
+      });
+      var call = channel.createCall('method', Infinity);
+      var client_batch = {};
+      client_batch[grpc.opType.SEND_INITIAL_METADATA] = {};
+      client_batch[grpc.opType.RECV_STATUS_ON_CLIENT] = true;
+      call.startBatch(client_batch, function(err, response) {
+        assert.ifError(err);
+        // The server cancelled the call, so it did not finish with OK
+        assert.notStrictEqual(response.status.code, 0);
+      });
+    });
+  });
 });
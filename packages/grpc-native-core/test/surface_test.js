@@ -19,6 +19,8 @@
 'use strict';
 
 var assert = require('assert');
+var child_process = require('child_process');
+var path = require('path');
 var _ = require('lodash');
 
 var grpc = require('..');
@@ -91,6 +93,15 @@ describe('surface Server', function() {
     server.start();
     server.tryShutdown(done);
   });
+  it('should pass the cancelled call count to the drain callback',
+     function(done) {
+       server.start();
+       server.drain(Date.now() + 1000, function(err, cancelledCalls) {
+         assert.ifError(err);
+         assert.strictEqual(cancelledCalls, 0);
+         done();
+       });
+     });
 });
 describe('Server.prototype.addService', function() {
   var server;
@@ -314,6 +325,39 @@ describe('Echo service', function() {
     });
   });
 });
+describe('Server with a request call pool', function() {
+  var server;
+  var client;
+  before(function() {
+    var Client = grpc.load(__dirname + '/echo_service.proto').EchoService;
+    server = new grpc.Server({'grpc-node.request_call_depth': 4});
+    server.addService(Client.service, {
+      echo: function(call, callback) {
+        callback(null, call.request);
+      }
+    });
+    var port = server.bind('localhost:0', server_insecure_creds);
+    client = new Client('localhost:' + port, grpc.credentials.createInsecure());
+    server.start();
+  });
+  after(function() {
+    server.forceShutdown();
+  });
+  it('should handle more calls than the pool depth', function(done) {
+    var call_count = 10;
+    var finished = 0;
+    for (var i = 0; i < call_count; i++) {
+      client.echo({value: 'test value', value2: i}, function(error, response) {
+        assert.ifError(error);
+        assert.strictEqual(response.value, 'test value');
+        finished++;
+        if (finished === call_count) {
+          done();
+        }
+      });
+    }
+  });
+});
 describe('Generic client and server', function() {
   function toString(val) {
     return val.toString();
@@ -1511,3 +1555,102 @@ describe('Client reconnect', function() {
     });
   });
 });
+describe('Logging', function() {
+  /* The logger is global to the process, so each test sets it up in a new
+   * one. The script gets the grpc module as grpc and the captured lines as
+   * lines, and the lines are printed as JSON a while after it has run. The
+   * api tracer makes core log every channel creation and destruction. */
+  function runWithLogger(body, callback) {
+    var script = [
+      'var grpc = require(' + JSON.stringify(path.resolve(__dirname, '..')) +
+          ');',
+      'var lines = [];',
+      'grpc.setLogVerbosity(grpc.logVerbosity.DEBUG);',
+      'grpc.setLogger({error: function(line) { lines.push(line); }});',
+      body,
+      'setTimeout(function() {',
+      '  console.log(JSON.stringify(lines));',
+      '  process.exit(0);',
+      '}, 500);'
+    ].join('\n');
+    var env = _.assign({}, process.env, {GRPC_TRACE: 'api'});
+    child_process.execFile(
+        process.execPath, ['-e', script], {env: env, timeout: 10000},
+        function(err, stdout) {
+          assert.ifError(err);
+          callback(JSON.parse(stdout));
+        });
+  }
+  var recordPattern =
+      /^I \d{4}-\d\d-\d\dT[\d:.]+Z\t[^\/\t]+:\d+\]\t(.*)$/;
+  var droppedPattern = /^gRPC dropped (\d+) log messages/;
+  it('should pass core log records to the logger', function(done) {
+    this.timeout(15000);
+    runWithLogger([
+      'var creds = grpc.credentials.createInsecure();',
+      'new grpc.Channel("localhost:1", creds, {}).close();'
+    ].join('\n'), function(lines) {
+      var messages = lines.map(function(line) {
+        var match = recordPattern.exec(line);
+        return match ? match[1] : null;
+      });
+      assert(messages.some(function(message) {
+        return message !== null &&
+            message.indexOf('grpc_insecure_channel_create(') === 0;
+      }), 'No channel creation record in ' + JSON.stringify(lines));
+      assert(!lines.some(function(line) {
+        return droppedPattern.test(line);
+      }));
+      done();
+    });
+  });
+  it('should mark messages that were cut off', function(done) {
+    this.timeout(15000);
+    // The api tracer logs the target, so this message is too long to keep
+    runWithLogger([
+      'var creds = grpc.credentials.createInsecure();',
+      'var target = "localhost:1/" + new Array(1024).join("a");',
+      'new grpc.Channel(target, creds, {}).close();'
+    ].join('\n'), function(lines) {
+      var messages = lines.map(function(line) {
+        var match = recordPattern.exec(line);
+        return match ? match[1] : '';
+      }).filter(function(message) {
+        return message.indexOf('grpc_insecure_channel_create(') === 0;
+      });
+      assert.strictEqual(messages.length, 1);
+      assert.strictEqual(messages[0].length, 512 + '...'.length);
+      assert(/\.\.\.$/.test(messages[0]));
+      done();
+    });
+  });
+  it('should report the records dropped while the loop is busy',
+     function(done) {
+       this.timeout(15000);
+       /* Each channel logs at least two records, and none are delivered
+        * until the loop is free again, so this logs more than fit in the
+        * buffer */
+       runWithLogger([
+         'var creds = grpc.credentials.createInsecure();',
+         'for (var i = 0; i < 2000; i++) {',
+         '  new grpc.Channel("localhost:1", creds, {}).close();',
+         '}'
+       ].join('\n'), function(lines) {
+         var records = lines.filter(function(line) {
+           return recordPattern.test(line);
+         });
+         var dropped = lines.map(function(line) {
+           return droppedPattern.exec(line);
+         }).filter(_.identity);
+         assert(records.length > 0);
+         assert(dropped.length > 0,
+                'No dropped count in ' + JSON.stringify(lines.slice(-5)));
+         var total = _.sumBy(dropped, function(match) {
+           return Number(match[1]);
+         });
+         // The records that were delivered and dropped cover every channel
+         assert(records.length + total >= 4000);
+         done();
+       });
+     });
+});
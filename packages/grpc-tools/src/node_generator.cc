@@ -136,7 +136,14 @@ void PrintMessageTransformer(const Descriptor* descriptor, Printer* out,
              "throw new Error('Expected argument of type $name$');\n");
   out->Outdent();
   out->Print("}\n");
-  if (params.minimum_node_version > 5) {
+  if (params.zero_copy) {
+    // The serialized bytes are only used for sending, so the Buffer can share
+    // their memory. Buffer.from takes an offset and length since Node 4.5
+    out->Print("var bytes = arg.serializeBinary();\n");
+    out->Print(
+        "return Buffer.from(bytes.buffer, bytes.byteOffset, "
+        "bytes.byteLength);\n");
+  } else if (params.minimum_node_version > 5) {
     // Node version is > 5, we should use Buffer.from
     out->Print("return Buffer.from(arg.serializeBinary());\n");
   } else {
@@ -149,9 +156,18 @@ void PrintMessageTransformer(const Descriptor* descriptor, Printer* out,
   out->Print(template_vars,
              "function deserialize_$identifier_name$(buffer_arg) {\n");
   out->Indent();
-  out->Print(
-      template_vars,
-      "return $node_name$.deserializeBinary(new Uint8Array(buffer_arg));\n");
+  if (params.zero_copy) {
+    // Each received message has its own Buffer, so bytes fields can be views
+    // into it
+    out->Print(template_vars,
+               "return $node_name$.deserializeBinary(new Uint8Array(\n"
+               "    buffer_arg.buffer, buffer_arg.byteOffset, "
+               "buffer_arg.length));\n");
+  } else {
+    out->Print(
+        template_vars,
+        "return $node_name$.deserializeBinary(new Uint8Array(buffer_arg));\n");
+  }
   out->Outdent();
   out->Print("}\n\n");
 }
@@ -27,6 +27,9 @@ namespace grpc_node_generator {
 struct Parameters {
   // Sets the earliest version of nodejs that needs to be supported.
   int minimum_node_version;
+  // Makes the message transformers share memory with the serialized bytes
+  // instead of copying them.
+  bool zero_copy;
 };
 
 grpc::string GenerateFile(const grpc::protobuf::FileDescriptor* file,
@@ -18,7 +18,11 @@
 
 // Generates Node gRPC service interface out of Protobuf IDL.
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "config.h"
 #include "node_generator.h"
@@ -37,7 +41,59 @@ class NodeGrpcGenerator : public grpc::protobuf::compiler::CodeGenerator {
                 grpc::protobuf::compiler::GeneratorContext* context,
                 grpc::string* error) const {
     grpc_node_generator::Parameters generator_parameters;
-    generator_parameters.minimum_node_version = 4;
+    if (!ParseParameters(parameter, &generator_parameters, error)) {
+      return false;
+    }
+    WriteFile(file, GenerateFile(file, generator_parameters), context);
+    return true;
+  }
+
+  // Generates the files in parallel, because protoc passes every file in one
+  // request and each file's code only depends on its own descriptors.
+  bool GenerateAll(
+      const std::vector<const grpc::protobuf::FileDescriptor*>& files,
+      const grpc::string& parameter,
+      grpc::protobuf::compiler::GeneratorContext* context,
+      grpc::string* error) const {
+    grpc_node_generator::Parameters generator_parameters;
+    if (!ParseParameters(parameter, &generator_parameters, error)) {
+      return false;
+    }
+    std::vector<grpc::string> code(files.size());
+    size_t num_threads = std::min<size_t>(
+        std::max(std::thread::hardware_concurrency(), 1u), files.size());
+    if (num_threads <= 1) {
+      for (size_t i = 0; i < files.size(); i++) {
+        code[i] = GenerateFile(files[i], generator_parameters);
+      }
+    } else {
+      std::atomic<size_t> next_file(0);
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < num_threads; i++) {
+        threads.push_back(std::thread([&]() {
+          for (size_t j = next_file++; j < files.size(); j = next_file++) {
+            code[j] = GenerateFile(files[j], generator_parameters);
+          }
+        }));
+      }
+      for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+      }
+    }
+    // The context is not thread safe, so the files are written afterwards, in
+    // the order protoc passed them
+    for (size_t i = 0; i < files.size(); i++) {
+      WriteFile(files[i], code[i], context);
+    }
+    return true;
+  }
+
+ private:
+  static bool ParseParameters(const grpc::string& parameter,
+                              grpc_node_generator::Parameters* params,
+                              grpc::string* error) {
+    params->minimum_node_version = 4;
+    params->zero_copy = false;
 
     if (!parameter.empty()) {
       std::vector<grpc::string> parameters_list =
@@ -47,18 +103,23 @@ class NodeGrpcGenerator : public grpc::protobuf::compiler::CodeGenerator {
         std::vector<grpc::string> param =
             grpc_generator::tokenize(*parameter_string, "=");
         if (param[0] == "minimum_node_version") {
-          sscanf(param[1].c_str(), "%d",
-                 &generator_parameters.minimum_node_version);
+          sscanf(param[1].c_str(), "%d", &params->minimum_node_version);
+        } else if (param[0] == "zero_copy") {
+          params->zero_copy = param.size() < 2 || param[1] == "true";
         } else {
           *error = grpc::string("Unknown parameter: ") + *parameter_string;
           return false;
         }
       }
     }
+    return true;
+  }
 
-    grpc::string code = GenerateFile(file, generator_parameters);
+  static void WriteFile(const grpc::protobuf::FileDescriptor* file,
+                        const grpc::string& code,
+                        grpc::protobuf::compiler::GeneratorContext* context) {
     if (code.size() == 0) {
-      return true;
+      return;
     }
 
     // Get output file name
@@ -68,7 +129,6 @@ class NodeGrpcGenerator : public grpc::protobuf::compiler::CodeGenerator {
         context->Open(file_name));
     grpc::protobuf::io::CodedOutputStream coded_out(output.get());
     coded_out.WriteRaw(code.data(), code.size());
-    return true;
   }
 };
 
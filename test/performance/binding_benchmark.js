@@ -0,0 +1,87 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * Runs the native micro-benchmarks for the binding's conversions between
+ * JavaScript values and core structs, for every benchmark and size, and
+ * prints the time and allocations per operation.
+ *
+ * The benchmark module is only built when requested:
+ *   cd packages/grpc-native-core
+ *   node-gyp rebuild -- -Dgrpc_node_benchmark=true
+ *
+ * Usage: node binding_benchmark.js [--json] [benchmark...]
+ * @module
+ */
+
+'use strict';
+
+var path = require('path');
+
+var benchmark = require(path.resolve(
+    __dirname,
+    '../../packages/grpc-native-core/build/Release/grpc_node_benchmark.node'));
+
+var sizes = [0, 16, 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024];
+
+/* Enough iterations that each run converts at least this many bytes, for
+ * stable numbers on large sizes without taking too long on small ones */
+var bytes_per_run = 256 * 1024 * 1024;
+var min_iterations = 10;
+var max_iterations = 100000;
+
+/**
+ * Get the number of iterations to run a benchmark for at the given size
+ * @param {number} size The size of the converted values in bytes
+ * @return {number} The number of iterations
+ */
+function getIterations(size) {
+  var iterations = Math.floor(bytes_per_run / Math.max(size, 1));
+  return Math.min(Math.max(iterations, min_iterations), max_iterations);
+}
+
+function main() {
+  var args = process.argv.slice(2);
+  var json = args.indexOf('--json') !== -1;
+  var names = args.filter(function(arg) {
+    return arg !== '--json';
+  });
+  if (names.length === 0) {
+    names = benchmark.benchmarks;
+  }
+  var results = [];
+  names.forEach(function(name) {
+    sizes.forEach(function(size) {
+      // A short run first, so that pools and caches are warm
+      benchmark.run(name, size, min_iterations);
+      var result = benchmark.run(name, size, getIterations(size));
+      results.push(result);
+      if (!json) {
+        console.log(name + '\t' + size + ' B\t' +
+                    result.nsPerOp.toFixed(1) + ' ns/op\t' +
+                    result.gprAllocsPerOp.toFixed(2) + ' gpr allocs/op\t' +
+                    result.newAllocsPerOp.toFixed(2) + ' new allocs/op');
+      }
+    });
+  });
+  if (json) {
+    console.log(JSON.stringify(results, null, 2));
+  }
+}
+
+main();
@@ -0,0 +1,122 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * Measures how many completed batches per second the native extension can
+ * deliver to JavaScript, with and without batch dispatch enabled. Runs a
+ * number of concurrent ping-pong streaming calls against a local server for a
+ * fixed time in each mode.
+ *
+ * Usage: node completion_dispatch_benchmark.js [streams] [seconds]
+ * @module
+ */
+
+'use strict';
+
+var grpc = require('../../packages/grpc-native-core');
+var extension = require('../../packages/grpc-native-core/src/grpc_extension');
+
+var genericService = require('./generic_service');
+
+var stream_count = parseInt(process.argv[2], 10) || 64;
+var duration_secs = parseInt(process.argv[3], 10) || 5;
+
+/**
+ * Get the total number of batches started so far, which is the number of tags
+ * that have been allocated
+ * @return {number} The number of batches
+ */
+function getBatchCount() {
+  var tag_stats = extension.getAllocatorStats().tag;
+  return tag_stats ? tag_stats.hits + tag_stats.misses : 0;
+}
+
+/**
+ * Run ping-pong streams for the configured duration, and report the rate of
+ * completed batches
+ * @param {grpc.Client} client The client to make calls with
+ * @param {string} label The name of the mode being measured
+ * @param {function()} callback Called when the run is over
+ */
+function runPingPong(client, label, callback) {
+  var running = true;
+  var message = new Buffer(8);
+  message.fill(0);
+  var streams = [];
+  var finished = 0;
+  for (var i = 0; i < stream_count; i++) {
+    var call = client.streamingCall();
+    call.on('data', function() {
+      if (running) {
+        this.write(message);
+      } else {
+        this.end();
+      }
+    });
+    call.on('status', function() {
+      finished++;
+      if (finished === stream_count) {
+        callback();
+      }
+    });
+    call.on('error', function() {});
+    streams.push(call);
+  }
+  var start_batches = getBatchCount();
+  var start_time = process.hrtime();
+  streams.forEach(function(call) {
+    call.write(message);
+  });
+  setTimeout(function() {
+    running = false;
+    var elapsed = process.hrtime(start_time);
+    var elapsed_secs = elapsed[0] + elapsed[1] / 1e9;
+    var batches = getBatchCount() - start_batches;
+    console.log(label + ': ' + Math.round(batches / elapsed_secs) +
+                ' completions/s');
+  }, duration_secs * 1000);
+}
+
+var server = new grpc.Server();
+server.addService(genericService, {
+  unaryCall: function(call, callback) {
+    callback(null, call.request);
+  },
+  streamingCall: function(call) {
+    call.on('data', function(value) {
+      call.write(value);
+    });
+    call.on('end', function() {
+      call.end();
+    });
+  }
+});
+var port = server.bind('localhost:0', grpc.ServerCredentials.createInsecure());
+server.start();
+
+var Client = grpc.makeGenericClientConstructor(genericService);
+var client = new Client('localhost:' + port, grpc.credentials.createInsecure());
+
+runPingPong(client, 'per-batch callbacks', function() {
+  grpc.enableBatchDispatch();
+  runPingPong(client, 'batch dispatch', function() {
+    grpc.enableBatchDispatch(false);
+    client.close();
+    server.forceShutdown();
+  });
+});
@@ -154,6 +154,27 @@ Histogram.prototype.sumOfSquares = function() {
   return this.sum_of_squares;
 };
 
+/**
+ * Get an upper bound for the given percentile of all added values, to within
+ * the histogram's resolution
+ * @param {number} percentile The percentile, between 0 and 100
+ * @return {number} The value at that percentile
+ */
+Histogram.prototype.percentile = function(percentile) {
+  if (this.count === 0) {
+    return 0;
+  }
+  var threshold = this.count * percentile / 100;
+  var seen = 0;
+  for (var i = 0; i < this.buckets.length; i++) {
+    seen += this.buckets[i];
+    if (seen >= threshold) {
+      return Math.min(this.bucketStart(i + 1), this.max_seen);
+    }
+  }
+  return this.max_seen;
+};
+
 /**
  * Get the raw histogram as a list of bucket sizes
  * @return {Array.<number>} The buckets
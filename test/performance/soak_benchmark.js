@@ -0,0 +1,453 @@
+/*
+ *
+ * Copyright 2018 gRPC authors.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/**
+ * Load and soak benchmark for the native extension. Each scenario runs calls
+ * against a local server in its own child process for a fixed time, and
+ * records the native costs along with the throughput and latency:
+ *   - throughput, and p50, p99 and p99.9 latency
+ *   - RSS and heap growth between the end of the warmup and the end of the run
+ *   - GC pause time
+ *   - completion queue events per drain, from the native stats
+ *   - native objects that are still allocated after every call has finished,
+ *     from the allocator stats
+ *
+ * The results can be stored as a baseline, and later runs compared against
+ * it. The comparison fails if any metric is worse than the baseline by more
+ * than the tolerance.
+ *
+ * Usage: node soak_benchmark.js [--seconds=N] [--write-baseline=FILE]
+ *            [--baseline=FILE] [--tolerance=FRACTION] [--json] [scenario...]
+ * @module
+ */
+
+'use strict';
+
+var child_process = require('child_process');
+var fs = require('fs');
+
+var Histogram = require('./histogram');
+
+var genericService = require('./generic_service');
+
+var scenarios = {
+  unary: {
+    type: 'unary',
+    size: 64,
+    concurrency: 32
+  },
+  streaming: {
+    type: 'streaming',
+    size: 64,
+    concurrency: 32
+  },
+  large_payload: {
+    type: 'unary',
+    size: 1024 * 1024,
+    concurrency: 4
+  },
+  high_metadata: {
+    type: 'unary',
+    size: 64,
+    concurrency: 16,
+    metadata_entries: 64
+  },
+  many_channels: {
+    type: 'unary',
+    size: 64,
+    concurrency: 1,
+    channels: 64
+  }
+};
+
+/* How each metric is compared against the baseline. Metrics that are not
+ * listed here are only reported. The floor is a difference that is always
+ * treated as noise, in the metric's units. */
+var comparisons = {
+  qps: {better: 'higher', floor: 0},
+  latencyP50Us: {better: 'lower', floor: 10},
+  latencyP99Us: {better: 'lower', floor: 50},
+  latencyP999Us: {better: 'lower', floor: 100},
+  rssGrowthBytes: {better: 'lower', floor: 4 * 1024 * 1024},
+  heapGrowthBytes: {better: 'lower', floor: 1024 * 1024},
+  gcPauseMs: {better: 'lower', floor: 10},
+  leakedNativeObjects: {better: 'lower', floor: 0}
+};
+
+// The fraction of each run that is not measured, so that pools are warm
+var warmup_fraction = 0.2;
+
+/**
+ * Get the number of native objects that are allocated from each pool
+ * @param {Object} extension The native extension
+ * @return {Object.<string, number>} The counts, keyed by the pooled type
+ */
+function getNativeObjects(extension) {
+  var stats = extension.getAllocatorStats();
+  var counts = {};
+  Object.keys(stats).forEach(function(name) {
+    counts[name] = stats[name].inUse;
+  });
+  return counts;
+}
+
+/**
+ * Run a client that keeps concurrency calls going on each channel, until
+ * isRunning returns false
+ * @param {Object} scenario The scenario's parameters
+ * @param {Array.<grpc.Client>} clients One client for each channel
+ * @param {function(): boolean} isRunning Whether to start more calls
+ * @param {function(number)} onLatency Called with each call's latency in ns
+ * @param {function()} callback Called when every call has finished
+ */
+function runClients(scenario, clients, isRunning, onLatency, callback) {
+  var grpc = require('../../packages/grpc-native-core');
+  var message = Buffer.alloc(scenario.size);
+  var metadata = new grpc.Metadata();
+  for (var i = 0; i < (scenario.metadata_entries || 0); i++) {
+    metadata.add('soak-key-' + i, 'value-' + i + '-' + 'x'.repeat(24));
+  }
+  var outstanding = 0;
+  function finishOne() {
+    outstanding--;
+    if (outstanding === 0) {
+      callback();
+    }
+  }
+  function startUnary(client) {
+    var start = process.hrtime();
+    client.unaryCall(message, metadata, function(err) {
+      var elapsed = process.hrtime(start);
+      if (err) {
+        throw err;
+      }
+      onLatency(elapsed[0] * 1e9 + elapsed[1]);
+      if (isRunning()) {
+        startUnary(client);
+      } else {
+        finishOne();
+      }
+    });
+  }
+  function startStream(client) {
+    var call = client.streamingCall(metadata);
+    var start;
+    call.on('data', function() {
+      var elapsed = process.hrtime(start);
+      onLatency(elapsed[0] * 1e9 + elapsed[1]);
+      if (isRunning()) {
+        start = process.hrtime();
+        call.write(message);
+      } else {
+        call.end();
+      }
+    });
+    call.on('status', finishOne);
+    call.on('error', function(err) {
+      throw err;
+    });
+    start = process.hrtime();
+    call.write(message);
+  }
+  clients.forEach(function(client) {
+    for (var i = 0; i < scenario.concurrency; i++) {
+      outstanding++;
+      if (scenario.type === 'streaming') {
+        startStream(client);
+      } else {
+        startUnary(client);
+      }
+    }
+  });
+}
+
+/**
+ * Run one scenario in this process, and send its results to the parent
+ * @param {string} name The scenario's name
+ * @param {number} seconds How long to run the scenario for
+ */
+function runScenario(name, seconds) {
+  var grpc = require('../../packages/grpc-native-core');
+  var extension =
+      require('../../packages/grpc-native-core/src/grpc_extension');
+  var perf_hooks = require('perf_hooks');
+  var scenario = scenarios[name];
+
+  var server = new grpc.Server();
+  server.addService(genericService, {
+    unaryCall: function(call, callback) {
+      call.sendMetadata(call.metadata);
+      callback(null, call.request);
+    },
+    streamingCall: function(call) {
+      call.sendMetadata(call.metadata);
+      call.on('data', function(value) {
+        call.write(value);
+      });
+      call.on('end', function() {
+        call.end();
+      });
+    }
+  });
+  var port = server.bind('localhost:0',
+                         grpc.ServerCredentials.createInsecure());
+  server.start();
+  var Client = grpc.makeGenericClientConstructor(genericService);
+  var clients = [];
+  for (var i = 0; i < (scenario.channels || 1); i++) {
+    /* Each client gets its own channel, because channels with the same
+     * arguments would otherwise share their connection */
+    clients.push(new Client('localhost:' + port,
+                            grpc.credentials.createInsecure(),
+                            {'grpc.soak_channel_index': i}));
+  }
+
+  var native_objects_before = getNativeObjects(extension);
+  var latency = new Histogram(0.01, 60e9);
+  var measuring = false;
+  var running = true;
+  var calls = 0;
+  var gc_pause_ms = 0;
+  var gc_observer = new perf_hooks.PerformanceObserver(function(list) {
+    if (measuring) {
+      list.getEntries().forEach(function(entry) {
+        gc_pause_ms += entry.duration;
+      });
+    }
+  });
+  gc_observer.observe({entryTypes: ['gc']});
+  var memory_before;
+  var stats_before;
+  var start_time;
+
+  setTimeout(function() {
+    if (global.gc) {
+      global.gc();
+    }
+    memory_before = process.memoryUsage();
+    stats_before = extension.getStats();
+    start_time = process.hrtime();
+    measuring = true;
+  }, seconds * warmup_fraction * 1000);
+  setTimeout(function() {
+    running = false;
+  }, seconds * 1000);
+
+  function onLatency(nanos) {
+    if (measuring) {
+      latency.add(nanos);
+      calls++;
+    }
+  }
+
+  runClients(scenario, clients, function() {
+    return running;
+  }, onLatency, function() {
+    measuring = false;
+    var elapsed = process.hrtime(start_time);
+    var elapsed_secs = elapsed[0] + elapsed[1] / 1e9;
+    if (global.gc) {
+      global.gc();
+    }
+    var memory_after = process.memoryUsage();
+    var stats_after = extension.getStats();
+    clients.forEach(function(client) {
+      client.close();
+    });
+    server.tryShutdown(function() {
+      gc_observer.disconnect();
+      /* Let the last completions be released, and collect the calls' wrappers,
+       * before counting what is left */
+      setImmediate(function() {
+        if (global.gc) {
+          global.gc();
+        }
+        var native_objects_after = getNativeObjects(extension);
+        var leaked = 0;
+        Object.keys(native_objects_after).forEach(function(pool) {
+          leaked += Math.max(0, native_objects_after[pool] -
+                                (native_objects_before[pool] || 0));
+        });
+        var drains = stats_after.drains - stats_before.drains;
+        var events = stats_after.batchesCompleted -
+            stats_before.batchesCompleted;
+        process.send({
+          scenario: name,
+          calls: calls,
+          qps: calls / elapsed_secs,
+          latencyP50Us: latency.percentile(50) / 1000,
+          latencyP99Us: latency.percentile(99) / 1000,
+          latencyP999Us: latency.percentile(99.9) / 1000,
+          rssGrowthBytes: memory_after.rss - memory_before.rss,
+          heapGrowthBytes: memory_after.heapUsed - memory_before.heapUsed,
+          gcPauseMs: gc_pause_ms,
+          eventsPerDrain: drains > 0 ? events / drains : 0,
+          batchLatencyP999Us: stats_after.batchLatency.p999 / 1000,
+          leakedNativeObjects: leaked,
+          nativeObjects: native_objects_after
+        }, function() {
+          process.disconnect();
+        });
+      });
+    });
+  });
+}
+
+/**
+ * Compare results against a baseline
+ * @param {Array.<Object>} results The results of this run
+ * @param {Object.<string, Object>} baseline Earlier results, keyed by scenario
+ * @param {number} tolerance The fraction by which a metric can be worse than
+ *     its baseline
+ * @return {Array.<string>} A description of each regression
+ */
+function compareResults(results, baseline, tolerance) {
+  var regressions = [];
+  results.forEach(function(result) {
+    var base = baseline[result.scenario];
+    if (!base) {
+      return;
+    }
+    Object.keys(comparisons).forEach(function(metric) {
+      var comparison = comparisons[metric];
+      var value = result[metric];
+      var base_value = base[metric];
+      if (typeof base_value !== 'number') {
+        return;
+      }
+      var allowed = Math.abs(base_value) * tolerance + comparison.floor;
+      var regressed;
+      if (comparison.better === 'higher') {
+        regressed = value < base_value - allowed;
+      } else {
+        regressed = value > base_value + allowed;
+      }
+      if (regressed) {
+        regressions.push(result.scenario + ' ' + metric + ': ' +
+                         value.toFixed(2) + ' (baseline ' +
+                         base_value.toFixed(2) + ')');
+      }
+    });
+  });
+  return regressions;
+}
+
+/**
+ * Run each scenario in a child process, one at a time, so that their memory
+ * use and native stats are measured separately
+ * @param {Array.<string>} names The scenarios to run
+ * @param {number} seconds How long to run each scenario for
+ * @param {function(Array.<Object>)} callback Called with the results
+ */
+function runAll(names, seconds, callback) {
+  var results = [];
+  function runNext(index) {
+    if (index === names.length) {
+      return callback(results);
+    }
+    var child = child_process.fork(
+        __filename, ['--child=' + names[index], '--seconds=' + seconds],
+        {execArgv: process.execArgv.concat(['--expose-gc'])});
+    child.on('message', function(result) {
+      results.push(result);
+    });
+    child.on('exit', function(code) {
+      if (code !== 0) {
+        throw new Error('Scenario ' + names[index] + ' failed');
+      }
+      runNext(index + 1);
+    });
+  }
+  runNext(0);
+}
+
+/**
+ * Get the value of a --name=value argument
+ * @param {Array.<string>} args The command line arguments
+ * @param {string} name The argument's name
+ * @return {string|undefined} The value, if the argument was passed
+ */
+function getOption(args, name) {
+  var prefix = '--' + name + '=';
+  for (var i = 0; i < args.length; i++) {
+    if (args[i].indexOf(prefix) === 0) {
+      return args[i].substring(prefix.length);
+    }
+  }
+  return undefined;
+}
+
+function main() {
+  var args = process.argv.slice(2);
+  var seconds = parseFloat(getOption(args, 'seconds')) || 10;
+  var child = getOption(args, 'child');
+  if (child) {
+    return runScenario(child, seconds);
+  }
+  var json = args.indexOf('--json') !== -1;
+  var baseline_file = getOption(args, 'baseline');
+  var write_baseline_file = getOption(args, 'write-baseline');
+  var tolerance = parseFloat(getOption(args, 'tolerance')) || 0.1;
+  var names = args.filter(function(arg) {
+    return arg.indexOf('--') !== 0;
+  });
+  if (names.length === 0) {
+    names = Object.keys(scenarios);
+  }
+  names.forEach(function(name) {
+    if (!scenarios.hasOwnProperty(name)) {
+      throw new Error('Unknown scenario ' + name);
+    }
+  });
+  runAll(names, seconds, function(results) {
+    if (json) {
+      console.log(JSON.stringify(results, null, 2));
+    } else {
+      results.forEach(function(result) {
+        console.log(result.scenario + '\t' +
+                    Math.round(result.qps) + ' qps\t' +
+                    'p99.9 ' + result.latencyP999Us.toFixed(0) + ' us\t' +
+                    'rss +' + (result.rssGrowthBytes / 1024).toFixed(0) +
+                    ' KiB\t' +
+                    'gc ' + result.gcPauseMs.toFixed(1) + ' ms\t' +
+                    result.eventsPerDrain.toFixed(2) + ' events/drain\t' +
+                    result.leakedNativeObjects + ' leaked');
+      });
+    }
+    if (write_baseline_file) {
+      var baseline = {};
+      results.forEach(function(result) {
+        baseline[result.scenario] = result;
+      });
+      fs.writeFileSync(write_baseline_file,
+                       JSON.stringify(baseline, null, 2) + '\n');
+    }
+    if (baseline_file) {
+      var regressions = compareResults(
+          results, JSON.parse(fs.readFileSync(baseline_file)), tolerance);
+      regressions.forEach(function(regression) {
+        console.error('Regression: ' + regression);
+      });
+      if (regressions.length > 0) {
+        process.exitCode = 1;
+      }
+    }
+  });
+}
+
+main();